@@ -0,0 +1,42 @@
+/**
+ * @file BackupRegs.h
+ * @brief RTC backup register allocation
+ *
+ * The STM32F412 has no backup SRAM; its 20 32-bit RTC backup registers are
+ * the only RAM that survives a reset (watchdog, NVIC_SystemReset, the reset
+ * button). They are lost on power-off unless VBAT is supplied. Registers
+ * 0-3 are left to the framework and bootloader.
+ */
+
+#ifndef BACKUP_REGS_H
+#define BACKUP_REGS_H
+
+#include <stdint.h>
+#include "cmsis.h"
+
+// Boot phase profile (BootProfile), 10 registers
+#define BKP_REG_BOOT 4
+
+// Watchdog stall record (HealthMonitor), 6 registers
+#define BKP_REG_HEALTH 14
+
+/**
+ * Enable write access to the backup domain
+ */
+static inline void Bkp_Enable()
+{
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+    PWR->CR |= PWR_CR_DBP;
+}
+
+static inline uint32_t Bkp_Read(int reg)
+{
+    return (&RTC->BKP0R)[reg];
+}
+
+static inline void Bkp_Write(int reg, uint32_t value)
+{
+    (&RTC->BKP0R)[reg] = value;
+}
+
+#endif // BACKUP_REGS_H
@@ -0,0 +1,93 @@
+/**
+ * @file BlobTransfer.h
+ * @brief Chunked inbound transfers for payloads larger than the MQTT buffer
+ *
+ * A sender splits a blob into chunks and publishes them to the blob topic
+ * with a 20-byte header (all fields big-endian):
+ *
+ *   0  u8   version (BLOB_PROTOCOL_VERSION)
+ *   1  u8   kind      selects the sink that stores the blob
+ *   2  u8   flags     BLOB_FLAG_QUERY asks for the current state only
+ *   3  u8   reserved
+ *   4  u16  transfer id
+ *   6  u16  sequence number
+ *   8  u16  chunk size (bytes in every chunk except the last)
+ *  10  u16  reserved
+ *  12  u32  total size
+ *  16  u32  CRC-32 of the chunk data
+ *  20  ...  chunk data
+ *
+ * A transfer holds at most 65535 chunks; a larger total size needs a larger
+ * chunk size. Chunks are accepted strictly in order (go-back-N). Up to BLOB_WINDOW
+ * chunks may be in flight; the device acknowledges the next expected
+ * sequence number every BLOB_WINDOW / 2 chunks, on completion, and
+ * whenever a chunk is rejected, so the sender can resume from there. The
+ * transfer state survives MQTT reconnects, so an interrupted transfer
+ * resumes by sending the same id from the acknowledged sequence number.
+ */
+
+#ifndef BLOB_TRANSFER_H
+#define BLOB_TRANSFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLOB_PROTOCOL_VERSION 1
+#define BLOB_HEADER_SIZE 20
+#define BLOB_FLAG_QUERY 0x01
+
+#ifndef BLOB_WINDOW
+#define BLOB_WINDOW 8
+#endif
+
+#ifndef BLOB_MAX_KINDS
+#define BLOB_MAX_KINDS 4
+#endif
+
+// Abandon a transfer that has made no progress for this long
+#ifndef BLOB_IDLE_TIMEOUT_MS
+#define BLOB_IDLE_TIMEOUT_MS 1800000
+#endif
+
+/**
+ * Storage for one kind of blob. Chunks are written in order; finish() is
+ * called with ok=false if the transfer is aborted or replaced.
+ */
+struct BlobSink
+{
+    bool (*begin)(uint16_t id, uint32_t totalSize, void* context);
+    bool (*write)(uint32_t offset, const uint8_t* data, size_t length, void* context);
+    bool (*finish)(bool ok, void* context);
+    void* context;
+};
+
+/**
+ * Publishes an acknowledgement (JSON) to the ack topic
+ */
+typedef bool (*BlobAckFn)(const char* json);
+
+void BlobTransfer_Init(BlobAckFn ack);
+
+bool BlobTransfer_RegisterSink(uint8_t kind, const BlobSink* sink);
+
+/**
+ * Handle one chunk message (TopicHandler signature)
+ */
+void BlobTransfer_OnMessage(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+
+/**
+ * Expire idle transfers. Call periodically.
+ */
+void BlobTransfer_Poll();
+
+/**
+ * Re-send the acknowledgement for an active transfer (after a reconnect)
+ */
+void BlobTransfer_AnnounceState();
+
+/**
+ * CRC-32 (IEEE 802.3, as used by zlib) over data, continuing from crc
+ */
+uint32_t BlobTransfer_Crc32(uint32_t crc, const uint8_t* data, size_t length);
+
+#endif // BLOB_TRANSFER_H
@@ -0,0 +1,85 @@
+/**
+ * @file BootProfile.h
+ * @brief Per-phase boot timing kept across resets
+ *
+ * Each startup phase records when it first began and when it first
+ * completed, in milliseconds since reset. A phase that is retried keeps
+ * its first start, so its duration includes the failed attempts. Every
+ * update is written straight to the RTC backup registers, so when a boot
+ * never completes (a watchdog reset while connecting, a brown-out) the
+ * next boot can still report how far the previous one got.
+ *
+ * Starts are stored in 10 ms units (up to about 11 minutes) and durations
+ * in milliseconds (up to about 65 s), one register per phase.
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum BootPhase
+{
+    BOOT_DISPLAY,               // OLED init
+    BOOT_CONFIG,                // settings and credential reads
+    BOOT_WIFI,                  // association with the access point
+    BOOT_DHCP,                  // association to IP address
+    BOOT_NTP,                   // first SNTP request to the clock being set
+    BOOT_DNS,                   // broker lookup
+    BOOT_TLS,                   // TCP connect and TLS handshake (TCP only without TLS)
+    BOOT_CONNACK,               // CONNECT to CONNACK
+    BOOT_SUBACK,                // first SUBSCRIBE to last SUBACK
+    BOOT_PHASE_COUNT
+};
+
+struct BootPhaseTime
+{
+    uint32_t startMs;           // BOOT_NOT_REACHED if the phase never began
+    uint32_t durationMs;        // BOOT_NOT_REACHED if it never completed
+};
+
+#define BOOT_NOT_REACHED 0xFFFFFFFFu
+
+/**
+ * Keep the previous boot's profile, then start a new one. Call first thing
+ * in setup().
+ */
+void BootProfile_Init();
+
+/**
+ * Mark a phase as begun; ignored if it already has
+ */
+void BootProfile_Begin(int phase);
+
+/**
+ * Mark a phase as completed; ignored unless it has begun and not yet
+ * completed
+ */
+void BootProfile_End(int phase);
+
+/**
+ * Mark the boot complete (first broker connection)
+ */
+void BootProfile_Complete();
+
+/**
+ * Note the first telemetry publish (kept in RAM only)
+ */
+void BootProfile_FirstPublish();
+
+bool BootProfile_IsComplete();
+
+const BootPhaseTime* BootProfile_Get(int phase);
+
+const char* BootProfile_PhaseName(int phase);
+
+/**
+ * Format the profile as compact JSON: the times of the first connection and
+ * first publish, [start, duration] per phase reached, and where the
+ * previous boot stopped if it never completed. Returns the number of
+ * characters written, or 0 if it does not fit.
+ */
+size_t BootProfile_Format(char* buf, size_t size);
+
+#endif // BOOT_PROFILE_H
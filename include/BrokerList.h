@@ -0,0 +1,85 @@
+/**
+ * @file BrokerList.h
+ * @brief Ordered broker endpoint list with connect-time health scoring
+ *
+ * The configured broker is always the first endpoint; additional regional
+ * brokers come from the BROKER_FAILOVER_LIST build flag as a comma-separated
+ * "host[:port]" list. Each endpoint is scored from a moving average of its
+ * connect time plus a penalty for recent failures, and failed endpoints are
+ * held back with an exponential cooldown. Scoring takes the current time as
+ * a parameter so it can be driven with simulated endpoints.
+ */
+
+#ifndef BROKER_LIST_H
+#define BROKER_LIST_H
+
+#include <stdint.h>
+
+#ifndef BROKER_LIST_MAX
+#define BROKER_LIST_MAX 4
+#endif
+
+// Assumed connect time for an endpoint that has not been measured yet
+#ifndef BROKER_UNMEASURED_MS
+#define BROKER_UNMEASURED_MS 3000
+#endif
+
+// Score penalty per consecutive failure
+#ifndef BROKER_FAILURE_PENALTY_MS
+#define BROKER_FAILURE_PENALTY_MS 5000
+#endif
+
+// Cooldown after the first failure, doubled per further failure
+#ifndef BROKER_COOLDOWN_MS
+#define BROKER_COOLDOWN_MS 5000
+#endif
+
+#ifndef BROKER_COOLDOWN_MAX_MS
+#define BROKER_COOLDOWN_MAX_MS 300000
+#endif
+
+#define BROKER_HOST_LEN 64
+
+struct BrokerEndpoint
+{
+    char host[BROKER_HOST_LEN];
+    int port;
+    uint32_t avgConnectMs;      // moving average of successful connects
+    uint8_t failures;           // consecutive failures
+    uint32_t cooldownUntil;     // millis() before which the endpoint is skipped
+    bool measured;
+};
+
+/**
+ * Build the list from the primary broker and an optional "host[:port],..."
+ * list. Entries without a port use the primary port. Returns the count.
+ */
+int BrokerList_Init(const char* primaryHost, int primaryPort, const char* extraList);
+
+int BrokerList_Count();
+
+const BrokerEndpoint* BrokerList_Get(int index);
+
+/**
+ * Health score of an endpoint (lower is better)
+ */
+uint32_t BrokerList_Score(const BrokerEndpoint* endpoint);
+
+/**
+ * True if the endpoint failed recently and its cooldown has not expired
+ */
+bool BrokerList_IsCoolingDown(int index, uint32_t now);
+
+/**
+ * Index of the best endpoint at time now. Endpoints in cooldown are only
+ * chosen when every endpoint is cooling down, in which case the one that
+ * becomes available first is returned. Ties go to the earlier entry.
+ * exclude (bit per index) skips endpoints already tried in this round.
+ */
+int BrokerList_Select(uint32_t now, uint32_t exclude = 0);
+
+void BrokerList_ReportSuccess(int index, uint32_t connectMs);
+
+void BrokerList_ReportFailure(int index, uint32_t now);
+
+#endif // BROKER_LIST_H
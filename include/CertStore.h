@@ -0,0 +1,44 @@
+/**
+ * @file CertStore.h
+ * @brief Validation of the TLS credentials
+ *
+ * The CA certificate, client certificate and private key are fetched from
+ * DeviceConfig and parsed once with mbedTLS, so a malformed credential is
+ * reported at startup instead of as a handshake failure on every broker.
+ *
+ * This is validation only; nothing parsed is kept. The framework's
+ * WiFiClientSecure only accepts PEM strings and parses them again on every
+ * handshake, and parsed mbedTLS objects cannot be handed to it, so neither
+ * the handshake time nor its transient heap use changes.
+ *
+ * A failed check is remembered together with a checksum of the PEM text.
+ * Later loads only parse again once the stored credentials have changed.
+ */
+
+#ifndef CERT_STORE_H
+#define CERT_STORE_H
+
+/**
+ * Load and validate the credentials required by the active profile.
+ * Returns false if a required certificate or key is missing or malformed.
+ * After a failure the credentials are only parsed again once their text
+ * has changed.
+ */
+bool CertStore_Load();
+
+/**
+ * Incremented on every successful load; callers compare it against the
+ * generation they last applied to decide whether to reconfigure the client.
+ */
+unsigned int CertStore_GetGeneration();
+
+const char* CertStore_GetCACert();
+const char* CertStore_GetClientCert();
+const char* CertStore_GetClientKey();
+
+/**
+ * Time spent parsing the credentials in the last load (milliseconds).
+ */
+unsigned long CertStore_GetParseTimeMs();
+
+#endif // CERT_STORE_H
@@ -0,0 +1,84 @@
+/**
+ * @file ConfigCache.h
+ * @brief RAM copy of the device settings used on the connect path
+ *
+ * The Wi-Fi credentials, broker endpoint, device ID and device password
+ * are read from DeviceConfig once and packed into a single string pool.
+ * Reads return pointers into the pool, so reconnects no longer read the
+ * settings storage (and no longer need a 680-byte stack buffer for the
+ * password). A CRC-32 over the pool is checked before each connect and
+ * the settings are read again if it does not match. Code that saves
+ * settings invalidates the copy.
+ *
+ * With CONFIG_CACHE set to 0 every read goes to DeviceConfig, which gives
+ * the uncached reconnect latency for comparison.
+ */
+
+#ifndef CONFIG_CACHE_H
+#define CONFIG_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef CONFIG_CACHE
+#define CONFIG_CACHE 1
+#endif
+
+// Room for all cached strings, including their terminators
+#ifndef CONFIG_CACHE_POOL_SIZE
+#define CONFIG_CACHE_POOL_SIZE 1024
+#endif
+
+// Longest device password DeviceConfig can hold, including the terminator
+#define CONFIG_PASSWORD_SIZE 680
+
+enum ConfigField
+{
+    CONFIG_WIFI_SSID,
+    CONFIG_WIFI_PASSWORD,
+    CONFIG_BROKER_HOST,
+    CONFIG_DEVICE_ID,
+    CONFIG_DEVICE_PASSWORD,     // empty on the mutual TLS profile
+    CONFIG_FIELD_COUNT
+};
+
+struct ConfigCacheStats
+{
+    uint32_t loads;             // full reads of the settings
+    uint32_t reads;             // ConfigCache_Get() calls
+    uint32_t checks;            // checksum verifications
+    uint32_t corruptions;       // checksum mismatches
+    uint32_t invalidations;
+    uint32_t loadUs;            // duration of the last load
+    uint16_t poolUsed;          // bytes of the pool in use
+    bool truncated;             // a setting did not fit and was cut short
+};
+
+/**
+ * Read all settings into the pool. Returns immediately if the copy is
+ * valid. Returns false if a setting had to be truncated.
+ */
+bool ConfigCache_Load();
+
+/**
+ * Drop the copy; the next read loads the settings again. Call after any
+ * DeviceConfig_Save().
+ */
+void ConfigCache_Invalidate();
+
+/**
+ * Check the pool against its checksum and reload it on a mismatch.
+ * Returns false if it was corrupt.
+ */
+bool ConfigCache_Verify();
+
+/**
+ * Setting value; never NULL
+ */
+const char* ConfigCache_Get(ConfigField field);
+
+int ConfigCache_GetBrokerPort();
+
+const ConfigCacheStats* ConfigCache_GetStats();
+
+#endif // CONFIG_CACHE_H
@@ -0,0 +1,90 @@
+/**
+ * @file ConnStats.h
+ * @brief Per-phase timing of MQTT connection attempts
+ *
+ * Each attempt is split into reading the device settings, DNS, transport
+ * (TCP, plus the TLS handshake on secure profiles) and MQTT CONNECT/CONNACK.
+ * The last CONN_STATS_HISTORY attempts are kept in RAM and formatted as a
+ * JSON summary once connected.
+ */
+
+#ifndef CONN_STATS_H
+#define CONN_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONN_STATS_HISTORY
+#define CONN_STATS_HISTORY 8
+#endif
+
+enum ConnPhase
+{
+    CONN_PHASE_CONFIG = 0,
+    CONN_PHASE_DNS,
+    CONN_PHASE_TRANSPORT,
+    CONN_PHASE_MQTT,
+    CONN_PHASE_COUNT
+};
+
+struct ConnAttempt
+{
+    uint32_t startMs;                       // millis() at attempt start
+    uint32_t phaseUs[CONN_PHASE_COUNT];     // duration of each phase
+    int8_t broker;                          // BrokerList index
+    int8_t failedPhase;                     // -1 on success
+    int16_t error;                          // transport result or MQTT state
+};
+
+/**
+ * Start timing a new connection attempt to the given broker
+ */
+void ConnStats_BeginAttempt(int broker = 0);
+
+/**
+ * Mark the start of a phase within the current attempt
+ */
+void ConnStats_PhaseStart(ConnPhase phase);
+
+/**
+ * Mark the end of a phase. A non-zero error closes the attempt as failed
+ * in that phase.
+ */
+void ConnStats_PhaseEnd(ConnPhase phase, int error = 0);
+
+/**
+ * Close the current attempt as successful
+ */
+void ConnStats_EndAttempt();
+
+/**
+ * Most recent attempt, or NULL if none has been recorded
+ */
+const ConnAttempt* ConnStats_GetLast();
+
+const char* ConnStats_PhaseName(int phase);
+
+/**
+ * True if attempts have been recorded since the last summary
+ */
+bool ConnStats_HasUnreported();
+
+/**
+ * Format the unreported attempts as JSON. Returns the number of characters
+ * written (0 if nothing to report). The attempts stay unreported until
+ * ConnStats_MarkReported(), so a failed publish sends them again.
+ */
+size_t ConnStats_FormatSummary(char* buf, size_t size);
+
+/**
+ * Mark the attempts in the last formatted summary as reported; call once
+ * it has been published
+ */
+void ConnStats_MarkReported();
+
+/**
+ * Log the most recent attempt
+ */
+void ConnStats_PrintLast();
+
+#endif // CONN_STATS_H
@@ -0,0 +1,62 @@
+/**
+ * @file DisplayModel.h
+ * @brief Line model of the OLED with dirty tracking and a refresh cap
+ *
+ * Callers set line text in RAM, which is cheap and never touches I2C.
+ * Display_Refresh() pushes only lines whose text changed since they were
+ * last drawn, and no more often than DISPLAY_MIN_REFRESH_MS, so frequent
+ * updates from the telemetry path coalesce into one transfer. Lines are
+ * padded to the full width so no clear of the screen is needed.
+ */
+
+#ifndef DISPLAY_MODEL_H
+#define DISPLAY_MODEL_H
+
+#include <stdint.h>
+
+#define DISPLAY_LINES 4
+#define DISPLAY_COLS 16
+
+// Refresh() result when nothing is waiting to be drawn
+#define DISPLAY_IDLE 0xFFFFFFFFu
+
+#ifndef DISPLAY_MIN_REFRESH_MS
+#define DISPLAY_MIN_REFRESH_MS 250
+#endif
+
+struct DisplayStats
+{
+    uint32_t updates;           // line changes requested
+    uint32_t refreshes;         // Refresh() calls that drew something
+    uint32_t linesDrawn;
+    uint32_t linesSkipped;      // set again with unchanged text
+    uint32_t maxRefreshUs;      // longest single refresh
+};
+
+/**
+ * Draws one line of exactly DISPLAY_COLS characters
+ */
+typedef void (*DisplayWriteFn)(int line, const char* text);
+
+void Display_Init(DisplayWriteFn write);
+
+/**
+ * Set one line; NULL clears it. Text beyond DISPLAY_COLS is cut off.
+ */
+void Display_SetLine(int line, const char* text);
+
+/**
+ * Set the first three lines and clear the rest
+ */
+void Display_SetLines(const char* line1, const char* line2, const char* line3);
+
+/**
+ * Draw changed lines if the refresh interval allows it (or always when
+ * force is set). Returns milliseconds until changed lines can be drawn,
+ * 0 if a call now would draw, or DISPLAY_IDLE if nothing is pending.
+ */
+uint32_t Display_Refresh(bool force = false);
+
+const DisplayStats* Display_GetStats();
+
+#endif // DISPLAY_MODEL_H
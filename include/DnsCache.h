@@ -0,0 +1,70 @@
+/**
+ * @file DnsCache.h
+ * @brief Broker hostname cache with expiry and background refresh
+ *
+ * Resolved addresses are reused for DNS_CACHE_TTL_MS so immediate reconnects
+ * skip the lookup. Entries close to expiry can be refreshed ahead of time,
+ * and an address that fails to connect is dropped so the next attempt
+ * resolves again. The cache does no lookups itself: the application
+ * installs the network resolver, and the tests a stub.
+ */
+
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stddef.h>
+
+#ifndef DNS_CACHE_ENTRIES
+#define DNS_CACHE_ENTRIES 4
+#endif
+
+// The network stack does not expose record TTLs, so a fixed lifetime is used
+#ifndef DNS_CACHE_TTL_MS
+#define DNS_CACHE_TTL_MS 300000
+#endif
+
+// Refresh entries in the background once they are this close to expiry
+#ifndef DNS_CACHE_REFRESH_MS
+#define DNS_CACHE_REFRESH_MS 60000
+#endif
+
+// Minimum spacing between background refresh attempts for one entry
+#ifndef DNS_CACHE_RETRY_MS
+#define DNS_CACHE_RETRY_MS 10000
+#endif
+
+#define DNS_CACHE_HOST_LEN 64
+#define DNS_CACHE_ADDR_LEN 48
+
+/**
+ * Resolver callback: write the address of host as a string into addr.
+ * Returns 0 on success, a negative error otherwise.
+ */
+typedef int (*DnsResolveFn)(const char* host, char* addr, size_t size);
+
+/**
+ * Set the resolver used for lookups. Until one is set, every lookup fails.
+ */
+void DnsCache_SetResolver(DnsResolveFn resolver);
+
+/**
+ * Resolve host, serving a fresh cached entry when possible. If a lookup
+ * fails, an expired (but not failed) entry is served instead.
+ * Returns 0 on success, the resolver error otherwise. fromCache is optional.
+ */
+int DnsCache_Resolve(const char* host, char* addr, size_t size, bool* fromCache = NULL);
+
+/**
+ * Report that connecting to the cached address of host failed; the entry is
+ * discarded so the next resolve performs a fresh lookup.
+ */
+void DnsCache_ReportFailure(const char* host);
+
+/**
+ * Refresh at most one entry that is close to expiry; returns true if a
+ * lookup was performed. The lookup blocks the caller for one round trip to
+ * the DNS server.
+ */
+bool DnsCache_Refresh();
+
+#endif // DNS_CACHE_H
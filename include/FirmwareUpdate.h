@@ -0,0 +1,125 @@
+/**
+ * @file FirmwareUpdate.h
+ * @brief Over-the-air firmware update from chunked MQTT transfers
+ *
+ * An update is started by a JSON manifest on the OTA topic:
+ *
+ *   {"id":12,"size":412345,"sha256":"<64 hex chars>","sig":"<hex>"}
+ *
+ * id must be 0..65535, as it names the BlobTransfer that carries the image.
+ * sig is a DER-encoded ECDSA (or RSA PKCS#1 v1.5) signature over the
+ * SHA-256 of the text "<id>:<size>:<sha256>", with the values exactly as
+ * they appear in the manifest. It is checked against OTA_PUBLIC_KEY before
+ * anything is erased.
+ *
+ * Once the manifest is accepted, the first erase block is erased and
+ * "armed" is reported. The image
+ * arrives as a BlobTransfer of kind BLOB_KIND_FIRMWARE with the same id,
+ * and chunks are programmed into the inactive OTA partition as they arrive.
+ * FirmwareUpdate_Poll() keeps the next block erased ahead of the write
+ * position, one block per call, so erasing is spread over the transfer and
+ * the MQTT connection is serviced between blocks. A chunk that reaches an
+ * unerased block erases it first and counts an erase stall. The SHA-256 is
+ * computed incrementally; when it matches the manifest the bootloader is
+ * told to switch to the new image on the next reset.
+ *
+ * All flash access goes through a FirmwareFlashPort. The MiCO partition
+ * port lives in FirmwareFlash.cpp, apart from the update state
+ * machine, which the native tests run against a RAM port.
+ */
+
+#ifndef FIRMWARE_UPDATE_H
+#define FIRMWARE_UPDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLOB_KIND_FIRMWARE 1
+
+// Erase block of the device port; the OTA partition is erased ahead of the
+// writes in blocks of this size
+#ifndef FW_ERASE_BLOCK_SIZE
+#define FW_ERASE_BLOCK_SIZE 0x20000
+#endif
+
+// Manifests must be signed with the key whose public half is OTA_PUBLIC_KEY
+// (DER SubjectPublicKeyInfo in hex). Without a key every manifest is
+// rejected. Set OTA_REQUIRE_SIGNATURE to 0 to accept unsigned manifests,
+// e.g. on a development bench; anyone who can publish to the OTA topic can
+// then install firmware.
+#ifndef OTA_REQUIRE_SIGNATURE
+#define OTA_REQUIRE_SIGNATURE 1
+#endif
+
+#ifndef OTA_PUBLIC_KEY
+#define OTA_PUBLIC_KEY ""
+#endif
+
+// Largest public key and signature accepted (RSA-2048 needs 294 and 256)
+#ifndef OTA_KEY_MAX_BYTES
+#define OTA_KEY_MAX_BYTES 320
+#endif
+
+#ifndef OTA_SIG_MAX_BYTES
+#define OTA_SIG_MAX_BYTES 256
+#endif
+
+/**
+ * Flash holding the incoming image. An image is programmed in order from
+ * offset 0, each range after it was erased. activate() is called once the
+ * image is complete and its SHA-256 matches; it hands the image to the
+ * bootloader for the next reset.
+ */
+struct FirmwareFlashPort
+{
+    uint32_t eraseBlockSize;
+    uint32_t (*regionSize)();
+    bool (*erase)(uint32_t offset, uint32_t length);
+    bool (*program)(uint32_t offset, const uint8_t* data, size_t length);
+    bool (*activate)(uint32_t imageSize);
+};
+
+struct FirmwareUpdateStats
+{
+    uint32_t bytesWritten;
+    uint32_t elapsedMs;         // first chunk to completion
+    uint32_t eraseMs;           // total time spent erasing
+    uint32_t eraseStalls;       // chunks that had to wait for an erase
+    uint32_t programMs;         // total time spent programming
+    uint32_t heapPeak;          // most heap in use above the level at the manifest
+};
+
+/**
+ * Status reporter (JSON), published on the OTA status topic
+ */
+typedef bool (*FirmwareStatusFn)(const char* json);
+
+/**
+ * Register the blob sink and the status reporter, writing through port
+ */
+void FirmwareUpdate_Init(FirmwareStatusFn status, const FirmwareFlashPort* port);
+
+/**
+ * Handle an OTA manifest (TopicHandler signature)
+ */
+void FirmwareUpdate_OnManifest(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+
+/**
+ * Erase the next block of an accepted update, if it is not erased ahead of
+ * the writes yet. Call from the main loop.
+ */
+void FirmwareUpdate_Poll();
+
+/**
+ * True once a verified image is waiting for a reboot
+ */
+bool FirmwareUpdate_IsPendingReboot();
+
+const FirmwareUpdateStats* FirmwareUpdate_GetStats();
+
+/**
+ * The MiCO OTA partition (FirmwareFlash.cpp, device builds only)
+ */
+const FirmwareFlashPort* FirmwareFlash_GetDevicePort();
+
+#endif // FIRMWARE_UPDATE_H
@@ -0,0 +1,115 @@
+/**
+ * @file HealthMonitor.h
+ * @brief Loop-time budget and task-supervised hardware watchdog
+ *
+ * Each thread of work registers with a timeout and checks in as it makes
+ * progress. A timer interrupt checks every HEALTH_CHECK_MS that all tasks
+ * have checked in within their timeouts and only then feeds the independent
+ * watchdog (IWDG). When a task misses its timeout the interrupt records the
+ * task, what it was doing and the uptime in the RTC backup registers and
+ * stops feeding, so the IWDG resets the device and the record can be
+ * reported after the reboot. The IWDG runs from its own oscillator, so the
+ * reset still happens if the core is stuck with interrupts disabled,
+ * although then no record is written.
+ *
+ * Separately, each run of the main loop is timed against
+ * HEALTH_LOOP_BUDGET_MS; overruns are counted together with the task that
+ * took longest, to find code paths that block.
+ */
+
+#ifndef HEALTH_MONITOR_H
+#define HEALTH_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Start the IWDG. With 0 stalls are still detected and reported, but the
+// device is not reset.
+#ifndef HEALTH_WATCHDOG
+#define HEALTH_WATCHDOG 1
+#endif
+
+// IWDG timeout. Must outlast the longest stretch with the flash bus stalled
+// (a 128 KB sector erase takes up to 2 s).
+#ifndef HEALTH_IWDG_TIMEOUT_MS
+#define HEALTH_IWDG_TIMEOUT_MS 8000
+#endif
+
+#ifndef HEALTH_CHECK_MS
+#define HEALTH_CHECK_MS 500
+#endif
+
+#ifndef HEALTH_LOOP_BUDGET_MS
+#define HEALTH_LOOP_BUDGET_MS 100
+#endif
+
+#ifndef HEALTH_MAX_TASKS
+#define HEALTH_MAX_TASKS 6
+#endif
+
+#define HEALTH_NAME_LEN 8
+
+/**
+ * Optional description of what a task is doing, sampled when it stalls
+ * (called from interrupt context)
+ */
+typedef const char* (*HealthActivityFn)();
+
+struct HealthStall
+{
+    bool valid;                 // the previous run ended in a stall
+    uint8_t task;               // task id
+    char name[HEALTH_NAME_LEN + 1];
+    char activity[HEALTH_NAME_LEN + 1];
+    uint32_t uptimeS;           // uptime when the stall was detected
+    uint32_t count;             // stalls since the backup domain was reset
+};
+
+struct HealthStats
+{
+    uint32_t loops;             // timed loop runs
+    uint32_t overruns;          // runs over HEALTH_LOOP_BUDGET_MS
+    uint32_t maxLoopMs;
+    const char* maxLoopTask;    // slowest task in the longest run
+    uint32_t feeds;             // IWDG refreshes
+    bool stalled;               // a stall was detected; no longer feeding
+};
+
+/**
+ * Read and clear the stall record from the previous run, then start the
+ * watchdog and the check-in timer. Call first thing in setup().
+ */
+void Health_Init();
+
+/**
+ * Register a task that must check in at least every timeoutMs. Tasks are
+ * registered from setup() and never removed. Returns the id, or -1 if the
+ * table is full.
+ */
+int Health_Register(const char* name, uint32_t timeoutMs, HealthActivityFn activity = NULL);
+
+/**
+ * Record progress; safe from any thread
+ */
+void Health_CheckIn(int id);
+
+/**
+ * Time one loop run. slowTask names the task that took longest in it.
+ */
+void Health_LoopBegin();
+void Health_LoopEnd(const char* slowTask);
+
+/**
+ * Stall record from before the last reset
+ */
+const HealthStall* Health_GetLastStall();
+
+const HealthStats* Health_GetStats();
+
+/**
+ * Format the loop and watchdog state as JSON. Returns the number of
+ * characters written, or 0 if it does not fit.
+ */
+size_t Health_FormatStats(char* buf, size_t size);
+
+#endif // HEALTH_MONITOR_H
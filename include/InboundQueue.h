@@ -0,0 +1,58 @@
+/**
+ * @file InboundQueue.h
+ * @brief Fixed-size pool and FIFO for inbound MQTT messages
+ *
+ * The MQTT callback only copies the message into a free pool slot, so the
+ * PubSubClient loop is not held up by slow handlers. Queued messages are
+ * dispatched to the TopicRouter from the main loop under a time budget.
+ */
+
+#ifndef INBOUND_QUEUE_H
+#define INBOUND_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef INBOUND_POOL_SIZE
+#define INBOUND_POOL_SIZE 4
+#endif
+
+// Topic plus payload; matches the MQTT buffer size set in connectMQTT()
+#ifndef INBOUND_SLOT_SIZE
+#define INBOUND_SLOT_SIZE 1024
+#endif
+
+struct InboundStats
+{
+    uint32_t received;          // messages offered to the queue
+    uint32_t dropped;           // rejected because the pool was full
+    uint32_t oversize;          // rejected because they exceed a slot
+    uint32_t processed;         // dispatched to handlers
+    uint32_t unrouted;          // processed without a matching handler
+    uint32_t maxLatencyMs;      // longest enqueue-to-dispatch time
+    uint32_t totalLatencyMs;    // for the average over processed
+    uint8_t depth;              // currently queued
+    uint8_t highWater;          // deepest queue seen
+};
+
+/**
+ * Copy a message into the pool. Returns false (and counts a drop) if no
+ * slot is free or the message does not fit.
+ */
+bool InboundQueue_Push(const char* topic, const uint8_t* payload, unsigned int length);
+
+/**
+ * Dispatch queued messages until the queue is empty or budgetMs has been
+ * spent. At least one message is processed per call if any is queued.
+ * Returns the number of messages processed.
+ */
+int InboundQueue_Process(uint32_t budgetMs);
+
+const InboundStats* InboundQueue_GetStats();
+
+/**
+ * Format the statistics as JSON. Returns the number of characters written.
+ */
+size_t InboundQueue_FormatStats(char* buf, size_t size);
+
+#endif // INBOUND_QUEUE_H
@@ -0,0 +1,37 @@
+/**
+ * @file JsonLite.h
+ * @brief Minimal readers for flat JSON command payloads
+ *
+ * Looks up top-level members of a single flat object by key without
+ * allocating or requiring NUL termination. Nested objects and arrays are
+ * skipped, not parsed.
+ */
+
+#ifndef JSON_LITE_H
+#define JSON_LITE_H
+
+#include <stddef.h>
+
+/**
+ * Read an integer member. Returns false if missing or not a number.
+ */
+bool Json_GetInt(const char* json, size_t length, const char* key, long* value);
+
+/**
+ * Read a number member (integer or decimal)
+ */
+bool Json_GetFloat(const char* json, size_t length, const char* key, float* value);
+
+/**
+ * Read a string member into out (escapes other than \" and \\ are kept
+ * verbatim). Returns false if missing, not a string, or too long for out.
+ */
+bool Json_GetString(const char* json, size_t length, const char* key, char* out, size_t size);
+
+/**
+ * Locate the raw text of a member value (object, array, string or literal).
+ * Returns a pointer into json and sets valueLength, or NULL if missing.
+ */
+const char* Json_GetRaw(const char* json, size_t length, const char* key, size_t* valueLength);
+
+#endif // JSON_LITE_H
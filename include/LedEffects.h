@@ -0,0 +1,63 @@
+/**
+ * @file LedEffects.h
+ * @brief Non-blocking RGB LED patterns and flashes
+ *
+ * A base pattern (solid, blink or pulse) shows the device state, and a
+ * short flash can be laid over it (e.g. on publish) without blocking the
+ * caller. LedEffects_Run() writes the colour due now and returns how long
+ * until the output next changes, so it can be driven by the scheduler
+ * instead of delay().
+ */
+
+#ifndef LED_EFFECTS_H
+#define LED_EFFECTS_H
+
+#include <stdint.h>
+
+// Run() result when the output will not change until a new pattern or flash
+#define LED_EFFECTS_IDLE 0xFFFFFFFFu
+
+// Update period while pulsing
+#ifndef LED_PULSE_STEP_MS
+#define LED_PULSE_STEP_MS 40
+#endif
+
+enum LedEffectKind
+{
+    LED_EFFECT_SOLID,
+    LED_EFFECT_BLINK,           // onMs at full colour, offMs dark
+    LED_EFFECT_PULSE            // ramps up over onMs, down over offMs
+};
+
+struct LedPattern
+{
+    uint8_t kind;               // LedEffectKind
+    uint8_t r, g, b;
+    uint16_t onMs;
+    uint16_t offMs;
+};
+
+/**
+ * Writes a colour to the LED
+ */
+typedef void (*LedOutputFn)(uint8_t r, uint8_t g, uint8_t b);
+
+void LedEffects_Init(LedOutputFn output);
+
+/**
+ * Show a base pattern. The pattern is referenced, not copied.
+ */
+void LedEffects_SetBase(const LedPattern* pattern);
+
+/**
+ * Show a colour for ms milliseconds, then return to the base pattern
+ */
+void LedEffects_Flash(uint8_t r, uint8_t g, uint8_t b, uint16_t ms);
+
+/**
+ * Write the colour due now. Returns milliseconds until the next change,
+ * or LED_EFFECTS_IDLE.
+ */
+uint32_t LedEffects_Run();
+
+#endif // LED_EFFECTS_H
@@ -0,0 +1,144 @@
+/**
+ * @file Log.h
+ * @brief Leveled serial logging through a RAM ring drained by a thread
+ *
+ * A log call formats its line on the caller's stack, copies it into a RAM
+ * ring and returns; a low-priority thread writes the ring to the
+ * framework's Serial port in the background. At 115200 baud a 400-byte
+ * line takes about 35 ms to send, which the caller no longer waits for.
+ * The copy into the ring runs in a short interrupts-off critical section,
+ * so any thread or interrupt may log. When a line does not fit, it is
+ * dropped whole and counted, and a note with the number of dropped lines
+ * goes out once there is room again.
+ *
+ * The port stays the framework's: a second serial object on the same pins
+ * would take over its UART interrupt. The drain thread waits for the UART
+ * byte by byte at low priority, so it only runs when no other thread has
+ * work, and the idle sleep is skipped while a backlog goes out.
+ *
+ * Lines below LOG_LEVEL are compiled out. Lines below the runtime level
+ * (LOG_RUNTIME_LEVEL, then the logLevel shadow property) are skipped
+ * before formatting.
+ *
+ * Output printed by the framework itself (driver messages through stdio)
+ * is still written directly and may interleave with queued lines.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+// Most detailed level compiled in
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Level in effect at startup
+#ifndef LOG_RUNTIME_LEVEL
+#define LOG_RUNTIME_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifndef LOG_THREAD_STACK
+#define LOG_THREAD_STACK 768
+#endif
+
+// Bytes handed to the port per write, so space in the ring frees up while
+// a long backlog drains
+#ifndef LOG_DRAIN_CHUNK
+#define LOG_DRAIN_CHUNK 64
+#endif
+
+// Ring size; a power of two
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 4096
+#endif
+
+// Longest wait for queued lines to go out before a reset
+#ifndef LOG_FLUSH_MS
+#define LOG_FLUSH_MS 500
+#endif
+
+// Longest line; longer ones are cut short and end in "..."
+#ifndef LOG_LINE_MAX
+#define LOG_LINE_MAX 256
+#endif
+
+struct LogStats
+{
+    uint32_t lines;             // lines queued
+    uint32_t bytes;             // bytes queued
+    uint32_t droppedLines;      // lines that did not fit in the ring
+    uint32_t droppedBytes;
+    uint32_t truncated;         // lines cut at LOG_LINE_MAX
+    uint32_t maxUsed;           // ring high-water mark in bytes
+};
+
+/**
+ * Start the drain thread. Lines logged before this are queued and sent
+ * once it runs.
+ */
+void Log_Init();
+
+void Log_SetLevel(int level);
+
+int Log_GetLevel();
+
+bool Log_Enabled(int level);
+
+/**
+ * Queue a formatted line (include the trailing newline). Never blocks.
+ */
+void Log_Printf(int level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Queue text as is. Never blocks.
+ */
+void Log_Write(int level, const char* text, size_t length);
+
+/**
+ * Wait up to timeoutMs for the ring to drain, e.g. before a reset.
+ * Returns true if it is empty.
+ */
+bool Log_Flush(uint32_t timeoutMs);
+
+const LogStats* Log_GetStats();
+
+/**
+ * Format the counters as compact JSON. Returns the number of characters
+ * written, or 0 if it does not fit.
+ */
+size_t Log_FormatStats(char* buf, size_t size);
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) do { if (Log_Enabled(LOG_LEVEL_ERROR)) Log_Printf(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) do { if (Log_Enabled(LOG_LEVEL_WARN)) Log_Printf(LOG_LEVEL_WARN, __VA_ARGS__); } while (0)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) do { if (Log_Enabled(LOG_LEVEL_INFO)) Log_Printf(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) do { if (Log_Enabled(LOG_LEVEL_DEBUG)) Log_Printf(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+#endif // LOG_H
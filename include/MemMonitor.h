@@ -0,0 +1,100 @@
+/**
+ * @file MemMonitor.h
+ * @brief Stack high-water marks and heap headroom
+ *
+ * Stacks are painted with a known pattern and later scanned from the
+ * bottom for the first overwritten word, which gives the deepest use since
+ * painting. The RTOS threads created by the application are painted by the
+ * RTOS itself and read through Thread::max_stack(); the main (network)
+ * thread and the interrupt stack are painted here at startup. The main
+ * thread's bounds come from its RTX control block, so it is only tracked
+ * on RTX5.
+ *
+ * The heap is sampled periodically: free bytes (the allocator's free
+ * lists plus the part of the heap region not yet handed out) and the
+ * contiguous space at the top of the heap. The allocator does not expose
+ * its largest free-list block, so the top space is a lower bound on the
+ * largest allocation that would succeed. The minimum of both since boot is
+ * kept. Short peaks such as the TLS handshake fall between samples, so the
+ * most heap ever in use is read from mbed's allocation statistics, which
+ * count every malloc (MBED_HEAP_STATS_ENABLED).
+ */
+
+#ifndef MEM_MONITOR_H
+#define MEM_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mbed.h"
+
+// Space left unpainted below the caller, for the painting code's own frames
+#define MEM_PAINT_GUARD 128
+
+#ifndef MEM_SAMPLE_MS
+#define MEM_SAMPLE_MS 1000
+#endif
+
+// Warn once when a stack's unused part or the heap falls below these
+#ifndef MEM_STACK_LOW_BYTES
+#define MEM_STACK_LOW_BYTES 256
+#endif
+
+#ifndef MEM_HEAP_LOW_BYTES
+#define MEM_HEAP_LOW_BYTES 8192
+#endif
+
+#ifndef MEM_MAX_STACKS
+#define MEM_MAX_STACKS 6
+#endif
+
+#define MEM_NAME_LEN 8
+
+struct MemStack
+{
+    char name[MEM_NAME_LEN + 1];
+    uint32_t size;              // bytes tracked
+    uint32_t maxUsed;           // high-water mark
+};
+
+struct MemStats
+{
+    uint32_t heapFree;          // at the last sample
+    uint32_t heapMinFree;
+    uint32_t heapTop;           // contiguous space at the top of the heap
+    uint32_t heapMinTop;
+    uint32_t heapSize;          // 0 if the heap bounds are not known
+    uint32_t heapPeak;          // most bytes ever allocated, 0 without heap stats
+    uint32_t allocFailures;     // failed allocations, 0 without heap stats
+    uint32_t samples;
+    uint32_t warnings;          // low-memory warnings printed
+};
+
+/**
+ * Paint the unused part of the calling thread's stack and the interrupt
+ * stack. Call first thing in setup(), before other threads start.
+ */
+void Mem_Init();
+
+/**
+ * Track an RTOS thread's stack through its own watermark
+ */
+void Mem_AddThread(const char* name, rtos::Thread* thread, uint32_t stackSize);
+
+/**
+ * Update the heap figures and stack high-water marks
+ */
+void Mem_Sample();
+
+int Mem_StackCount();
+
+const MemStack* Mem_GetStack(int index);
+
+const MemStats* Mem_GetStats();
+
+/**
+ * Format as compact JSON: the heap figures, then [size, max used] per
+ * stack. Returns the number of characters written, or 0 if it does not fit.
+ */
+size_t Mem_FormatStats(char* buf, size_t size);
+
+#endif // MEM_MONITOR_H
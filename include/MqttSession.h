@@ -0,0 +1,110 @@
+/**
+ * @file MqttSession.h
+ * @brief Persistent MQTT session tracking
+ *
+ * With clean session off the broker keeps the device's subscriptions and
+ * queues QoS 1 messages while it is offline. PubSubClient does not expose
+ * the CONNACK session-present flag, so SessionClient sits between it and
+ * the network client and picks the flag out of the CONNACK as it is read.
+ * When the session survived a reconnect, the resubscribe round trip can be
+ * skipped.
+ *
+ * The time from CONNACK to the first inbound message is recorded for each
+ * connection; on a resumed session that is usually a message the broker
+ * queued while the device was offline. SessionClient follows the packet
+ * framing of everything read after the CONNACK, so SUBACKs (which
+ * PubSubClient discards) are counted as well, timing the subscribe round
+ * trip.
+ */
+
+#ifndef MQTT_SESSION_H
+#define MQTT_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <Client.h>
+
+// Messages arriving this soon after CONNACK count as part of the backlog
+// the broker delivers on reconnect
+#ifndef MQTT_SESSION_BURST_MS
+#define MQTT_SESSION_BURST_MS 1000
+#endif
+
+struct MqttSessionStats
+{
+    uint32_t connects;          // successful CONNECTs
+    uint32_t resumed;           // ... with the session still present
+    uint32_t resubscribes;      // subscriptions sent after connecting
+    int32_t firstMessageMs;     // CONNACK to first message, -1 if none yet
+    uint32_t burstMessages;     // received within MQTT_SESSION_BURST_MS
+    bool sessionPresent;        // flag from the last CONNACK
+    uint32_t subacks;           // SUBACKs for sent SUBSCRIBE packets
+    int32_t subackMs;           // first SUBSCRIBE to last SUBACK, -1 while pending
+};
+
+/**
+ * Pass-through Client that follows the packets read after
+ * MqttSession_BeginConnect()
+ */
+class SessionClient : public Client
+{
+public:
+    SessionClient(Client& client) : _client(client) {}
+
+    int connect(IPAddress ip, uint16_t port) { return _client.connect(ip, port); }
+    int connect(const char* host, uint16_t port) { return _client.connect(host, port); }
+    size_t write(uint8_t b) { return _client.write(b); }
+    size_t write(const uint8_t* buf, size_t size) { return _client.write(buf, size); }
+    int available() { return _client.available(); }
+    int read();
+    int read(uint8_t* buf, size_t size);
+    int peek() { return _client.peek(); }
+    void flush() { _client.flush(); }
+    void stop() { _client.stop(); }
+    uint8_t connected() { return _client.connected(); }
+    operator bool() { return (bool)_client; }
+
+private:
+    Client& _client;
+};
+
+/**
+ * Arm CONNACK inspection. Call right before PubSubClient::connect().
+ */
+void MqttSession_BeginConnect();
+
+/**
+ * Record a successful connection. Returns true if the broker still held
+ * the session (subscriptions and queued messages).
+ */
+bool MqttSession_OnConnected();
+
+/**
+ * Count a subscription round trip sent after connecting
+ */
+void MqttSession_OnResubscribe();
+
+/**
+ * Note SUBSCRIBE packets written to the transport; their SUBACKs are
+ * counted as they are read
+ */
+void MqttSession_OnSubscribeSent(uint32_t packets);
+
+/**
+ * SUBACKs still outstanding on this connection
+ */
+uint32_t MqttSession_SubacksPending();
+
+/**
+ * Note an inbound message (call from the MQTT callback)
+ */
+void MqttSession_OnMessage();
+
+const MqttSessionStats* MqttSession_GetStats();
+
+/**
+ * Format the statistics as JSON. Returns the number of characters written.
+ */
+size_t MqttSession_FormatStats(char* buf, size_t size);
+
+#endif // MQTT_SESSION_H
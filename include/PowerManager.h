@@ -0,0 +1,57 @@
+/**
+ * @file PowerManager.h
+ * @brief Low-power idle between scheduled tasks, with duty-cycle accounting
+ *
+ * When POWER_SAVE is enabled the RTOS idle thread executes WFI, so the core
+ * sleeps whenever no thread is runnable and wakes on the next interrupt:
+ * the RTOS tick, a timer, or the Wi-Fi interface. The Wi-Fi module and its
+ * SDIO link stay powered so the MQTT session and keepalive are unaffected;
+ * STOP mode is not used because it would drop the link.
+ *
+ * Time spent asleep and the number of wakes are measured per reporting
+ * window, giving the duty cycle needed to estimate battery life for a
+ * given send interval and poll rate.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef POWER_SAVE
+#define POWER_SAVE 1
+#endif
+
+struct PowerStats
+{
+    uint32_t windowMs;          // length of the current window
+    uint32_t sleepMs;           // time in WFI during the window
+    uint32_t wakes;             // WFI exits during the window
+    uint32_t idleCalls;         // Power_Idle() calls during the window
+    uint32_t idleRequestedMs;   // idle time the scheduler asked for
+};
+
+/**
+ * Install the idle hook (no-op unless POWER_SAVE)
+ */
+void Power_Init();
+
+/**
+ * Give up the CPU for ms milliseconds. The calling thread blocks, so the
+ * idle thread runs and the core sleeps until the wait expires.
+ */
+void Power_Idle(uint32_t ms);
+
+/**
+ * Statistics for the current window
+ */
+const PowerStats* Power_GetStats();
+
+/**
+ * Format the current window as JSON and start a new one. Returns the
+ * number of characters written.
+ */
+size_t Power_FormatStats(char* buf, size_t size);
+
+#endif // POWER_MANAGER_H
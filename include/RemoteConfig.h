@@ -0,0 +1,107 @@
+/**
+ * @file RemoteConfig.h
+ * @brief Runtime application settings with remote updates
+ *
+ * Holds the settings the application reads on the hot path (send interval,
+ * topics, sensor mask). They are seeded from DeviceConfig at boot and can
+ * be changed at runtime by a JSON message on the config topic:
+ *
+ *   {"sendInterval":10,"publishTopic":"a/b","subscribeTopic":"c/d","sensorMask":7}
+ *
+ * Every field is optional. The whole message is validated first and then
+ * staged; RemoteConfig_Poll() swaps it in atomically outside the MQTT
+ * dispatch path and notifies the application. Changes are written back to
+ * EEPROM lazily, once no further changes have arrived for
+ * REMOTE_CONFIG_PERSIST_DELAY_MS, and only for fields that differ from
+ * what is stored.
+ */
+
+#ifndef REMOTE_CONFIG_H
+#define REMOTE_CONFIG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define REMOTE_CONFIG_TOPIC_LEN 128
+
+// Sensor groups in the telemetry payload
+#define SENSOR_TEMPERATURE      0x01
+#define SENSOR_HUMIDITY         0x02
+#define SENSOR_PRESSURE         0x04
+#define SENSOR_ACCELEROMETER    0x08
+#define SENSOR_GYROSCOPE        0x10
+#define SENSOR_MAGNETOMETER     0x20
+#define SENSOR_MASK_ALL         0x3F
+
+#ifndef REMOTE_CONFIG_PERSIST_DELAY_MS
+#define REMOTE_CONFIG_PERSIST_DELAY_MS 60000
+#endif
+
+#ifndef REMOTE_CONFIG_MAX_INTERVAL_S
+#define REMOTE_CONFIG_MAX_INTERVAL_S 86400
+#endif
+
+struct RuntimeConfig
+{
+    uint32_t sendIntervalS;
+    uint32_t sensorMask;
+    char publishTopic[REMOTE_CONFIG_TOPIC_LEN];
+    char subscribeTopic[REMOTE_CONFIG_TOPIC_LEN];
+};
+
+struct RemoteConfigStats
+{
+    uint32_t applied;           // updates applied
+    uint32_t rejected;          // updates that failed validation
+    uint32_t lastApplyUs;       // message received to settings live
+    uint32_t maxApplyUs;
+    uint32_t eepromWrites;      // settings written back to EEPROM
+    bool persistPending;
+};
+
+/**
+ * Called after a staged update is applied, with the previous settings
+ */
+typedef void (*RemoteConfigAppliedFn)(const RuntimeConfig* previous, const RuntimeConfig* current);
+
+/**
+ * Reports the outcome of an update (JSON) on the config status topic
+ */
+typedef bool (*RemoteConfigStatusFn)(const char* json);
+
+/**
+ * Seed the settings from DeviceConfig
+ */
+void RemoteConfig_Init(RemoteConfigAppliedFn applied, RemoteConfigStatusFn status);
+
+/**
+ * Active settings. The pointer stays valid; contents change only inside
+ * RemoteConfig_Poll().
+ */
+const RuntimeConfig* RemoteConfig_Get();
+
+/**
+ * Handle a config update (TopicHandler signature)
+ */
+void RemoteConfig_OnMessage(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+
+/**
+ * Stage a new send interval (e.g. from the device shadow). Returns false if
+ * it is out of range.
+ */
+bool RemoteConfig_SetSendInterval(uint32_t seconds);
+
+/**
+ * Apply a staged update and write pending changes back to EEPROM when due.
+ * Call from the main loop, outside message dispatch.
+ */
+void RemoteConfig_Poll();
+
+/**
+ * Write pending changes to EEPROM now (e.g. before a reboot)
+ */
+void RemoteConfig_Flush();
+
+const RemoteConfigStats* RemoteConfig_GetStats();
+
+#endif // REMOTE_CONFIG_H
@@ -0,0 +1,91 @@
+/**
+ * @file Scheduler.h
+ * @brief Deadline-ordered cooperative task scheduler
+ *
+ * Periodic tasks are kept in a binary min-heap ordered by their next
+ * deadline. Scheduler_RunDue() runs every task that is due and returns how
+ * long the caller may sleep before the next one. Time is a 64-bit
+ * millisecond count extended from the 32-bit clock, so deadlines stay
+ * ordered across the 49-day millis() wrap. The clock is pluggable, so the
+ * scheduler can be driven by a virtual clock.
+ *
+ * Tasks run to completion on the caller's stack and must not block.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 12
+#endif
+
+typedef void (*SchedulerTaskFn)(void* context);
+
+/**
+ * Millisecond clock; may wrap at 32 bits
+ */
+typedef uint32_t (*SchedulerClockFn)();
+
+struct SchedulerTaskInfo
+{
+    const char* name;
+    uint32_t periodMs;
+    uint32_t runs;
+    uint32_t maxRunUs;          // longest single run
+    uint32_t maxLateMs;         // longest delay past the deadline
+    uint64_t deadline;          // next run, in Scheduler_Now() time
+};
+
+/**
+ * Replace the clock (defaults to millis()). Call before adding tasks.
+ */
+void Scheduler_SetClock(SchedulerClockFn clock);
+
+/**
+ * Current time in milliseconds, wrap-free
+ */
+uint64_t Scheduler_Now();
+
+/**
+ * Add a periodic task, first run after firstDelayMs. A period of 0 makes a
+ * one-shot task that only runs again via Scheduler_RunIn().
+ * Returns the task id, or -1 if the table is full.
+ */
+int Scheduler_Add(const char* name, SchedulerTaskFn fn, void* context, uint32_t periodMs, uint32_t firstDelayMs);
+
+/**
+ * Change a task's period; its next run is one new period from now
+ */
+void Scheduler_SetPeriod(int id, uint32_t periodMs);
+
+/**
+ * Run a task after delayMs instead of at its next deadline. May be called
+ * by the task itself (e.g. to back off after a failure).
+ */
+void Scheduler_RunIn(int id, uint32_t delayMs);
+
+/**
+ * Run every task that is due. Returns the milliseconds until the next
+ * deadline (0 if a task is already due again).
+ */
+uint32_t Scheduler_RunDue();
+
+int Scheduler_Count();
+
+/**
+ * Id of the task currently running, or -1 between tasks
+ */
+int Scheduler_Running();
+
+/**
+ * Id of the task that ran longest in the last Scheduler_RunDue() call, or
+ * -1 if none ran
+ */
+int Scheduler_LastSlowest();
+
+const SchedulerTaskInfo* Scheduler_GetInfo(int id);
+
+#endif // SCHEDULER_H
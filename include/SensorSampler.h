@@ -0,0 +1,47 @@
+/**
+ * @file SensorSampler.h
+ * @brief Sensor acquisition thread
+ *
+ * Reads all sensors every SENSOR_SAMPLE_MS on its own RTOS thread and
+ * publishes them to the SensorSnapshot, so a slow TLS write never delays
+ * sampling and sampling never stalls the MQTT connection. The sensors
+ * share the I2C bus with the OLED, so every read holds the bus mutex.
+ */
+
+#ifndef SENSOR_SAMPLER_H
+#define SENSOR_SAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mbed.h"
+
+#ifndef SENSOR_SAMPLE_MS
+#define SENSOR_SAMPLE_MS 1000
+#endif
+
+#ifndef SENSOR_THREAD_STACK
+#define SENSOR_THREAD_STACK 3072
+#endif
+
+// Reported to the health monitor as stalled after this long without a sample
+#ifndef SENSOR_STALL_MS
+#define SENSOR_STALL_MS (SENSOR_SAMPLE_MS * 10)
+#endif
+
+struct SensorSamplerStats
+{
+    uint32_t samples;           // readings taken
+    uint32_t failed;            // reads in which no sensor could be parsed
+    uint32_t maxReadUs;         // longest read incl. waiting for the bus
+    uint32_t stackSize;
+    uint32_t stackMaxUsed;      // high-water mark
+};
+
+/**
+ * Start the thread. i2c guards the bus shared with the display.
+ */
+void SensorSampler_Start(rtos::Mutex* i2c);
+
+const SensorSamplerStats* SensorSampler_GetStats();
+
+#endif // SENSOR_SAMPLER_H
@@ -0,0 +1,60 @@
+/**
+ * @file SensorSnapshot.h
+ * @brief Latest sensor readings shared through a seqlock
+ *
+ * The sampler thread is the only writer; any thread may read. A reader
+ * copies the readings and retries if the sequence number shows that a
+ * write overlapped the copy, so readers never block the writer, the writer
+ * never waits for readers, and no reader sees a half-written set. The
+ * writer runs at a higher priority than the readers, so a retry is rare and
+ * never spins for long.
+ *
+ * A set may be partial: a sensor that Sensors.toJson() leaves out is not
+ * marked present, and the other groups are still published.
+ */
+
+#ifndef SENSOR_SNAPSHOT_H
+#define SENSOR_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SensorReadings
+{
+    uint32_t takenAt;           // millis() when read
+    uint32_t sample;            // sample number, from 1
+    float temperature;          // °C
+    float humidity;             // %RH
+    float pressure;             // hPa
+    int32_t accel[3];           // x, y, z in the units of the telemetry payload
+    int32_t gyro[3];
+    int32_t mag[3];
+    uint32_t present;           // SENSOR_* bits of the groups that were read
+};
+
+struct SensorSnapshotStats
+{
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t retries;           // reads repeated because a write overlapped
+};
+
+/**
+ * Parse the JSON from Sensors.toJson() into r. Groups that are missing or
+ * malformed are left out of r->present. Returns false if none was read.
+ */
+bool SensorSnapshot_Parse(const char* json, size_t length, SensorReadings* r);
+
+/**
+ * Publish a new set of readings (single writer)
+ */
+void SensorSnapshot_Write(const SensorReadings* readings);
+
+/**
+ * Copy the latest readings. Returns false if nothing has been written yet.
+ */
+bool SensorSnapshot_Read(SensorReadings* out);
+
+const SensorSnapshotStats* SensorSnapshot_GetStats();
+
+#endif // SENSOR_SNAPSHOT_H
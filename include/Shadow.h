@@ -0,0 +1,106 @@
+/**
+ * @file Shadow.h
+ * @brief Device shadow: desired/reported state table with delta sync
+ *
+ * A small table of typed properties, each with a desired and a reported
+ * value. The backend sends desired changes as
+ *
+ *   {"version":12,"state":{"sendInterval":10,"ledMode":2}}
+ *
+ * to the desired topic; updates whose version is not newer than the last
+ * one applied are discarded as stale. Each property's apply callback decides
+ * whether the desired value takes effect, and accepted values become the
+ * reported value. Reported changes are coalesced: Shadow_Poll() publishes
+ * only the properties that changed since the last report, at most once per
+ * SHADOW_REPORT_MIN_MS, in one message of up to SHADOW_REPORT_MAX bytes.
+ * Changes that do not fit stay pending and go out in a follow-up message on
+ * the next poll. A property too long to report even on its own is dropped
+ * from the report and counted.
+ */
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SHADOW_MAX_PROPERTIES
+#define SHADOW_MAX_PROPERTIES 8
+#endif
+
+#ifndef SHADOW_REPORT_MIN_MS
+#define SHADOW_REPORT_MIN_MS 1000
+#endif
+
+// Largest reported-state message, including the terminating NUL
+#ifndef SHADOW_REPORT_MAX
+#define SHADOW_REPORT_MAX 256
+#endif
+
+enum ShadowType
+{
+    SHADOW_INT,
+    SHADOW_FLOAT,
+    SHADOW_BOOL
+};
+
+union ShadowValue
+{
+    int32_t i;
+    float f;
+    bool b;
+};
+
+struct ShadowStats
+{
+    uint32_t reports;           // reported-state messages published
+    uint32_t splits;            // reports that left changes for a follow-up
+    uint32_t dropped;           // properties too long for any report
+};
+
+/**
+ * Apply a desired value. Return false to reject it (the reported value is
+ * left unchanged).
+ */
+typedef bool (*ShadowApplyFn)(int index, ShadowValue value);
+
+/**
+ * Publish a reported-state message (JSON)
+ */
+typedef bool (*ShadowPublishFn)(const char* json);
+
+void Shadow_Init(ShadowPublishFn publish);
+
+/**
+ * Add a property. apply may be NULL for report-only properties.
+ * Returns the property index, or -1 if the table is full.
+ */
+int Shadow_Define(const char* name, ShadowType type, ShadowValue initial, ShadowApplyFn apply);
+
+ShadowValue Shadow_GetReported(int index);
+
+ShadowValue Shadow_GetDesired(int index);
+
+/**
+ * Record a device-side change of a reported value
+ */
+void Shadow_SetReported(int index, ShadowValue value);
+
+/**
+ * Handle a desired-state update (TopicHandler signature)
+ */
+void Shadow_OnDesired(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+
+/**
+ * Report every property on the next poll (e.g. after reconnecting)
+ */
+void Shadow_MarkAllDirty();
+
+/**
+ * Publish coalesced reported changes when due. Call from the main loop.
+ */
+void Shadow_Poll();
+
+const ShadowStats* Shadow_GetStats();
+
+#endif // SHADOW_H
@@ -0,0 +1,62 @@
+/**
+ * @file SpscRing.h
+ * @brief Lock-free single-producer, single-consumer ring buffer
+ *
+ * One thread pushes and one thread pops; neither ever blocks. Each index
+ * is written by one side only, and a memory barrier orders the slot copy
+ * against the index update, which is all the Cortex-M4 needs. Holds N - 1
+ * items.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "cmsis.h"
+
+template <typename T, unsigned N>
+class SpscRing
+{
+public:
+    SpscRing() : _head(0), _tail(0) {}
+
+    /**
+     * Producer side. Returns false if the ring is full.
+     */
+    bool push(const T& item)
+    {
+        unsigned head = _head;
+        unsigned next = (head + 1) % N;
+        if (next == _tail) return false;
+
+        _items[head] = item;
+        __DMB();
+        _head = next;
+        return true;
+    }
+
+    /**
+     * Consumer side. Returns false if the ring is empty.
+     */
+    bool pop(T* item)
+    {
+        unsigned tail = _tail;
+        if (tail == _head) return false;
+
+        __DMB();
+        *item = _items[tail];
+        __DMB();
+        _tail = (tail + 1) % N;
+        return true;
+    }
+
+    bool empty() const { return _tail == _head; }
+
+    unsigned size() const { return (_head + N - _tail) % N; }
+
+private:
+    T _items[N];
+    volatile unsigned _head;    // written by the producer only
+    volatile unsigned _tail;    // written by the consumer only
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,76 @@
+/**
+ * @file TimeSync.h
+ * @brief Non-blocking SNTP client
+ *
+ * Replaces the blocking SyncTime() call. TimeSync_Run() sends one SNTP
+ * request and returns; later runs poll the socket for the reply, so the
+ * network thread keeps running (and can resolve the broker or connect)
+ * while the request is in flight. A request that gets no reply within
+ * TIME_SYNC_TIMEOUT_MS is retried. After TIME_SYNC_ATTEMPTS failed requests
+ * without ever syncing the client reports that it gave up, so callers that
+ * can do without the clock go ahead; it keeps retrying every
+ * TIME_SYNC_RETRY_MS. Once synced the clock is refreshed every
+ * TIME_SYNC_RESYNC_MS.
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TIME_SYNC_SERVER
+#define TIME_SYNC_SERVER "pool.ntp.org"
+#endif
+
+#ifndef TIME_SYNC_TIMEOUT_MS
+#define TIME_SYNC_TIMEOUT_MS 2000
+#endif
+
+#ifndef TIME_SYNC_ATTEMPTS
+#define TIME_SYNC_ATTEMPTS 3
+#endif
+
+#ifndef TIME_SYNC_RETRY_MS
+#define TIME_SYNC_RETRY_MS 30000
+#endif
+
+#ifndef TIME_SYNC_RESYNC_MS
+#define TIME_SYNC_RESYNC_MS 86400000UL
+#endif
+
+// Socket poll interval while a request is in flight
+#ifndef TIME_SYNC_POLL_MS
+#define TIME_SYNC_POLL_MS 20
+#endif
+
+struct TimeSyncStats
+{
+    uint32_t requests;          // requests sent
+    uint32_t syncs;             // replies applied
+    uint32_t timeouts;          // requests without a reply
+    uint32_t lastRttMs;         // round trip of the last applied reply
+    uint32_t firstSyncMs;       // millis() of the first sync, 0 if none
+    int32_t lastStepS;          // clock correction applied by the last sync
+};
+
+/**
+ * Advance the sync: send a request when one is due, or check for the reply.
+ * Needs the network link. Returns the milliseconds until it should run again.
+ */
+uint32_t TimeSync_Run();
+
+/**
+ * True once the clock has been set from a server
+ */
+bool TimeSync_IsSynced();
+
+/**
+ * True if TIME_SYNC_ATTEMPTS requests failed before the clock was ever set.
+ * The clock is not valid then; cleared by the first successful sync.
+ */
+bool TimeSync_GaveUp();
+
+const TimeSyncStats* TimeSync_GetStats();
+
+#endif // TIME_SYNC_H
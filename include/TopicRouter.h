@@ -0,0 +1,66 @@
+/**
+ * @file TopicRouter.h
+ * @brief Topic-level trie routing inbound MQTT messages to handlers
+ *
+ * Patterns are split on '/' into a trie of statically allocated nodes, with
+ * MQTT '+' (single level) and '#' (remaining levels) wildcards. Nodes point
+ * into the registered pattern strings rather than copying them, so patterns
+ * must stay valid for as long as they are registered. Dispatch walks the
+ * inbound topic in place, visiting one node per level plus any wildcard
+ * branches, and calls every matching handler. Literal children are found
+ * through a hash index shared by all nodes, so the cost per level does not
+ * grow with the number of siblings at that level.
+ */
+
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TOPIC_ROUTER_MAX_NODES
+#define TOPIC_ROUTER_MAX_NODES 256
+#endif
+
+/** Slots in the literal child index; must exceed TOPIC_ROUTER_MAX_NODES */
+#ifndef TOPIC_ROUTER_INDEX_SIZE
+#define TOPIC_ROUTER_INDEX_SIZE (TOPIC_ROUTER_MAX_NODES * 2)
+#endif
+
+#ifndef TOPIC_ROUTER_MAX_HANDLERS
+#define TOPIC_ROUTER_MAX_HANDLERS 128
+#endif
+
+typedef void (*TopicHandler)(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+
+/**
+ * Remove all patterns and handlers
+ */
+void TopicRouter_Clear();
+
+/**
+ * Register handler for pattern (replacing any handler already registered for
+ * the same pattern). Returns false if the pattern is malformed or the node or
+ * handler pool is exhausted.
+ */
+bool TopicRouter_Add(const char* pattern, TopicHandler handler, void* context = NULL);
+
+/**
+ * Call every handler whose pattern matches topic. Returns the number of
+ * handlers called.
+ */
+int TopicRouter_Dispatch(const char* topic, const uint8_t* payload, unsigned int length);
+
+int TopicRouter_Count();
+
+const char* TopicRouter_GetPattern(int index);
+
+/**
+ * Encode an MQTT SUBSCRIBE packet for the registered patterns, starting at
+ * pattern *next. As many patterns as fit in size are included and *next is
+ * advanced past them; call again while *next < TopicRouter_Count() to
+ * subscribe the rest. Returns the packet length, 0 if nothing fits.
+ */
+size_t TopicRouter_BuildSubscribe(uint8_t* buf, size_t size, uint16_t packetId, uint8_t qos, int* next);
+
+#endif // TOPIC_ROUTER_H
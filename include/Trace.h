@@ -0,0 +1,125 @@
+/**
+ * @file Trace.h
+ * @brief Binary event trace in a RAM ring, dumped over MQTT on request
+ *
+ * Each event is a fixed 12-byte record: a microsecond timestamp, an event
+ * id and two arguments. Recording is an inline store into a ring of
+ * TRACE_RECORDS entries, about ten instructions, so it can stay on in the
+ * hot paths. The oldest records are overwritten.
+ *
+ * The timestamp is read straight from the 32-bit timer behind the mbed
+ * microsecond ticker, which keeps counting while the core sleeps in WFI
+ * (the DWT cycle counter does not). It wraps after about 71 minutes; the
+ * decoder unwraps it because the main loop records an event on every run.
+ *
+ * Only the network thread records, so the ring needs no locking.
+ *
+ * A dump is requested with {"trace":"dump"} on <subscribe topic>/trace
+ * ({"trace":"clear"} empties the ring). Recording pauses while the dump is
+ * sent in chunks of TRACE_CHUNK_RECORDS records, each with this header
+ * (little-endian):
+ *
+ *   0  u8   version (TRACE_FORMAT_VERSION)
+ *   1  u8   flags     TRACE_FLAG_LAST on the final chunk
+ *   2  u16  dump id
+ *   4  u16  chunk sequence number
+ *   6  u16  records in this chunk
+ *   8  u32  timestamp ticks per second
+ *  12  u32  records written since boot (older ones were overwritten)
+ *  16  ...  records, oldest first
+ *
+ * tools/trace_decode.py turns the chunks into a timeline.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cmsis.h"
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// Ring size in records; a power of two
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS 256
+#endif
+
+// Records per dump chunk; with the header this must fit the MQTT buffer
+#ifndef TRACE_CHUNK_RECORDS
+#define TRACE_CHUNK_RECORDS 64
+#endif
+
+// Free-running 32-bit microsecond counter (TIM5 drives the us ticker on
+// the STM32F4). Define TRACE_CLOCK_HZ too when overriding it.
+#ifndef TRACE_CLOCK
+#define TRACE_CLOCK() (TIM5->CNT)
+#define TRACE_CLOCK_HZ 1000000
+#endif
+
+#define TRACE_FORMAT_VERSION 1
+#define TRACE_HEADER_SIZE 16
+#define TRACE_FLAG_LAST 0x01
+
+/**
+ * Event ids. Keep in step with EVENTS in tools/trace_decode.py.
+ */
+enum TraceEvent
+{
+    TRACE_LOOP_BEGIN = 1,
+    TRACE_LOOP_END,             // a: slowest task id (0xFFFF none), b: idle ms requested
+    TRACE_CONNECT_BEGIN,        // a: broker index
+    TRACE_CONNECT_END,          // a: 1 connected, 0 failed; b: MQTT state
+    TRACE_PUBLISH_BEGIN,
+    TRACE_PUBLISH_END,          // a: 1 sent, 0 failed; b: payload bytes
+    TRACE_MESSAGE,              // a: 1 queued, 0 dropped; b: payload bytes
+    TRACE_DUMP                  // a: dump id; marks where recording paused
+};
+
+struct TraceRecord
+{
+    uint32_t time;
+    uint16_t event;
+    uint16_t a;
+    uint32_t b;
+};
+
+// Written by Trace_Record() only; use the functions below elsewhere
+extern TraceRecord traceRing[TRACE_RECORDS];
+extern uint32_t traceCount;
+extern bool tracePaused;
+
+static inline void Trace_Record(uint16_t event, uint16_t a = 0, uint32_t b = 0)
+{
+#if TRACE_ENABLED
+    if (tracePaused) return;
+    TraceRecord* r = &traceRing[traceCount++ & (TRACE_RECORDS - 1)];
+    r->time = TRACE_CLOCK();
+    r->event = event;
+    r->a = a;
+    r->b = b;
+#endif
+}
+
+/**
+ * Handler for <subscribe topic>/trace. A dump request pauses recording;
+ * the caller then sends the chunks from Trace_NextChunk().
+ */
+void Trace_OnCommand(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+
+bool Trace_DumpPending();
+
+/**
+ * Write the next dump chunk into buf. Returns its length, or 0 if no dump
+ * is in progress. Recording resumes after the last chunk.
+ */
+size_t Trace_NextChunk(uint8_t* buf, size_t size);
+
+/**
+ * Give up on the dump in progress and resume recording
+ */
+void Trace_AbortDump();
+
+#endif // TRACE_H
@@ -0,0 +1,66 @@
+/**
+ * @file UiThread.h
+ * @brief UI thread owning the OLED and RGB LED
+ *
+ * Other threads post display lines, LED patterns and flashes to a lock-free
+ * ring and return at once; the UI thread applies them to DisplayModel and
+ * LedEffects and sleeps until the next LED step, display refresh or posted
+ * event. Display writes hold the I2C bus mutex shared with the sensors.
+ *
+ * Posting is single-producer: only the network (Arduino loop) thread may
+ * call the Ui_Post functions.
+ */
+
+#ifndef UI_THREAD_H
+#define UI_THREAD_H
+
+#include <stdint.h>
+#include "mbed.h"
+#include "DisplayModel.h"
+#include "LedEffects.h"
+
+#ifndef UI_THREAD_STACK
+#define UI_THREAD_STACK 2048
+#endif
+
+#ifndef UI_RING_SIZE
+#define UI_RING_SIZE 8
+#endif
+
+// The thread wakes at least this often to check in with the health
+// monitor, and is reported stalled after UI_STALL_MS without progress
+#ifndef UI_MAX_SLEEP_MS
+#define UI_MAX_SLEEP_MS 1000
+#endif
+
+#ifndef UI_STALL_MS
+#define UI_STALL_MS 10000
+#endif
+
+struct UiStats
+{
+    uint32_t events;            // events applied
+    uint32_t dropped;           // posts lost to a full ring
+    uint32_t stackSize;
+    uint32_t stackMaxUsed;      // high-water mark
+};
+
+/**
+ * Start the thread. The display and LED writers run on the UI thread;
+ * display writes are made with i2c held.
+ */
+void Ui_Start(DisplayWriteFn display, LedOutputFn led, rtos::Mutex* i2c);
+
+void Ui_PostLines(const char* line1, const char* line2, const char* line3);
+
+/**
+ * The pattern is referenced, not copied, so it must be static. Returns
+ * false if the ring was full and the pattern was dropped.
+ */
+bool Ui_PostLedPattern(const LedPattern* pattern);
+
+void Ui_PostFlash(uint8_t r, uint8_t g, uint8_t b, uint16_t ms);
+
+const UiStats* Ui_GetStats();
+
+#endif // UI_THREAD_H
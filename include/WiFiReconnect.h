@@ -0,0 +1,89 @@
+/**
+ * @file WiFiReconnect.h
+ * @brief Non-blocking Wi-Fi reconnect with a cached access point and lease
+ *
+ * After each successful association the BSSID, channel and IP settings are
+ * remembered. When the link drops, WiFiReconnect_Start() first rejoins that
+ * access point directly, skipping the scan, and reuses the previous address
+ * while it is younger than WIFI_LEASE_REUSE_MS. If that does not bring the
+ * link up within WIFI_FAST_TIMEOUT_MS it falls back to a full scan with
+ * DHCP. Association runs inside the Wi-Fi driver; WiFiReconnect_Poll() only
+ * checks its progress, so the main loop keeps running.
+ */
+
+#ifndef WIFI_RECONNECT_H
+#define WIFI_RECONNECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef WIFI_FAST_TIMEOUT_MS
+#define WIFI_FAST_TIMEOUT_MS 5000
+#endif
+
+#ifndef WIFI_SCAN_TIMEOUT_MS
+#define WIFI_SCAN_TIMEOUT_MS 20000
+#endif
+
+// Reuse the previous address without DHCP if it was obtained this recently.
+// A reused address is only kept until this long after it was leased; the
+// link is then restarted with DHCP. Keep it within the time a DHCP client
+// would renew (half the lease). 0 always uses DHCP.
+#ifndef WIFI_LEASE_REUSE_MS
+#define WIFI_LEASE_REUSE_MS 600000
+#endif
+
+enum WiFiReconnectPath
+{
+    WIFI_PATH_NONE,
+    WIFI_PATH_FAST,             // cached BSSID/channel
+    WIFI_PATH_SCAN              // full scan and DHCP
+};
+
+struct WiFiReconnectStats
+{
+    uint32_t joinMs;            // boot-time join to IP address, 0 until joined
+    uint32_t reconnects;        // link restored
+    uint32_t fast;              // ... via the cached access point
+    uint32_t fallbacks;         // fast attempts that timed out
+    uint32_t renewals;          // restarts to replace a reused address
+    uint32_t lastTimeToIpMs;    // link drop to IP address
+    uint32_t maxTimeToIpMs;
+    uint8_t lastPath;           // WiFiReconnectPath
+    bool leaseReused;           // last reconnect skipped DHCP
+};
+
+/**
+ * Remember the current access point and address. Call after every
+ * successful association.
+ */
+void WiFiReconnect_Remember();
+
+/**
+ * Begin the first association after boot (scan and DHCP). Returns
+ * immediately; poll with WiFiReconnect_Poll(). Not counted as a reconnect.
+ */
+void WiFiReconnect_Join();
+
+/**
+ * Begin reconnecting. Returns immediately.
+ */
+void WiFiReconnect_Start();
+
+/**
+ * Advance the reconnect. Returns true once the link is up with an address.
+ * While connected, this also restarts the link with DHCP once a reused
+ * address has reached WIFI_LEASE_REUSE_MS (returning false meanwhile).
+ */
+bool WiFiReconnect_Poll();
+
+bool WiFiReconnect_InProgress();
+
+const WiFiReconnectStats* WiFiReconnect_GetStats();
+
+/**
+ * Format the statistics as JSON. Returns the number of characters written.
+ */
+size_t WiFiReconnect_FormatStats(char* buf, size_t size);
+
+#endif // WIFI_RECONNECT_H
@@ -0,0 +1,202 @@
+/**
+ * @file BlobTransfer.cpp
+ * @brief Chunked inbound transfers for payloads larger than the MQTT buffer
+ */
+
+#include <Arduino.h>
+#include "Log.h"
+#include "BlobTransfer.h"
+
+struct TransferState
+{
+    bool active;
+    uint8_t kind;
+    uint16_t id;
+    uint16_t chunkSize;
+    uint16_t next;              // next expected sequence number
+    uint16_t totalChunks;
+    uint32_t totalSize;
+    uint32_t lastActivity;
+};
+
+static const BlobSink* sinks[BLOB_MAX_KINDS];
+static BlobAckFn ackFn = NULL;
+static TransferState xfer;
+
+static uint16_t readU16(const uint8_t* p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t readU32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint32_t BlobTransfer_Crc32(uint32_t crc, const uint8_t* data, size_t length)
+{
+    // Nibble table: 64 bytes of flash instead of 1 KB
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static void sendAck(uint16_t id, const char* status)
+{
+    if (!ackFn) return;
+
+    char json[128];
+    snprintf(json, sizeof(json), "{\"id\":%u,\"next\":%u,\"total\":%u,\"window\":%u,\"status\":\"%s\"}",
+        id, xfer.id == id ? xfer.next : 0, xfer.id == id ? xfer.totalChunks : 0, BLOB_WINDOW, status);
+    ackFn(json);
+}
+
+static void abortTransfer()
+{
+    if (!xfer.active) return;
+
+    const BlobSink* sink = sinks[xfer.kind];
+    if (sink && sink->finish) sink->finish(false, sink->context);
+    xfer.active = false;
+}
+
+void BlobTransfer_Init(BlobAckFn ack)
+{
+    ackFn = ack;
+}
+
+bool BlobTransfer_RegisterSink(uint8_t kind, const BlobSink* sink)
+{
+    if (kind >= BLOB_MAX_KINDS) return false;
+    sinks[kind] = sink;
+    return true;
+}
+
+void BlobTransfer_OnMessage(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    if (length < BLOB_HEADER_SIZE || payload[0] != BLOB_PROTOCOL_VERSION) return;
+
+    uint8_t kind = payload[1];
+    uint8_t flags = payload[2];
+    uint16_t id = readU16(payload + 4);
+    uint16_t seq = readU16(payload + 6);
+    uint16_t chunkSize = readU16(payload + 8);
+    uint32_t totalSize = readU32(payload + 12);
+    uint32_t crc = readU32(payload + 16);
+    const uint8_t* data = payload + BLOB_HEADER_SIZE;
+    size_t dataLen = length - BLOB_HEADER_SIZE;
+
+    if (flags & BLOB_FLAG_QUERY)
+    {
+        sendAck(id, xfer.active && xfer.id == id ? "ok" : "idle");
+        return;
+    }
+
+    if (BlobTransfer_Crc32(0, data, dataLen) != crc)
+    {
+        sendAck(id, "crc");
+        return;
+    }
+
+    // A new transfer starts at sequence 0 and replaces any active one
+    if (!xfer.active || xfer.id != id)
+    {
+        if (seq != 0)
+        {
+            sendAck(id, "unknown");
+            return;
+        }
+        if (kind >= BLOB_MAX_KINDS || sinks[kind] == NULL || chunkSize == 0 || totalSize == 0)
+        {
+            sendAck(id, "kind");
+            return;
+        }
+        // Sequence numbers are 16 bits, so more chunks cannot be addressed
+        uint32_t chunks = totalSize / chunkSize + (totalSize % chunkSize ? 1 : 0);
+        if (chunks > 0xFFFF)
+        {
+            sendAck(id, "size");
+            return;
+        }
+
+        abortTransfer();
+        const BlobSink* sink = sinks[kind];
+        if (sink->begin && !sink->begin(id, totalSize, sink->context))
+        {
+            sendAck(id, "busy");
+            return;
+        }
+
+        memset(&xfer, 0, sizeof(xfer));
+        xfer.active = true;
+        xfer.kind = kind;
+        xfer.id = id;
+        xfer.chunkSize = chunkSize;
+        xfer.totalSize = totalSize;
+        xfer.totalChunks = (uint16_t)chunks;
+        LOG_INFO("Blob %u: receiving %lu bytes in %u chunks\n",
+            id, (unsigned long)totalSize, xfer.totalChunks);
+    }
+
+    xfer.lastActivity = millis();
+
+    if (seq != xfer.next)
+    {
+        // Duplicate or gap: tell the sender where to resume
+        sendAck(id, seq < xfer.next ? "dup" : "seq");
+        return;
+    }
+
+    uint32_t offset = (uint32_t)seq * xfer.chunkSize;
+    uint32_t expected = (seq + 1 == xfer.totalChunks) ? xfer.totalSize - offset : xfer.chunkSize;
+    if (dataLen != expected)
+    {
+        sendAck(id, "length");
+        return;
+    }
+
+    const BlobSink* sink = sinks[xfer.kind];
+    if (!sink->write(offset, data, dataLen, sink->context))
+    {
+        sendAck(id, "sink");
+        abortTransfer();
+        return;
+    }
+
+    xfer.next++;
+    if (xfer.next == xfer.totalChunks)
+    {
+        bool ok = sink->finish ? sink->finish(true, sink->context) : true;
+        xfer.active = false;
+        sendAck(id, ok ? "done" : "sink");
+        LOG_INFO("Blob %u: %s\n", id, ok ? "complete" : "rejected");
+    }
+    else if (xfer.next % (BLOB_WINDOW / 2 ? BLOB_WINDOW / 2 : 1) == 0)
+    {
+        sendAck(id, "ok");
+    }
+}
+
+void BlobTransfer_Poll()
+{
+    if (xfer.active && millis() - xfer.lastActivity > BLOB_IDLE_TIMEOUT_MS)
+    {
+        LOG_WARN("Blob %u: timed out at chunk %u\n", xfer.id, xfer.next);
+        abortTransfer();
+    }
+}
+
+void BlobTransfer_AnnounceState()
+{
+    if (xfer.active) sendAck(xfer.id, "ok");
+}
@@ -0,0 +1,177 @@
+/**
+ * @file BootProfile.cpp
+ * @brief Per-phase boot timing kept across resets
+ */
+
+#include <Arduino.h>
+#include "BackupRegs.h"
+#include "Log.h"
+#include "BootProfile.h"
+
+// Register layout, from BKP_REG_BOOT: a header, then one per phase
+#define REG_HEADER      0               // BOOT_MAGIC << 24 | complete flag | boot count
+#define REG_PHASES      1
+
+#define BOOT_MAGIC      0xB0u
+#define HEADER_COMPLETE 0x00800000u
+#define HEADER_COUNT    0x0000FFFFu
+
+// Phase register: start in 10 ms units << 16 | duration in ms
+#define PHASE_UNSET     0xFFFFu
+#define PHASE_MAX       0xFFFEu
+#define START_UNIT_MS   10
+
+static const char* const phaseNames[BOOT_PHASE_COUNT] = {
+    "display", "config", "wifi", "dhcp", "ntp", "dns", "tls", "connack", "suback"
+};
+
+static BootPhaseTime phases[BOOT_PHASE_COUNT];
+static uint32_t bootCount = 0;
+static uint32_t completeMs = 0;
+static uint32_t firstPublishMs = 0;
+static bool complete = false;
+
+// Where the previous boot stopped, if it never completed
+static bool prevIncomplete = false;
+static int prevPhase = -1;
+static uint32_t prevStartMs = 0;
+
+static uint16_t clamp16(uint32_t value)
+{
+    return value > PHASE_MAX ? PHASE_MAX : (uint16_t)value;
+}
+
+static void store(int phase)
+{
+    const BootPhaseTime* t = &phases[phase];
+    uint32_t start = t->startMs == BOOT_NOT_REACHED ? PHASE_UNSET : clamp16(t->startMs / START_UNIT_MS);
+    uint32_t duration = t->durationMs == BOOT_NOT_REACHED ? PHASE_UNSET : clamp16(t->durationMs);
+    Bkp_Write(BKP_REG_BOOT + REG_PHASES + phase, (start << 16) | duration);
+}
+
+static void storeHeader()
+{
+    Bkp_Write(BKP_REG_BOOT + REG_HEADER, (BOOT_MAGIC << 24) | (complete ? HEADER_COMPLETE : 0) | bootCount);
+}
+
+/**
+ * Find the phase the previous boot was in when it stopped: the latest one
+ * that began but never completed
+ */
+static void loadPrevious()
+{
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        uint32_t reg = Bkp_Read(BKP_REG_BOOT + REG_PHASES + i);
+        uint32_t start = reg >> 16;
+        uint32_t duration = reg & 0xFFFF;
+        if (start == PHASE_UNSET || duration != PHASE_UNSET) continue;
+
+        if (prevPhase < 0 || start * START_UNIT_MS >= prevStartMs)
+        {
+            prevPhase = i;
+            prevStartMs = start * START_UNIT_MS;
+        }
+    }
+}
+
+void BootProfile_Init()
+{
+    Bkp_Enable();
+
+    uint32_t header = Bkp_Read(BKP_REG_BOOT + REG_HEADER);
+    if ((header >> 24) == BOOT_MAGIC)
+    {
+        bootCount = ((header & HEADER_COUNT) + 1) & HEADER_COUNT;
+        if (!(header & HEADER_COMPLETE))
+        {
+            prevIncomplete = true;
+            loadPrevious();
+            LOG_WARN("Previous boot did not complete (stopped in %s)\n",
+                prevPhase >= 0 ? phaseNames[prevPhase] : "setup");
+        }
+    }
+
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        phases[i].startMs = BOOT_NOT_REACHED;
+        phases[i].durationMs = BOOT_NOT_REACHED;
+        store(i);
+    }
+    storeHeader();
+}
+
+void BootProfile_Begin(int phase)
+{
+    if (phase < 0 || phase >= BOOT_PHASE_COUNT || phases[phase].startMs != BOOT_NOT_REACHED) return;
+
+    phases[phase].startMs = millis();
+    store(phase);
+}
+
+void BootProfile_End(int phase)
+{
+    if (phase < 0 || phase >= BOOT_PHASE_COUNT) return;
+
+    BootPhaseTime* t = &phases[phase];
+    if (t->startMs == BOOT_NOT_REACHED || t->durationMs != BOOT_NOT_REACHED) return;
+
+    t->durationMs = millis() - t->startMs;
+    store(phase);
+}
+
+void BootProfile_Complete()
+{
+    if (complete) return;
+
+    completeMs = millis();
+    complete = true;
+    storeHeader();
+}
+
+void BootProfile_FirstPublish()
+{
+    if (firstPublishMs == 0) firstPublishMs = millis();
+}
+
+bool BootProfile_IsComplete()
+{
+    return complete;
+}
+
+const BootPhaseTime* BootProfile_Get(int phase)
+{
+    return (phase >= 0 && phase < BOOT_PHASE_COUNT) ? &phases[phase] : NULL;
+}
+
+const char* BootProfile_PhaseName(int phase)
+{
+    return (phase >= 0 && phase < BOOT_PHASE_COUNT) ? phaseNames[phase] : "";
+}
+
+size_t BootProfile_Format(char* buf, size_t size)
+{
+    int len = snprintf(buf, size, "{\"boot\":%lu,\"connected_ms\":%lu,\"first_publish_ms\":%lu",
+        (unsigned long)bootCount, (unsigned long)completeMs, (unsigned long)firstPublishMs);
+    if (len < 0 || (size_t)len >= size) return 0;
+
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        const BootPhaseTime* t = &phases[i];
+        if (t->startMs == BOOT_NOT_REACHED) continue;
+
+        int n = t->durationMs == BOOT_NOT_REACHED
+            ? snprintf(buf + len, size - len, ",\"%s\":[%lu,null]", phaseNames[i], (unsigned long)t->startMs)
+            : snprintf(buf + len, size - len, ",\"%s\":[%lu,%lu]", phaseNames[i],
+                (unsigned long)t->startMs, (unsigned long)t->durationMs);
+        if (n < 0 || (size_t)(len + n) >= size) return 0;
+        len += n;
+    }
+
+    int n = prevIncomplete
+        ? snprintf(buf + len, size - len, ",\"prev_stopped\":{\"phase\":\"%s\",\"at_ms\":%lu}}",
+            prevPhase >= 0 ? phaseNames[prevPhase] : "setup", (unsigned long)prevStartMs)
+        : snprintf(buf + len, size - len, "}");
+    if (n < 0 || (size_t)(len + n) >= size) return 0;
+    return len + n;
+}
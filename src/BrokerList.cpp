@@ -0,0 +1,123 @@
+/**
+ * @file BrokerList.cpp
+ * @brief Ordered broker endpoint list with connect-time health scoring
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "BrokerList.h"
+
+static BrokerEndpoint endpoints[BROKER_LIST_MAX];
+static int endpointCount = 0;
+
+static bool addEndpoint(const char* host, size_t hostLen, int port)
+{
+    if (endpointCount >= BROKER_LIST_MAX || hostLen == 0 || hostLen >= BROKER_HOST_LEN)
+        return false;
+
+    BrokerEndpoint* e = &endpoints[endpointCount++];
+    memset(e, 0, sizeof(*e));
+    memcpy(e->host, host, hostLen);
+    e->host[hostLen] = '\0';
+    e->port = port;
+    return true;
+}
+
+int BrokerList_Init(const char* primaryHost, int primaryPort, const char* extraList)
+{
+    endpointCount = 0;
+    if (primaryHost && primaryHost[0] != '\0')
+        addEndpoint(primaryHost, strlen(primaryHost), primaryPort);
+
+    const char* p = extraList;
+    while (p && *p)
+    {
+        while (*p == ' ' || *p == ',') p++;
+        if (*p == '\0') break;
+
+        const char* end = p;
+        while (*end && *end != ',') end++;
+
+        const char* colon = (const char*)memchr(p, ':', end - p);
+        int port = colon ? atoi(colon + 1) : primaryPort;
+        size_t hostLen = (colon ? colon : end) - p;
+        while (hostLen > 0 && p[hostLen - 1] == ' ') hostLen--;
+
+        addEndpoint(p, hostLen, port > 0 ? port : primaryPort);
+        p = end;
+    }
+    return endpointCount;
+}
+
+int BrokerList_Count()
+{
+    return endpointCount;
+}
+
+const BrokerEndpoint* BrokerList_Get(int index)
+{
+    return (index >= 0 && index < endpointCount) ? &endpoints[index] : NULL;
+}
+
+uint32_t BrokerList_Score(const BrokerEndpoint* endpoint)
+{
+    uint32_t base = endpoint->measured ? endpoint->avgConnectMs : BROKER_UNMEASURED_MS;
+    return base + (uint32_t)endpoint->failures * BROKER_FAILURE_PENALTY_MS;
+}
+
+bool BrokerList_IsCoolingDown(int index, uint32_t now)
+{
+    const BrokerEndpoint* e = BrokerList_Get(index);
+    // Wrap-safe "now < cooldownUntil"; only failed endpoints cool down
+    return e && e->failures > 0 && (int32_t)(e->cooldownUntil - now) > 0;
+}
+
+int BrokerList_Select(uint32_t now, uint32_t exclude)
+{
+    int best = -1;
+    int earliest = -1;
+
+    for (int i = 0; i < endpointCount; i++)
+    {
+        if (exclude & (1u << i)) continue;
+
+        const BrokerEndpoint* e = &endpoints[i];
+        if (BrokerList_IsCoolingDown(i, now))
+        {
+            if (earliest < 0 || (int32_t)(e->cooldownUntil - endpoints[earliest].cooldownUntil) < 0)
+                earliest = i;
+            continue;
+        }
+
+        if (best < 0 || BrokerList_Score(e) < BrokerList_Score(&endpoints[best]))
+            best = i;
+    }
+    return best >= 0 ? best : earliest;
+}
+
+void BrokerList_ReportSuccess(int index, uint32_t connectMs)
+{
+    if (index < 0 || index >= endpointCount) return;
+
+    BrokerEndpoint* e = &endpoints[index];
+    // Exponential moving average, weight 1/4 for the new sample
+    e->avgConnectMs = e->measured ? (e->avgConnectMs * 3 + connectMs) / 4 : connectMs;
+    e->measured = true;
+    e->failures = 0;
+    e->cooldownUntil = 0;
+}
+
+void BrokerList_ReportFailure(int index, uint32_t now)
+{
+    if (index < 0 || index >= endpointCount) return;
+
+    BrokerEndpoint* e = &endpoints[index];
+    if (e->failures < 255) e->failures++;
+
+    uint32_t cooldown = BROKER_COOLDOWN_MS;
+    for (int i = 1; i < e->failures && cooldown < BROKER_COOLDOWN_MAX_MS; i++)
+        cooldown *= 2;
+    if (cooldown > BROKER_COOLDOWN_MAX_MS) cooldown = BROKER_COOLDOWN_MAX_MS;
+
+    e->cooldownUntil = now + cooldown;
+}
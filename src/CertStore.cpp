@@ -0,0 +1,157 @@
+/**
+ * @file CertStore.cpp
+ * @brief Validation of the TLS credentials
+ */
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+#include "Log.h"
+#include "CertStore.h"
+
+#if CONNECTION_PROFILE != PROFILE_MQTT_USERPASS
+  #include "mbedtls/x509_crt.h"
+  #include "mbedtls/pk.h"
+#endif
+
+static const char* caCert = NULL;
+static const char* clientCert = NULL;
+static const char* clientKey = NULL;
+static bool loaded = false;
+static bool failed = false;
+static uint32_t failedSum = 0;          // checksum of the credentials that failed
+static unsigned int generation = 0;
+static unsigned long parseTimeMs = 0;
+
+#if CONNECTION_PROFILE != PROFILE_MQTT_USERPASS
+/**
+ * Parse a PEM certificate chain once to catch configuration errors at boot
+ */
+static bool validateCert(const char* name, const char* pem)
+{
+    if (pem == NULL || pem[0] == '\0')
+    {
+        LOG_ERROR("%s missing\n", name);
+        return false;
+    }
+
+    mbedtls_x509_crt crt;
+    mbedtls_x509_crt_init(&crt);
+    // PEM input must include the terminating NUL in its length
+    int ret = mbedtls_x509_crt_parse(&crt, (const unsigned char*)pem, strlen(pem) + 1);
+    mbedtls_x509_crt_free(&crt);
+
+    if (ret != 0)
+    {
+        LOG_ERROR("%s invalid, mbedtls=-0x%04x\n", name, -ret);
+        return false;
+    }
+    return true;
+}
+#endif
+
+#if CONNECTION_PROFILE == PROFILE_MQTT_MTLS
+/**
+ * Parse the PEM private key once to catch configuration errors at boot
+ */
+static bool validateKey(const char* pem)
+{
+    if (pem == NULL || pem[0] == '\0')
+    {
+        LOG_ERROR("Client key missing\n");
+        return false;
+    }
+
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    int ret = mbedtls_pk_parse_key(&pk, (const unsigned char*)pem, strlen(pem) + 1, NULL, 0);
+    mbedtls_pk_free(&pk);
+
+    if (ret != 0)
+    {
+        LOG_ERROR("Client key invalid, mbedtls=-0x%04x\n", -ret);
+        return false;
+    }
+    return true;
+}
+#endif
+
+/**
+ * FNV-1a over the credential text, to tell whether it changed since a
+ * failed check
+ */
+static uint32_t checksum(uint32_t sum, const char* text)
+{
+    for (const char* p = text ? text : ""; *p; p++)
+        sum = (sum ^ (uint8_t)*p) * 16777619u;
+    return sum;
+}
+
+static bool validate()
+{
+#if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS_TLS || CONNECTION_PROFILE == PROFILE_MQTT_MTLS
+    if (!validateCert("CA cert", caCert)) return false;
+#endif
+#if CONNECTION_PROFILE == PROFILE_MQTT_MTLS
+    if (!validateCert("Client cert", clientCert)) return false;
+    if (!validateKey(clientKey)) return false;
+#endif
+    return true;
+}
+
+bool CertStore_Load()
+{
+    if (loaded) return true;
+
+#if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS_TLS || CONNECTION_PROFILE == PROFILE_MQTT_MTLS
+    caCert = DeviceConfig_GetCACert();
+#endif
+#if CONNECTION_PROFILE == PROFILE_MQTT_MTLS
+    clientCert = DeviceConfig_GetClientCert();
+    clientKey = DeviceConfig_GetClientKey();
+#endif
+
+    // The same text would fail the same way; only parse it again once the
+    // stored credentials have been changed
+    uint32_t sum = checksum(checksum(checksum(2166136261u, caCert), clientCert), clientKey);
+    if (failed && sum == failedSum) return false;
+
+    unsigned long start = millis();
+    bool valid = validate();
+    parseTimeMs = millis() - start;
+    if (!valid)
+    {
+        failed = true;
+        failedSum = sum;
+        return false;
+    }
+
+    failed = false;
+    loaded = true;
+    generation++;
+    return true;
+}
+
+unsigned int CertStore_GetGeneration()
+{
+    return generation;
+}
+
+const char* CertStore_GetCACert()
+{
+    return caCert ? caCert : "";
+}
+
+const char* CertStore_GetClientCert()
+{
+    return clientCert ? clientCert : "";
+}
+
+const char* CertStore_GetClientKey()
+{
+    return clientKey ? clientKey : "";
+}
+
+unsigned long CertStore_GetParseTimeMs()
+{
+    return parseTimeMs;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file ConfigCache.cpp
+ * @brief RAM copy of the device settings used on the connect path
+ */
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+#include "BlobTransfer.h"
+#include "Log.h"
+#include "ConfigCache.h"
+
+static char pool[CONFIG_CACHE_POOL_SIZE];
+static uint16_t offsets[CONFIG_FIELD_COUNT];
+static int brokerPort = 0;
+static uint32_t checksum = 0;
+static bool valid = false;
+static ConfigCacheStats stats;
+
+#if CONFIG_CACHE
+static uint32_t computeChecksum()
+{
+    uint32_t crc = BlobTransfer_Crc32(0, (const uint8_t*)pool, stats.poolUsed);
+    crc = BlobTransfer_Crc32(crc, (const uint8_t*)offsets, sizeof(offsets));
+    return BlobTransfer_Crc32(crc, (const uint8_t*)&brokerPort, sizeof(brokerPort));
+}
+
+/**
+ * Append a string to the pool, truncating it if it does not fit
+ */
+static void add(ConfigField field, const char* value, size_t* used)
+{
+    size_t room = sizeof(pool) - *used;
+    size_t length = value ? strlen(value) : 0;
+    if (length >= room)
+    {
+        length = room > 0 ? room - 1 : 0;
+        stats.truncated = true;
+    }
+
+    offsets[field] = (uint16_t)*used;
+    if (room == 0)
+    {
+        // Nothing left; point at the last terminator
+        offsets[field] = (uint16_t)(sizeof(pool) - 1);
+        return;
+    }
+    memcpy(pool + *used, value, length);
+    pool[*used + length] = '\0';
+    *used += length + 1;
+}
+#endif
+
+bool ConfigCache_Load()
+{
+#if CONFIG_CACHE
+    if (valid) return !stats.truncated;
+
+    uint32_t startUs = micros();
+    size_t used = 0;
+    stats.truncated = false;
+
+    add(CONFIG_WIFI_SSID, DeviceConfig_GetWifiSsid(), &used);
+    add(CONFIG_WIFI_PASSWORD, DeviceConfig_GetWifiPassword(), &used);
+    add(CONFIG_BROKER_HOST, DeviceConfig_GetBrokerHost(), &used);
+    add(CONFIG_DEVICE_ID, DeviceConfig_GetDeviceId(), &used);
+#if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS || CONNECTION_PROFILE == PROFILE_MQTT_USERPASS_TLS
+    {
+        // Read straight into the pool; no stack copy of the password
+        size_t room = sizeof(pool) - used;
+        offsets[CONFIG_DEVICE_PASSWORD] = (uint16_t)used;
+        if (room > 1)
+        {
+            size_t size = room < CONFIG_PASSWORD_SIZE ? room : CONFIG_PASSWORD_SIZE;
+            pool[used] = '\0';
+            DeviceConfig_Read(SETTING_DEVICE_PASSWORD, pool + used, size);
+            pool[used + size - 1] = '\0';
+            size_t length = strlen(pool + used);
+            if (length == size - 1 && size < CONFIG_PASSWORD_SIZE) stats.truncated = true;
+            used += length + 1;
+        }
+        else
+        {
+            add(CONFIG_DEVICE_PASSWORD, "", &used);
+        }
+    }
+#else
+    add(CONFIG_DEVICE_PASSWORD, "", &used);
+#endif
+    brokerPort = DeviceConfig_GetBrokerPort();
+
+    stats.poolUsed = (uint16_t)used;
+    checksum = computeChecksum();
+    valid = true;
+    stats.loads++;
+    stats.loadUs = micros() - startUs;
+
+    if (stats.truncated)
+        LOG_WARN("Config cache: settings truncated to fit %d bytes\n", CONFIG_CACHE_POOL_SIZE);
+    return !stats.truncated;
+#else
+    return true;
+#endif
+}
+
+void ConfigCache_Invalidate()
+{
+    valid = false;
+    stats.invalidations++;
+}
+
+bool ConfigCache_Verify()
+{
+#if CONFIG_CACHE
+    if (!valid)
+    {
+        ConfigCache_Load();
+        return true;
+    }
+
+    stats.checks++;
+    if (computeChecksum() == checksum) return true;
+
+    stats.corruptions++;
+    LOG_WARN("Config cache: checksum mismatch, reloading\n");
+    valid = false;
+    ConfigCache_Load();
+    return false;
+#else
+    return true;
+#endif
+}
+
+const char* ConfigCache_Get(ConfigField field)
+{
+    stats.reads++;
+#if CONFIG_CACHE
+    if (field < 0 || field >= CONFIG_FIELD_COUNT) return "";
+    if (!valid) ConfigCache_Load();
+    return pool + offsets[field];
+#else
+    const char* value = NULL;
+    switch (field)
+    {
+    case CONFIG_WIFI_SSID:      value = DeviceConfig_GetWifiSsid(); break;
+    case CONFIG_WIFI_PASSWORD:  value = DeviceConfig_GetWifiPassword(); break;
+    case CONFIG_BROKER_HOST:    value = DeviceConfig_GetBrokerHost(); break;
+    case CONFIG_DEVICE_ID:      value = DeviceConfig_GetDeviceId(); break;
+    case CONFIG_DEVICE_PASSWORD:
+#if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS || CONNECTION_PROFILE == PROFILE_MQTT_USERPASS_TLS
+        // The uncached path: a full read of the password on every call
+        DeviceConfig_Read(SETTING_DEVICE_PASSWORD, pool, CONFIG_PASSWORD_SIZE < sizeof(pool) ? CONFIG_PASSWORD_SIZE : sizeof(pool));
+        pool[sizeof(pool) - 1] = '\0';
+        value = pool;
+#endif
+        break;
+    default:
+        break;
+    }
+    return value ? value : "";
+#endif
+}
+
+int ConfigCache_GetBrokerPort()
+{
+#if CONFIG_CACHE
+    if (!valid) ConfigCache_Load();
+    return brokerPort;
+#else
+    return DeviceConfig_GetBrokerPort();
+#endif
+}
+
+const ConfigCacheStats* ConfigCache_GetStats()
+{
+    return &stats;
+}
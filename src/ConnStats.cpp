@@ -0,0 +1,139 @@
+/**
+ * @file ConnStats.cpp
+ * @brief Per-phase timing of MQTT connection attempts
+ */
+
+#include <Arduino.h>
+#include "Log.h"
+#include "ConnStats.h"
+
+static const char* const phaseNames[CONN_PHASE_COUNT] = { "config", "dns", "transport", "mqtt" };
+
+static ConnAttempt history[CONN_STATS_HISTORY];
+static unsigned int totalAttempts = 0;      // attempts ever started
+static unsigned int reportedAttempts = 0;   // attempts included in a sent summary
+static unsigned int formattedAttempts = 0;  // attempts in the last formatted summary
+static uint32_t phaseStartUs = 0;
+static bool attemptOpen = false;
+
+static ConnAttempt* current()
+{
+    return &history[(totalAttempts - 1) % CONN_STATS_HISTORY];
+}
+
+void ConnStats_BeginAttempt(int broker)
+{
+    totalAttempts++;
+    ConnAttempt* a = current();
+    memset(a, 0, sizeof(*a));
+    a->startMs = millis();
+    a->broker = (int8_t)broker;
+    a->failedPhase = -1;
+    attemptOpen = true;
+}
+
+void ConnStats_PhaseStart(ConnPhase phase)
+{
+    (void)phase;
+    phaseStartUs = micros();
+}
+
+void ConnStats_PhaseEnd(ConnPhase phase, int error)
+{
+    if (!attemptOpen) return;
+
+    ConnAttempt* a = current();
+    a->phaseUs[phase] = micros() - phaseStartUs;
+    if (error != 0)
+    {
+        a->failedPhase = (int8_t)phase;
+        a->error = (int16_t)error;
+        attemptOpen = false;
+    }
+}
+
+void ConnStats_EndAttempt()
+{
+    attemptOpen = false;
+}
+
+const ConnAttempt* ConnStats_GetLast()
+{
+    return totalAttempts ? current() : NULL;
+}
+
+const char* ConnStats_PhaseName(int phase)
+{
+    return (phase >= 0 && phase < CONN_PHASE_COUNT) ? phaseNames[phase] : "none";
+}
+
+bool ConnStats_HasUnreported()
+{
+    return totalAttempts != reportedAttempts;
+}
+
+size_t ConnStats_FormatSummary(char* buf, size_t size)
+{
+    if (!ConnStats_HasUnreported() || size == 0) return 0;
+
+    // Older attempts than the history depth have been overwritten
+    unsigned int first = reportedAttempts;
+    if (totalAttempts - first > CONN_STATS_HISTORY)
+        first = totalAttempts - CONN_STATS_HISTORY;
+
+    size_t len = snprintf(buf, size, "{\"attempts\":%u,\"dropped\":%u,\"history\":[",
+        totalAttempts - reportedAttempts, first - reportedAttempts);
+    if (len >= size) return 0;
+
+    // Emit as many attempts as fit, keeping room for the closing "]}";
+    // the remainder is left for the next summary
+    unsigned int i = first;
+    for (; i < totalAttempts; i++)
+    {
+        const ConnAttempt* a = &history[i % CONN_STATS_HISTORY];
+        size_t n = snprintf(buf + len, size - len,
+            "%s{\"t\":%lu,\"broker\":%d,\"config_us\":%lu,\"dns_us\":%lu,\"transport_us\":%lu,\"mqtt_us\":%lu,\"fail\":\"%s\",\"err\":%d}",
+            i == first ? "" : ",",
+            (unsigned long)a->startMs, a->broker,
+            (unsigned long)a->phaseUs[CONN_PHASE_CONFIG],
+            (unsigned long)a->phaseUs[CONN_PHASE_DNS],
+            (unsigned long)a->phaseUs[CONN_PHASE_TRANSPORT],
+            (unsigned long)a->phaseUs[CONN_PHASE_MQTT],
+            ConnStats_PhaseName(a->failedPhase), a->error);
+        if (len + n + 3 > size) break;
+        len += n;
+    }
+
+    if (i == first)
+    {
+        buf[0] = '\0';
+        return 0;
+    }
+
+    len += snprintf(buf + len, size - len, "]}");
+    formattedAttempts = i;
+    return len;
+}
+
+void ConnStats_MarkReported()
+{
+    // No-op if nothing was formatted since the last call
+    if (formattedAttempts > reportedAttempts) reportedAttempts = formattedAttempts;
+}
+
+void ConnStats_PrintLast()
+{
+    const ConnAttempt* a = ConnStats_GetLast();
+    if (!a) return;
+
+    // One call, so the line is queued whole
+    char failed[48] = "";
+    if (a->failedPhase >= 0)
+        snprintf(failed, sizeof(failed), " (failed in %s, err=%d)", ConnStats_PhaseName(a->failedPhase), a->error);
+    LOG_INFO("Connect timing: config=%lu us, dns=%lu us, transport=%lu us, mqtt=%lu us%s\n",
+        (unsigned long)a->phaseUs[CONN_PHASE_CONFIG],
+        (unsigned long)a->phaseUs[CONN_PHASE_DNS],
+        (unsigned long)a->phaseUs[CONN_PHASE_TRANSPORT],
+        (unsigned long)a->phaseUs[CONN_PHASE_MQTT],
+        failed);
+}
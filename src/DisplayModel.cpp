@@ -0,0 +1,92 @@
+/**
+ * @file DisplayModel.cpp
+ * @brief Line model of the OLED with dirty tracking and a refresh cap
+ */
+
+#include <Arduino.h>
+#include "DisplayModel.h"
+
+static char lines[DISPLAY_LINES][DISPLAY_COLS + 1];     // wanted, space padded
+static char drawn[DISPLAY_LINES][DISPLAY_COLS + 1];     // on screen
+static uint8_t dirty = 0;                               // bit per line
+static bool everRefreshed = false;
+static unsigned long lastRefresh = 0;
+static DisplayWriteFn writeFn = NULL;
+static DisplayStats stats;
+
+void Display_Init(DisplayWriteFn write)
+{
+    writeFn = write;
+    for (int i = 0; i < DISPLAY_LINES; i++)
+    {
+        memset(lines[i], ' ', DISPLAY_COLS);
+        lines[i][DISPLAY_COLS] = '\0';
+        memcpy(drawn[i], lines[i], sizeof(drawn[i]));
+    }
+    dirty = 0;
+}
+
+void Display_SetLine(int line, const char* text)
+{
+    if (line < 0 || line >= DISPLAY_LINES) return;
+
+    char padded[DISPLAY_COLS + 1];
+    size_t len = text ? strnlen(text, DISPLAY_COLS) : 0;
+    if (len > 0) memcpy(padded, text, len);
+    memset(padded + len, ' ', DISPLAY_COLS - len);
+    padded[DISPLAY_COLS] = '\0';
+
+    stats.updates++;
+    if (memcmp(padded, lines[line], DISPLAY_COLS) == 0)
+    {
+        stats.linesSkipped++;
+        return;
+    }
+
+    memcpy(lines[line], padded, sizeof(padded));
+    // A line changed back to what is on screen needs no redraw
+    if (memcmp(lines[line], drawn[line], DISPLAY_COLS) == 0)
+        dirty &= ~(1u << line);
+    else
+        dirty |= 1u << line;
+}
+
+void Display_SetLines(const char* line1, const char* line2, const char* line3)
+{
+    Display_SetLine(0, line1);
+    Display_SetLine(1, line2);
+    Display_SetLine(2, line3);
+    for (int i = 3; i < DISPLAY_LINES; i++) Display_SetLine(i, NULL);
+}
+
+uint32_t Display_Refresh(bool force)
+{
+    if (dirty == 0) return DISPLAY_IDLE;
+
+    unsigned long now = millis();
+    unsigned long since = now - lastRefresh;
+    if (!force && everRefreshed && since < DISPLAY_MIN_REFRESH_MS)
+        return DISPLAY_MIN_REFRESH_MS - since;
+
+    uint32_t start = micros();
+    for (int i = 0; i < DISPLAY_LINES; i++)
+    {
+        if (!(dirty & (1u << i))) continue;
+        if (writeFn) writeFn(i, lines[i]);
+        memcpy(drawn[i], lines[i], sizeof(drawn[i]));
+        stats.linesDrawn++;
+    }
+    dirty = 0;
+
+    uint32_t elapsed = micros() - start;
+    if (elapsed > stats.maxRefreshUs) stats.maxRefreshUs = elapsed;
+    stats.refreshes++;
+    lastRefresh = now;
+    everRefreshed = true;
+    return DISPLAY_IDLE;
+}
+
+const DisplayStats* Display_GetStats()
+{
+    return &stats;
+}
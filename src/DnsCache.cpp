@@ -0,0 +1,129 @@
+/**
+ * @file DnsCache.cpp
+ * @brief Broker hostname cache with expiry and background refresh
+ */
+
+#include <Arduino.h>
+#include "DnsCache.h"
+
+struct DnsEntry
+{
+    char host[DNS_CACHE_HOST_LEN];
+    char addr[DNS_CACHE_ADDR_LEN];
+    unsigned long resolvedAt;
+    unsigned long lookupAt;     // last lookup attempt, successful or not
+    bool valid;
+};
+
+static DnsEntry entries[DNS_CACHE_ENTRIES];
+static DnsResolveFn resolveFn = NULL;
+
+/**
+ * Resolve through the installed resolver
+ */
+static int resolve(const char* host, char* addr, size_t size)
+{
+    return resolveFn ? resolveFn(host, addr, size) : -1;
+}
+
+static DnsEntry* findEntry(const char* host)
+{
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        if (entries[i].host[0] != '\0' && strcmp(entries[i].host, host) == 0)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+/**
+ * Find the entry for host, or recycle the oldest slot for it
+ */
+static DnsEntry* claimEntry(const char* host)
+{
+    DnsEntry* entry = findEntry(host);
+    if (entry) return entry;
+
+    entry = &entries[0];
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        if (entries[i].host[0] == '\0') { entry = &entries[i]; break; }
+        if (entries[i].resolvedAt < entry->resolvedAt) entry = &entries[i];
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->host, host, sizeof(entry->host) - 1);
+    return entry;
+}
+
+static unsigned long entryAge(const DnsEntry* entry)
+{
+    return millis() - entry->resolvedAt;
+}
+
+static int lookup(DnsEntry* entry)
+{
+    entry->lookupAt = millis();
+
+    char addr[DNS_CACHE_ADDR_LEN];
+    int ret = resolve(entry->host, addr, sizeof(addr));
+    if (ret != 0) return ret;
+
+    strcpy(entry->addr, addr);
+    entry->resolvedAt = millis();
+    entry->valid = true;
+    return 0;
+}
+
+void DnsCache_SetResolver(DnsResolveFn resolver)
+{
+    resolveFn = resolver;
+}
+
+int DnsCache_Resolve(const char* host, char* addr, size_t size, bool* fromCache)
+{
+    if (fromCache) *fromCache = false;
+    if (strlen(host) >= DNS_CACHE_HOST_LEN)
+    {
+        // Too long to cache; resolve directly
+        return resolve(host, addr, size);
+    }
+
+    DnsEntry* entry = claimEntry(host);
+    bool cached = true;
+
+    if (!entry->valid || entryAge(entry) >= DNS_CACHE_TTL_MS)
+    {
+        int ret = lookup(entry);
+        // On lookup failure serve the expired address if it has not failed
+        if (ret != 0 && !entry->valid) return ret;
+        cached = (ret != 0);
+    }
+
+    if (fromCache) *fromCache = cached;
+    strncpy(addr, entry->addr, size - 1);
+    addr[size - 1] = '\0';
+    return 0;
+}
+
+void DnsCache_ReportFailure(const char* host)
+{
+    DnsEntry* entry = findEntry(host);
+    if (entry) entry->valid = false;
+}
+
+bool DnsCache_Refresh()
+{
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        DnsEntry* entry = &entries[i];
+        if (!entry->valid) continue;
+        if (entryAge(entry) + DNS_CACHE_REFRESH_MS < DNS_CACHE_TTL_MS) continue;
+        if (millis() - entry->lookupAt < DNS_CACHE_RETRY_MS) continue;
+
+        // A failed refresh keeps the current address until it expires
+        lookup(entry);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file FirmwareFlash.cpp
+ * @brief FirmwareUpdate flash port for the MiCO OTA partition
+ */
+
+#include <Arduino.h>
+#include "mico.h"
+#include "OTAFirmwareUpdate.h"
+#include "FirmwareUpdate.h"
+
+static uint32_t deviceRegionSize()
+{
+    mico_logic_partition_t* partition = MicoFlashGetInfo(MICO_PARTITION_OTA_TEMP);
+    return partition ? partition->partition_length : 0;
+}
+
+static bool deviceErase(uint32_t offset, uint32_t length)
+{
+    return MicoFlashErase(MICO_PARTITION_OTA_TEMP, offset, length) == kNoErr;
+}
+
+// The bootloader checks the copied image against a CRC-16 of the data sent.
+// The updater programs an image in order from offset 0, so the CRC is
+// accumulated here as it is written.
+static CRC16_Context crc;
+
+static bool deviceProgram(uint32_t offset, const uint8_t* data, size_t length)
+{
+    if (offset == 0) CRC16_Init(&crc);
+    uint32_t at = offset;
+    if (MicoFlashWrite(MICO_PARTITION_OTA_TEMP, &at, (uint8_t*)data, length) != kNoErr) return false;
+    CRC16_Update(&crc, data, length);
+    return true;
+}
+
+static bool deviceActivate(uint32_t imageSize)
+{
+    uint16_t crc16;
+    CRC16_Final(&crc, &crc16);
+    return OTAApplyNewFirmware(imageSize, crc16) == 0;
+}
+
+static const FirmwareFlashPort devicePort = { FW_ERASE_BLOCK_SIZE, deviceRegionSize, deviceErase, deviceProgram, deviceActivate };
+
+const FirmwareFlashPort* FirmwareFlash_GetDevicePort()
+{
+    return &devicePort;
+}
@@ -0,0 +1,344 @@
+/**
+ * @file FirmwareUpdate.cpp
+ * @brief Over-the-air firmware update from chunked MQTT transfers
+ */
+
+#include <Arduino.h>
+#include <malloc.h>
+#include "mbedtls/sha256.h"
+#include "BlobTransfer.h"
+#include "JsonLite.h"
+#include "Log.h"
+#include "FirmwareUpdate.h"
+#if OTA_REQUIRE_SIGNATURE
+#include "mbedtls/pk.h"
+#endif
+
+struct UpdateState
+{
+    bool erasing;               // manifest accepted, first block being erased
+    bool armed;                 // first block erased, waiting for the image
+    bool receiving;             // blob transfer in progress
+    bool pendingReboot;         // verified and activated
+    uint16_t id;
+    uint32_t size;
+    uint32_t written;
+    uint32_t erasedTo;          // bytes from the start that are erased
+    uint32_t startMs;
+    uint32_t heapBase;          // heap in use when the manifest arrived
+    uint8_t expectedHash[32];
+    mbedtls_sha256_context sha;
+};
+
+static UpdateState state;
+static FirmwareUpdateStats stats;
+static FirmwareStatusFn statusFn = NULL;
+static const FirmwareFlashPort* flash = NULL;
+
+#if OTA_REQUIRE_SIGNATURE
+static uint8_t publicKey[OTA_KEY_MAX_BYTES];
+static uint8_t signature[OTA_SIG_MAX_BYTES];
+#define SIGNATURE_RAM (sizeof(publicKey) + sizeof(signature))
+#else
+#define SIGNATURE_RAM 0
+#endif
+
+static uint32_t heapInUse()
+{
+    return (uint32_t)mallinfo().uordblks;
+}
+
+/**
+ * Track the heap growth since the manifest; sampled at every chunk and
+ * while the signature key is loaded
+ */
+static void sampleHeap()
+{
+    uint32_t used = heapInUse();
+    if (used > state.heapBase && used - state.heapBase > stats.heapPeak)
+        stats.heapPeak = used - state.heapBase;
+}
+
+static void report(const char* status)
+{
+    if (!statusFn) return;
+
+    uint32_t kbps = stats.elapsedMs ? (uint32_t)((uint64_t)stats.bytesWritten * 1000 / 1024 / stats.elapsedMs) : 0;
+    char json[256];
+    snprintf(json, sizeof(json),
+        "{\"id\":%u,\"status\":\"%s\",\"written\":%lu,\"size\":%lu,\"kbps\":%lu,"
+        "\"erase_ms\":%lu,\"program_ms\":%lu,\"erase_stalls\":%lu,\"static_bytes\":%u,\"heap_peak_bytes\":%lu}",
+        state.id, status, (unsigned long)state.written, (unsigned long)state.size, (unsigned long)kbps,
+        (unsigned long)stats.eraseMs, (unsigned long)stats.programMs, (unsigned long)stats.eraseStalls,
+        (unsigned)(sizeof(state) + sizeof(stats) + SIGNATURE_RAM), (unsigned long)stats.heapPeak);
+    statusFn(json);
+    LOG_INFO("OTA %u: %s (%lu/%lu bytes, %lu KB/s)\n", state.id, status,
+        (unsigned long)state.written, (unsigned long)state.size, (unsigned long)kbps);
+}
+
+/**
+ * Erase the next block past the erased region
+ */
+static bool eraseNextBlock()
+{
+    uint32_t length = flash->eraseBlockSize;
+    if (state.erasedTo + length > state.size) length = state.size - state.erasedTo;
+
+    unsigned long start = millis();
+    bool ok = flash->erase(state.erasedTo, length);
+    stats.eraseMs += millis() - start;
+
+    if (ok) state.erasedTo += length;
+    return ok;
+}
+
+static void reset()
+{
+    if (state.receiving) mbedtls_sha256_free(&state.sha);
+    state.erasing = false;
+    state.armed = false;
+    state.receiving = false;
+}
+
+static bool sinkBegin(uint16_t id, uint32_t totalSize, void* context)
+{
+    if (!state.armed || state.receiving || id != state.id || totalSize != state.size)
+        return false;
+
+    state.receiving = true;
+    state.written = 0;
+    state.startMs = millis();
+    mbedtls_sha256_init(&state.sha);
+    mbedtls_sha256_starts(&state.sha, 0);
+    report("receiving");
+    return true;
+}
+
+static bool sinkWrite(uint32_t offset, const uint8_t* data, size_t length, void* context)
+{
+    if (!state.receiving || offset != state.written) return false;
+
+    // Normally the block was erased ahead from FirmwareUpdate_Poll()
+    while (state.erasedTo < offset + length)
+    {
+        stats.eraseStalls++;
+        if (!eraseNextBlock()) return false;
+    }
+
+    unsigned long start = millis();
+    bool ok = flash->program(offset, data, length);
+    stats.programMs += millis() - start;
+    if (!ok) return false;
+
+    mbedtls_sha256_update(&state.sha, data, length);
+    state.written += length;
+    stats.bytesWritten = state.written;
+    sampleHeap();
+    return true;
+}
+
+static bool sinkFinish(bool ok, void* context)
+{
+    if (!state.receiving) return false;
+    stats.elapsedMs = millis() - state.startMs;
+
+    if (!ok)
+    {
+        report("aborted");
+        reset();
+        return false;
+    }
+
+    uint8_t hash[32];
+    mbedtls_sha256_finish(&state.sha, hash);
+    sampleHeap();
+
+    if (state.written != state.size || memcmp(hash, state.expectedHash, sizeof(hash)) != 0)
+    {
+        report("hash_mismatch");
+        reset();
+        return false;
+    }
+
+    // The bootloader copies the image and switches on the next reset
+    if (!flash->activate(state.size))
+    {
+        report("activate_failed");
+        reset();
+        return false;
+    }
+
+    report("verified");
+    reset();
+    state.pendingReboot = true;
+    return true;
+}
+
+static const BlobSink firmwareSink = { sinkBegin, sinkWrite, sinkFinish, NULL };
+
+/**
+ * Decode length hex digits into out. Returns the number of bytes, or 0 if
+ * the text is not hex or does not fit.
+ */
+static size_t parseHex(const char* hex, size_t length, uint8_t* out, size_t size)
+{
+    if (length == 0 || length % 2 != 0 || length / 2 > size) return 0;
+    for (size_t i = 0; i < length / 2; i++)
+    {
+        uint8_t byte = 0;
+        for (int j = 0; j < 2; j++)
+        {
+            char c = hex[i * 2 + j];
+            byte <<= 4;
+            if (c >= '0' && c <= '9') byte |= c - '0';
+            else if (c >= 'a' && c <= 'f') byte |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') byte |= c - 'A' + 10;
+            else return 0;
+        }
+        out[i] = byte;
+    }
+    return length / 2;
+}
+
+static bool parseHash(const char* hex, uint8_t* out)
+{
+    return strlen(hex) == 64 && parseHex(hex, 64, out, 32) == 32;
+}
+
+#if OTA_REQUIRE_SIGNATURE
+/**
+ * Check the manifest signature over "<id>:<size>:<sha256>", the values
+ * exactly as sent
+ */
+static bool verifySignature(const char* json, size_t length)
+{
+    size_t idLen, sizeLen, hashLen, sigLen;
+    const char* id = Json_GetRaw(json, length, "id", &idLen);
+    const char* size = Json_GetRaw(json, length, "size", &sizeLen);
+    const char* hash = Json_GetRaw(json, length, "sha256", &hashLen);
+    const char* sig = Json_GetRaw(json, length, "sig", &sigLen);
+    if (!sig || sigLen < 2 || sig[0] != '"' || !id || !size || !hash || hashLen < 2)
+    {
+        LOG_WARN("OTA: manifest is not signed\n");
+        return false;
+    }
+
+    size_t keyBytes = parseHex(OTA_PUBLIC_KEY, strlen(OTA_PUBLIC_KEY), publicKey, sizeof(publicKey));
+    size_t sigBytes = parseHex(sig + 1, sigLen - 2, signature, sizeof(signature));
+    if (keyBytes == 0)
+    {
+        LOG_ERROR("OTA: no valid OTA_PUBLIC_KEY built in, updates disabled\n");
+        return false;
+    }
+    if (sigBytes == 0) return false;
+
+    mbedtls_sha256_context sha;
+    uint8_t digest[32];
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    mbedtls_sha256_update(&sha, (const uint8_t*)id, idLen);
+    mbedtls_sha256_update(&sha, (const uint8_t*)":", 1);
+    mbedtls_sha256_update(&sha, (const uint8_t*)size, sizeLen);
+    mbedtls_sha256_update(&sha, (const uint8_t*)":", 1);
+    mbedtls_sha256_update(&sha, (const uint8_t*)hash + 1, hashLen - 2);
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    int ret = mbedtls_pk_parse_public_key(&pk, publicKey, keyBytes);
+    if (ret == 0)
+    {
+        sampleHeap();
+        ret = mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, digest, sizeof(digest), signature, sigBytes);
+    }
+    mbedtls_pk_free(&pk);
+
+    if (ret != 0) LOG_WARN("OTA: signature check failed, mbedtls=-0x%04x\n", -ret);
+    return ret == 0;
+}
+#endif
+
+void FirmwareUpdate_Init(FirmwareStatusFn status, const FirmwareFlashPort* port)
+{
+    statusFn = status;
+    flash = port;
+    BlobTransfer_RegisterSink(BLOB_KIND_FIRMWARE, &firmwareSink);
+}
+
+void FirmwareUpdate_OnManifest(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    const char* json = (const char*)payload;
+    long id, size;
+    char hex[65];
+
+    if (state.pendingReboot) return;
+    if (!Json_GetInt(json, length, "id", &id) || !Json_GetInt(json, length, "size", &size) ||
+        !Json_GetString(json, length, "sha256", hex, sizeof(hex)))
+    {
+        LOG_WARN("OTA: invalid manifest\n");
+        return;
+    }
+
+    // The id names the blob transfer, whose ids are 16 bits
+    if (id < 0 || id > 0xFFFF)
+    {
+        LOG_WARN("OTA: manifest id %ld out of range\n", id);
+        return;
+    }
+
+    reset();
+    state.id = (uint16_t)id;
+    state.size = (uint32_t)size;
+    state.written = 0;
+    state.erasedTo = 0;
+    state.heapBase = heapInUse();
+    memset(&stats, 0, sizeof(stats));
+
+    if (size <= 0 || (uint32_t)size > flash->regionSize() || !parseHash(hex, state.expectedHash))
+    {
+        report("rejected");
+        return;
+    }
+#if OTA_REQUIRE_SIGNATURE
+    if (!verifySignature(json, length))
+    {
+        report("bad_signature");
+        return;
+    }
+#endif
+
+    state.erasing = true;
+    report("erasing");
+}
+
+void FirmwareUpdate_Poll()
+{
+    // One block per call; the first arms the update, the rest run one block
+    // ahead of the write position during the transfer
+    bool ahead = (state.armed || state.receiving) &&
+        state.erasedTo < state.size && state.erasedTo < state.written + flash->eraseBlockSize;
+    if (!state.erasing && !ahead) return;
+
+    if (!eraseNextBlock())
+    {
+        report("erase_failed");
+        reset();
+        return;
+    }
+    if (!state.erasing) return;
+
+    state.erasing = false;
+    state.armed = true;
+    report("armed");
+}
+
+bool FirmwareUpdate_IsPendingReboot()
+{
+    return state.pendingReboot;
+}
+
+const FirmwareUpdateStats* FirmwareUpdate_GetStats()
+{
+    return &stats;
+}
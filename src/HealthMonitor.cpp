@@ -0,0 +1,233 @@
+/**
+ * @file HealthMonitor.cpp
+ * @brief Loop-time budget and task-supervised hardware watchdog
+ */
+
+#include <Arduino.h>
+#include "mbed.h"
+#include "BackupRegs.h"
+#include "Log.h"
+#include "HealthMonitor.h"
+
+// Stall record layout, from BKP_REG_HEALTH
+#define REG_MAGIC       0           // HEALTH_MAGIC << 16 | stall count
+#define REG_INFO        1           // pending bit, task id << 24, uptime in s
+#define REG_NAME        2           // 2 registers, task name
+#define REG_ACTIVITY    4           // 2 registers, activity name
+
+#define HEALTH_MAGIC    0x4854u
+#define INFO_PENDING    0x80000000u
+#define INFO_UPTIME_MAX 0x00FFFFFFu
+
+// IWDG key register values
+#define IWDG_KEY_RELOAD 0xAAAA
+#define IWDG_KEY_ACCESS 0x5555
+#define IWDG_KEY_START  0xCCCC
+
+// LSI (~32 kHz) divided by 256
+#define IWDG_PRESCALER_256 6
+#define IWDG_TICKS_PER_S 125
+
+struct HealthTask
+{
+    const char* name;
+    uint32_t timeoutMs;
+    HealthActivityFn activity;
+    volatile uint32_t lastCheckIn;
+};
+
+static HealthTask tasks[HEALTH_MAX_TASKS];
+static volatile int taskCount = 0;
+static HealthStall lastStall;
+static HealthStats stats;
+static mbed::Ticker checker;
+static uint32_t loopStartUs = 0;
+
+/**
+ * Up to HEALTH_NAME_LEN characters of a name in two registers
+ */
+static void writeName(int reg, const char* name)
+{
+    char packed[HEALTH_NAME_LEN] = { 0 };
+    if (name) strncpy(packed, name, sizeof(packed));
+
+    uint32_t words[2];
+    memcpy(words, packed, sizeof(words));
+    Bkp_Write(BKP_REG_HEALTH + reg, words[0]);
+    Bkp_Write(BKP_REG_HEALTH + reg + 1, words[1]);
+}
+
+static void readName(int reg, char* name)
+{
+    uint32_t words[2] = { Bkp_Read(BKP_REG_HEALTH + reg), Bkp_Read(BKP_REG_HEALTH + reg + 1) };
+    memcpy(name, words, HEALTH_NAME_LEN);
+    name[HEALTH_NAME_LEN] = '\0';
+}
+
+/**
+ * Record a stall for reporting after the reset (interrupt context)
+ */
+static void recordStall(int id)
+{
+    uint32_t magic = Bkp_Read(BKP_REG_HEALTH + REG_MAGIC);
+    uint32_t count = (magic >> 16) == HEALTH_MAGIC ? (magic & 0xFFFF) : 0;
+    if (count < 0xFFFF) count++;
+
+    uint32_t uptimeS = millis() / 1000;
+    if (uptimeS > INFO_UPTIME_MAX) uptimeS = INFO_UPTIME_MAX;
+
+    writeName(REG_NAME, tasks[id].name);
+    writeName(REG_ACTIVITY, tasks[id].activity ? tasks[id].activity() : NULL);
+    Bkp_Write(BKP_REG_HEALTH + REG_INFO, INFO_PENDING | ((uint32_t)id << 24) | uptimeS);
+    Bkp_Write(BKP_REG_HEALTH + REG_MAGIC, (HEALTH_MAGIC << 16) | count);
+}
+
+/**
+ * Timer interrupt: feed the IWDG only while every task is checking in
+ */
+static void check()
+{
+    if (stats.stalled) return;
+
+    uint32_t now = millis();
+    for (int i = 0; i < taskCount; i++)
+    {
+        if (now - tasks[i].lastCheckIn > tasks[i].timeoutMs)
+        {
+            recordStall(i);
+            stats.stalled = true;
+            return;
+        }
+    }
+
+#if HEALTH_WATCHDOG
+    IWDG->KR = IWDG_KEY_RELOAD;
+#endif
+    stats.feeds++;
+}
+
+static void startWatchdog()
+{
+    uint32_t reload = (uint32_t)HEALTH_IWDG_TIMEOUT_MS * IWDG_TICKS_PER_S / 1000;
+    if (reload > 0xFFF) reload = 0xFFF;
+
+    // Hold the counter while the core is halted by a debugger
+    DBGMCU->APB1FZ |= DBGMCU_APB1_FZ_DBG_IWDG_STOP;
+
+    IWDG->KR = IWDG_KEY_START;
+    IWDG->KR = IWDG_KEY_ACCESS;
+    IWDG->PR = IWDG_PRESCALER_256;
+    IWDG->RLR = reload;
+    while (IWDG->SR != 0) {}
+    IWDG->KR = IWDG_KEY_RELOAD;
+}
+
+void Health_Init()
+{
+    Bkp_Enable();
+
+    uint32_t magic = Bkp_Read(BKP_REG_HEALTH + REG_MAGIC);
+    uint32_t info = Bkp_Read(BKP_REG_HEALTH + REG_INFO);
+    if ((magic >> 16) == HEALTH_MAGIC)
+    {
+        lastStall.count = magic & 0xFFFF;
+        if (info & INFO_PENDING)
+        {
+            lastStall.valid = true;
+            lastStall.task = (uint8_t)((info >> 24) & 0x7F);
+            lastStall.uptimeS = info & INFO_UPTIME_MAX;
+            readName(REG_NAME, lastStall.name);
+            readName(REG_ACTIVITY, lastStall.activity);
+            Bkp_Write(BKP_REG_HEALTH + REG_INFO, info & ~INFO_PENDING);
+
+            LOG_WARN("Watchdog reset: task '%s' (%s) stalled after %lu s, %lu stall(s) so far\n",
+                lastStall.name, lastStall.activity[0] ? lastStall.activity : "-",
+                (unsigned long)lastStall.uptimeS, (unsigned long)lastStall.count);
+        }
+    }
+
+#if HEALTH_WATCHDOG
+    startWatchdog();
+#endif
+    checker.attach_us(callback(check), HEALTH_CHECK_MS * 1000);
+}
+
+int Health_Register(const char* name, uint32_t timeoutMs, HealthActivityFn activity)
+{
+    if (taskCount >= HEALTH_MAX_TASKS) return -1;
+
+    int id = taskCount;
+    tasks[id].name = name;
+    tasks[id].timeoutMs = timeoutMs;
+    tasks[id].activity = activity;
+    tasks[id].lastCheckIn = millis();
+    // The timer interrupt only looks at tasks below taskCount
+    __DMB();
+    taskCount = id + 1;
+    return id;
+}
+
+void Health_CheckIn(int id)
+{
+    if (id < 0 || id >= taskCount) return;
+    tasks[id].lastCheckIn = millis();
+}
+
+void Health_LoopBegin()
+{
+    loopStartUs = micros();
+}
+
+void Health_LoopEnd(const char* slowTask)
+{
+    uint32_t elapsedMs = (micros() - loopStartUs) / 1000;
+
+    stats.loops++;
+    if (elapsedMs > HEALTH_LOOP_BUDGET_MS)
+    {
+        stats.overruns++;
+        LOG_WARN("Loop overrun: %lu ms (%s)\n", (unsigned long)elapsedMs, slowTask ? slowTask : "-");
+    }
+    if (elapsedMs > stats.maxLoopMs)
+    {
+        stats.maxLoopMs = elapsedMs;
+        stats.maxLoopTask = slowTask;
+    }
+}
+
+const HealthStall* Health_GetLastStall()
+{
+    return &lastStall;
+}
+
+const HealthStats* Health_GetStats()
+{
+    return &stats;
+}
+
+size_t Health_FormatStats(char* buf, size_t size)
+{
+    uint32_t now = millis();
+    int len = snprintf(buf, size,
+        "{\"loops\":%lu,\"overruns\":%lu,\"budget_ms\":%u,\"max_loop_ms\":%lu,\"max_loop_task\":\"%s\","
+        "\"watchdog\":%s,\"feeds\":%lu,\"checkin_age_ms\":{",
+        (unsigned long)stats.loops, (unsigned long)stats.overruns, (unsigned)HEALTH_LOOP_BUDGET_MS,
+        (unsigned long)stats.maxLoopMs, stats.maxLoopTask ? stats.maxLoopTask : "",
+        HEALTH_WATCHDOG ? "true" : "false", (unsigned long)stats.feeds);
+    if (len < 0 || (size_t)len >= size) return 0;
+
+    for (int i = 0; i < taskCount; i++)
+    {
+        int n = snprintf(buf + len, size - len, "%s\"%s\":%lu", i > 0 ? "," : "", tasks[i].name,
+            (unsigned long)(now - tasks[i].lastCheckIn));
+        if (n < 0 || (size_t)(len + n) >= size) return 0;
+        len += n;
+    }
+
+    int n = lastStall.valid
+        ? snprintf(buf + len, size - len, "},\"stalls\":%lu,\"last_stall\":{\"task\":\"%s\",\"activity\":\"%s\",\"uptime_s\":%lu}}",
+            (unsigned long)lastStall.count, lastStall.name, lastStall.activity, (unsigned long)lastStall.uptimeS)
+        : snprintf(buf + len, size - len, "},\"stalls\":%lu,\"last_stall\":null}", (unsigned long)lastStall.count);
+    if (n < 0 || (size_t)(len + n) >= size) return 0;
+    return len + n;
+}
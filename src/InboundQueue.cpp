@@ -0,0 +1,100 @@
+/**
+ * @file InboundQueue.cpp
+ * @brief Fixed-size pool and FIFO for inbound MQTT messages
+ */
+
+#include <Arduino.h>
+#include "TopicRouter.h"
+#include "Log.h"
+#include "InboundQueue.h"
+
+struct InboundSlot
+{
+    uint32_t queuedAt;
+    uint16_t topicLen;          // topic is NUL-terminated at data[topicLen]
+    uint16_t length;            // payload follows the topic terminator
+    uint8_t data[INBOUND_SLOT_SIZE];
+};
+
+static InboundSlot pool[INBOUND_POOL_SIZE];
+static uint8_t head = 0;        // next slot to dispatch
+static uint8_t count = 0;       // queued slots, stored in FIFO order
+static InboundStats stats;
+
+bool InboundQueue_Push(const char* topic, const uint8_t* payload, unsigned int length)
+{
+    stats.received++;
+
+    size_t topicLen = strlen(topic);
+    if (topicLen + 1 + length > INBOUND_SLOT_SIZE)
+    {
+        stats.oversize++;
+        return false;
+    }
+    if (count == INBOUND_POOL_SIZE)
+    {
+        stats.dropped++;
+        return false;
+    }
+
+    InboundSlot* slot = &pool[(head + count) % INBOUND_POOL_SIZE];
+    memcpy(slot->data, topic, topicLen + 1);
+    memcpy(slot->data + topicLen + 1, payload, length);
+    slot->topicLen = (uint16_t)topicLen;
+    slot->length = (uint16_t)length;
+    slot->queuedAt = millis();
+
+    count++;
+    stats.depth = count;
+    if (count > stats.highWater) stats.highWater = count;
+    return true;
+}
+
+int InboundQueue_Process(uint32_t budgetMs)
+{
+    unsigned long start = millis();
+    int processed = 0;
+
+    while (count > 0)
+    {
+        if (processed > 0 && millis() - start >= budgetMs) break;
+
+        InboundSlot* slot = &pool[head];
+        uint32_t latency = millis() - slot->queuedAt;
+        if (latency > stats.maxLatencyMs) stats.maxLatencyMs = latency;
+        stats.totalLatencyMs += latency;
+
+        const char* topic = (const char*)slot->data;
+        if (TopicRouter_Dispatch(topic, slot->data + slot->topicLen + 1, slot->length) == 0)
+        {
+            stats.unrouted++;
+            LOG_WARN("\n[Message Received] %s: no handler\n", topic);
+        }
+
+        // Release the slot only after the handlers are done with it
+        head = (head + 1) % INBOUND_POOL_SIZE;
+        count--;
+        stats.depth = count;
+        stats.processed++;
+        processed++;
+    }
+    return processed;
+}
+
+const InboundStats* InboundQueue_GetStats()
+{
+    return &stats;
+}
+
+size_t InboundQueue_FormatStats(char* buf, size_t size)
+{
+    int len = snprintf(buf, size,
+        "{\"received\":%lu,\"processed\":%lu,\"unrouted\":%lu,\"dropped\":%lu,\"oversize\":%lu,"
+        "\"depth\":%u,\"high_water\":%u,\"pool\":%u,\"max_latency_ms\":%lu,\"avg_latency_ms\":%lu}",
+        (unsigned long)stats.received, (unsigned long)stats.processed, (unsigned long)stats.unrouted,
+        (unsigned long)stats.dropped, (unsigned long)stats.oversize,
+        stats.depth, stats.highWater, INBOUND_POOL_SIZE,
+        (unsigned long)stats.maxLatencyMs,
+        (unsigned long)(stats.processed ? stats.totalLatencyMs / stats.processed : 0));
+    return (len > 0 && (size_t)len < size) ? len : 0;
+}
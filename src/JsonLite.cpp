@@ -0,0 +1,145 @@
+/**
+ * @file JsonLite.cpp
+ * @brief Minimal readers for flat JSON command payloads
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "JsonLite.h"
+
+static const char* skipSpace(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+/**
+ * Return the end of the string starting at the opening quote p
+ */
+static const char* skipString(const char* p, const char* end)
+{
+    for (p++; p < end; p++)
+    {
+        if (*p == '\\') p++;
+        else if (*p == '"') return p + 1;
+    }
+    return end;
+}
+
+/**
+ * Return the end of the value starting at p
+ */
+static const char* skipValue(const char* p, const char* end)
+{
+    if (p >= end) return end;
+    if (*p == '"') return skipString(p, end);
+
+    if (*p == '{' || *p == '[')
+    {
+        int depth = 0;
+        while (p < end)
+        {
+            if (*p == '"') { p = skipString(p, end); continue; }
+            if (*p == '{' || *p == '[') depth++;
+            else if (*p == '}' || *p == ']')
+            {
+                if (--depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return end;
+    }
+
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\r' && *p != '\n') p++;
+    return p;
+}
+
+const char* Json_GetRaw(const char* json, size_t length, const char* key, size_t* valueLength)
+{
+    const char* end = json + length;
+    const char* p = skipSpace(json, end);
+    if (p >= end || *p != '{') return NULL;
+
+    size_t keyLen = strlen(key);
+    p++;
+    while (p < end)
+    {
+        p = skipSpace(p, end);
+        if (p >= end || *p == '}') return NULL;
+        if (*p != '"') return NULL;
+
+        const char* name = p + 1;
+        p = skipString(p, end);
+        size_t nameLen = (p - 1) - name;
+
+        p = skipSpace(p, end);
+        if (p >= end || *p != ':') return NULL;
+        p = skipSpace(p + 1, end);
+
+        const char* value = p;
+        p = skipValue(p, end);
+        if (nameLen == keyLen && memcmp(name, key, keyLen) == 0)
+        {
+            *valueLength = p - value;
+            return value;
+        }
+
+        p = skipSpace(p, end);
+        if (p < end && *p == ',') p++;
+    }
+    return NULL;
+}
+
+/**
+ * Copy a numeric value into a NUL-terminated buffer for strtol/strtof
+ */
+static bool getNumberText(const char* json, size_t length, const char* key, char* buf, size_t size)
+{
+    size_t len;
+    const char* value = Json_GetRaw(json, length, key, &len);
+    if (!value || len == 0 || len >= size) return false;
+    if (!(value[0] == '-' || (value[0] >= '0' && value[0] <= '9'))) return false;
+
+    memcpy(buf, value, len);
+    buf[len] = '\0';
+    return true;
+}
+
+bool Json_GetInt(const char* json, size_t length, const char* key, long* value)
+{
+    char buf[24];
+    if (!getNumberText(json, length, key, buf, sizeof(buf))) return false;
+
+    char* endp;
+    *value = strtol(buf, &endp, 10);
+    return *endp == '\0';
+}
+
+bool Json_GetFloat(const char* json, size_t length, const char* key, float* value)
+{
+    char buf[32];
+    if (!getNumberText(json, length, key, buf, sizeof(buf))) return false;
+
+    char* endp;
+    *value = strtof(buf, &endp);
+    return endp != buf;
+}
+
+bool Json_GetString(const char* json, size_t length, const char* key, char* out, size_t size)
+{
+    size_t len;
+    const char* value = Json_GetRaw(json, length, key, &len);
+    if (!value || len < 2 || value[0] != '"' || size == 0) return false;
+
+    size_t n = 0;
+    for (size_t i = 1; i < len - 1; i++)
+    {
+        char c = value[i];
+        if (c == '\\' && i + 1 < len - 1 && (value[i + 1] == '"' || value[i + 1] == '\\'))
+            c = value[++i];
+        if (n + 1 >= size) return false;
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    return true;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file LedEffects.cpp
+ * @brief Non-blocking RGB LED patterns and flashes
+ */
+
+#include <Arduino.h>
+#include "LedEffects.h"
+
+static const LedPattern offPattern = { LED_EFFECT_SOLID, 0, 0, 0, 0, 0 };
+
+static LedOutputFn outputFn = NULL;
+static const LedPattern* base = &offPattern;
+static unsigned long phaseStart = 0;        // start of the base pattern cycle
+static bool flashing = false;
+static unsigned long flashStart = 0;
+static uint16_t flashMs = 0;
+static uint8_t flashColor[3];
+static uint8_t shown[3];
+static bool shownValid = false;
+
+static void output(uint8_t r, uint8_t g, uint8_t b)
+{
+    // Skip writes that would not change the LED
+    if (shownValid && shown[0] == r && shown[1] == g && shown[2] == b) return;
+    shown[0] = r;
+    shown[1] = g;
+    shown[2] = b;
+    shownValid = true;
+    if (outputFn) outputFn(r, g, b);
+}
+
+void LedEffects_Init(LedOutputFn fn)
+{
+    outputFn = fn;
+    shownValid = false;
+}
+
+void LedEffects_SetBase(const LedPattern* pattern)
+{
+    if (!pattern) pattern = &offPattern;
+    if (pattern == base) return;
+
+    base = pattern;
+    phaseStart = millis();
+}
+
+void LedEffects_Flash(uint8_t r, uint8_t g, uint8_t b, uint16_t ms)
+{
+    flashColor[0] = r;
+    flashColor[1] = g;
+    flashColor[2] = b;
+    flashMs = ms;
+    flashStart = millis();
+    flashing = true;
+}
+
+uint32_t LedEffects_Run()
+{
+    unsigned long now = millis();
+
+    if (flashing)
+    {
+        unsigned long elapsed = now - flashStart;
+        if (elapsed < flashMs)
+        {
+            output(flashColor[0], flashColor[1], flashColor[2]);
+            return flashMs - elapsed;
+        }
+        flashing = false;
+    }
+
+    uint32_t cycle = (uint32_t)base->onMs + base->offMs;
+    if (base->kind == LED_EFFECT_SOLID || cycle == 0)
+    {
+        output(base->r, base->g, base->b);
+        return LED_EFFECTS_IDLE;
+    }
+
+    uint32_t t = (now - phaseStart) % cycle;
+    if (base->kind == LED_EFFECT_BLINK)
+    {
+        if (t < base->onMs)
+        {
+            output(base->r, base->g, base->b);
+            return base->onMs - t;
+        }
+        output(0, 0, 0);
+        return cycle - t;
+    }
+
+    // Pulse: linear ramp up then down, starting from the peak so the
+    // colour shows at once
+    t = (t + base->onMs) % cycle;
+    uint32_t level = (t < base->onMs)
+        ? (base->onMs ? t * 255 / base->onMs : 255)
+        : (cycle - t) * 255 / base->offMs;
+    output((uint8_t)(base->r * level / 255), (uint8_t)(base->g * level / 255), (uint8_t)(base->b * level / 255));
+    return LED_PULSE_STEP_MS;
+}
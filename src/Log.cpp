@@ -0,0 +1,176 @@
+/**
+ * @file Log.cpp
+ * @brief Leveled serial logging through a RAM ring drained by a thread
+ */
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include "mbed.h"
+#include "MemMonitor.h"
+#include "Log.h"
+
+#if (LOG_RING_SIZE & (LOG_RING_SIZE - 1)) != 0
+#error "LOG_RING_SIZE must be a power of two"
+#endif
+
+#define RING_MASK (LOG_RING_SIZE - 1)
+#define LOG_SIGNAL_DATA 0x1
+
+// Free-running positions; the ring holds head - tail bytes. head is only
+// moved with interrupts disabled, tail only by the drain thread.
+static char ring[LOG_RING_SIZE];
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+
+static rtos::Thread drainThread(osPriorityLow, LOG_THREAD_STACK);
+static volatile bool started = false;
+static volatile int level = LOG_RUNTIME_LEVEL;
+static volatile uint32_t pendingDrops = 0;     // lines dropped since the last note
+static LogStats stats;
+
+/**
+ * Write the ring to the port in chunks, then sleep until more is queued
+ */
+static void drainMain()
+{
+    for (;;)
+    {
+        while (tail != head)
+        {
+            uint32_t start = tail & RING_MASK;
+            uint32_t length = head - tail;
+            if (length > LOG_RING_SIZE - start) length = LOG_RING_SIZE - start;
+            if (length > LOG_DRAIN_CHUNK) length = LOG_DRAIN_CHUNK;
+
+            Serial.write((const uint8_t*)ring + start, length);
+            tail += length;
+        }
+        rtos::Thread::signal_wait(LOG_SIGNAL_DATA);
+    }
+}
+
+/**
+ * Copy into the ring; call with interrupts disabled
+ */
+static bool enqueue(const char* text, size_t length)
+{
+    uint32_t used = head - tail;
+    if (length > LOG_RING_SIZE - used) return false;
+
+    uint32_t start = head & RING_MASK;
+    size_t first = LOG_RING_SIZE - start;
+    if (first > length) first = length;
+    memcpy(ring + start, text, first);
+    memcpy(ring, text + first, length - first);
+    head += length;
+
+    used += length;
+    if (used > stats.maxUsed) stats.maxUsed = used;
+    return true;
+}
+
+void Log_Init()
+{
+    if (started) return;
+
+    Mem_AddThread("log", &drainThread, LOG_THREAD_STACK);
+    drainThread.start(callback(drainMain));
+    started = true;
+}
+
+void Log_SetLevel(int newLevel)
+{
+    if (newLevel < LOG_LEVEL_NONE) newLevel = LOG_LEVEL_NONE;
+    if (newLevel > LOG_LEVEL_DEBUG) newLevel = LOG_LEVEL_DEBUG;
+    level = newLevel;
+}
+
+int Log_GetLevel()
+{
+    return level;
+}
+
+bool Log_Enabled(int lineLevel)
+{
+    return lineLevel <= level && lineLevel <= LOG_LEVEL;
+}
+
+void Log_Write(int lineLevel, const char* text, size_t length)
+{
+    if (!Log_Enabled(lineLevel) || length == 0) return;
+
+    // Formatted outside the critical section; the count is checked again
+    // inside
+    char note[48];
+    uint32_t drops = pendingDrops;
+    int noteLen = drops ? snprintf(note, sizeof(note), "[log] %lu line(s) dropped\n", (unsigned long)drops) : 0;
+
+    core_util_critical_section_enter();
+    if (drops && drops == pendingDrops && enqueue(note, noteLen)) pendingDrops = 0;
+
+    // Lines are not queued past an unsent note, so the order holds
+    if (pendingDrops == 0 && enqueue(text, length))
+    {
+        stats.lines++;
+        stats.bytes += length;
+    }
+    else
+    {
+        pendingDrops++;
+        stats.droppedLines++;
+        stats.droppedBytes += length;
+    }
+    core_util_critical_section_exit();
+
+    if (started) drainThread.signal_set(LOG_SIGNAL_DATA);
+}
+
+void Log_Printf(int lineLevel, const char* format, ...)
+{
+    if (!Log_Enabled(lineLevel)) return;
+
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length <= 0) return;
+
+    if ((size_t)length >= sizeof(line))
+    {
+        length = sizeof(line) - 1;
+        memcpy(line + length - 4, "...\n", 4);
+        // Other threads and interrupts count too
+        core_util_critical_section_enter();
+        stats.truncated++;
+        core_util_critical_section_exit();
+    }
+    Log_Write(lineLevel, line, length);
+}
+
+bool Log_Flush(uint32_t timeoutMs)
+{
+    unsigned long start = millis();
+    while (head != tail)
+    {
+        if (!started || millis() - start >= timeoutMs) return false;
+        delay(1);
+    }
+    return true;
+}
+
+const LogStats* Log_GetStats()
+{
+    return &stats;
+}
+
+size_t Log_FormatStats(char* buf, size_t size)
+{
+    int len = snprintf(buf, size,
+        "{\"level\":%d,\"lines\":%lu,\"bytes\":%lu,\"dropped_lines\":%lu,\"dropped_bytes\":%lu,"
+        "\"truncated\":%lu,\"ring\":%d,\"max_used\":%lu}",
+        level, (unsigned long)stats.lines, (unsigned long)stats.bytes, (unsigned long)stats.droppedLines,
+        (unsigned long)stats.droppedBytes, (unsigned long)stats.truncated, LOG_RING_SIZE,
+        (unsigned long)stats.maxUsed);
+    return (len > 0 && (size_t)len < size) ? len : 0;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file MemMonitor.cpp
+ * @brief Stack high-water marks and heap headroom
+ */
+
+#include <Arduino.h>
+#include <malloc.h>
+#include "mbed.h"
+#ifdef MBED_HEAP_STATS_ENABLED
+#include "platform/mbed_stats.h"
+#endif
+#include "Log.h"
+#include "MemMonitor.h"
+
+#define PAINT_WORD 0xDEADBEEFu
+
+// Linker script symbols (GCC_ARM). Weak, so a layout without them only
+// loses the interrupt stack and the heap bounds.
+extern "C" uint32_t __StackLimit __attribute__((weak));
+extern "C" uint32_t __StackTop __attribute__((weak));
+extern "C" char __end__ __attribute__((weak));
+extern "C" char __HeapLimit __attribute__((weak));
+extern "C" char* _sbrk(int incr);
+
+struct StackEntry
+{
+    MemStack info;
+    rtos::Thread* thread;       // NULL for a region painted here
+    const uint32_t* bottom;     // painted region
+    const uint32_t* paintTop;
+    const uint8_t* top;         // where the tracked size is measured from
+    bool warned;
+};
+
+static StackEntry stacks[MEM_MAX_STACKS];
+static int stackCount = 0;
+static MemStats stats;
+static bool heapWarned = false;
+
+static StackEntry* addEntry(const char* name, uint32_t size)
+{
+    if (stackCount >= MEM_MAX_STACKS) return NULL;
+
+    StackEntry* e = &stacks[stackCount++];
+    memset(e, 0, sizeof(*e));
+    strncpy(e->info.name, name, MEM_NAME_LEN);
+    e->info.size = size;
+    return e;
+}
+
+static void paint(uint32_t* from, uint32_t* to)
+{
+    while (from < to) *from++ = PAINT_WORD;
+}
+
+/**
+ * Depth of a painted region: from its top down to the lowest overwritten
+ * word. Scans up from the bottom, so it stops at the high-water mark.
+ */
+static uint32_t paintedUse(const StackEntry* e)
+{
+    const uint32_t* p = e->bottom;
+    while (p < e->paintTop && *p == PAINT_WORD) p++;
+    return (uint32_t)(e->top - (const uint8_t*)p);
+}
+
+static void paintMainStack()
+{
+#ifdef osRtxVersionKernel
+    // The running thread's stack bounds, from its RTX control block
+    osRtxThread_t* self = (osRtxThread_t*)osThreadGetId();
+    if (!self || !self->stack_mem || self->stack_size == 0) return;
+
+    // The lowest word holds RTX's overflow check value; leave it alone
+    uint32_t* bottom = (uint32_t*)self->stack_mem + 1;
+    const uint8_t* top = (const uint8_t*)self->stack_mem + self->stack_size;
+
+    volatile uint32_t marker = 0;
+    uint32_t* paintTop = (uint32_t*)((uintptr_t)((uint8_t*)&marker - MEM_PAINT_GUARD) & ~(uintptr_t)3);
+    if (paintTop <= bottom || (const uint8_t*)paintTop >= top) return;
+
+    StackEntry* e = addEntry("net", self->stack_size);
+    if (!e) return;
+    paint(bottom, paintTop);
+    e->bottom = bottom;
+    e->paintTop = paintTop;
+    e->top = top;
+#endif
+}
+
+static void paintIsrStack()
+{
+    if (&__StackLimit == NULL || &__StackTop == NULL) return;
+
+    StackEntry* e = addEntry("isr", (uint32_t)((uint8_t*)&__StackTop - (uint8_t*)&__StackLimit));
+    if (!e) return;
+
+    // Interrupts push below MSP, so none may run while it is painted
+    core_util_critical_section_enter();
+    uint32_t* paintTop = (uint32_t*)((__get_MSP() - MEM_PAINT_GUARD) & ~(uint32_t)3);
+    paint(&__StackLimit, paintTop);
+    core_util_critical_section_exit();
+
+    e->bottom = &__StackLimit;
+    e->paintTop = paintTop;
+    e->top = (const uint8_t*)&__StackTop;
+}
+
+void Mem_Init()
+{
+    paintMainStack();
+    paintIsrStack();
+    if (&__HeapLimit != NULL && &__end__ != NULL) stats.heapSize = (uint32_t)(&__HeapLimit - &__end__);
+    stats.heapMinFree = 0xFFFFFFFFu;
+    stats.heapMinTop = 0xFFFFFFFFu;
+    Mem_Sample();
+}
+
+void Mem_AddThread(const char* name, rtos::Thread* thread, uint32_t stackSize)
+{
+    StackEntry* e = addEntry(name, stackSize);
+    if (e) e->thread = thread;
+}
+
+static void sampleHeap()
+{
+    struct mallinfo info = mallinfo();
+
+    // Heap not yet claimed by the allocator
+    uint32_t unclaimed = 0;
+    if (&__HeapLimit != NULL)
+    {
+        char* brk = _sbrk(0);
+        if (brk != (char*)-1 && brk < &__HeapLimit) unclaimed = (uint32_t)(&__HeapLimit - brk);
+    }
+
+    stats.heapFree = (uint32_t)info.fordblks + unclaimed;
+    stats.heapTop = (uint32_t)info.keepcost + unclaimed;
+    if (stats.heapFree < stats.heapMinFree) stats.heapMinFree = stats.heapFree;
+    if (stats.heapTop < stats.heapMinTop) stats.heapMinTop = stats.heapTop;
+
+    // The sampled minimum misses peaks between samples; the allocation
+    // statistics do not
+    uint32_t lowest = stats.heapMinFree;
+#ifdef MBED_HEAP_STATS_ENABLED
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+    stats.heapPeak = heap.max_size;
+    stats.allocFailures = heap.alloc_fail_cnt;
+    if (stats.heapSize > stats.heapPeak && stats.heapSize - stats.heapPeak < lowest)
+        lowest = stats.heapSize - stats.heapPeak;
+#endif
+
+    if (!heapWarned && lowest < MEM_HEAP_LOW_BYTES)
+    {
+        heapWarned = true;
+        stats.warnings++;
+        LOG_WARN("Memory: heap down to %lu bytes free\n", (unsigned long)lowest);
+    }
+}
+
+void Mem_Sample()
+{
+    sampleHeap();
+
+    for (int i = 0; i < stackCount; i++)
+    {
+        StackEntry* e = &stacks[i];
+        uint32_t used = e->thread ? e->thread->max_stack() : paintedUse(e);
+        if (used > e->info.maxUsed) e->info.maxUsed = used;
+
+        if (!e->warned && e->info.maxUsed + MEM_STACK_LOW_BYTES > e->info.size)
+        {
+            e->warned = true;
+            stats.warnings++;
+            LOG_WARN("Memory: %s stack used %lu of %lu bytes\n",
+                e->info.name, (unsigned long)e->info.maxUsed, (unsigned long)e->info.size);
+        }
+    }
+    stats.samples++;
+}
+
+int Mem_StackCount()
+{
+    return stackCount;
+}
+
+const MemStack* Mem_GetStack(int index)
+{
+    return (index >= 0 && index < stackCount) ? &stacks[index].info : NULL;
+}
+
+const MemStats* Mem_GetStats()
+{
+    return &stats;
+}
+
+size_t Mem_FormatStats(char* buf, size_t size)
+{
+    int len = snprintf(buf, size,
+        "{\"heap\":{\"size\":%lu,\"free\":%lu,\"min_free\":%lu,\"top\":%lu,\"min_top\":%lu,"
+        "\"peak\":%lu,\"alloc_fail\":%lu},\"stacks\":{",
+        (unsigned long)stats.heapSize, (unsigned long)stats.heapFree, (unsigned long)stats.heapMinFree,
+        (unsigned long)stats.heapTop, (unsigned long)stats.heapMinTop,
+        (unsigned long)stats.heapPeak, (unsigned long)stats.allocFailures);
+    if (len < 0 || (size_t)len >= size) return 0;
+
+    for (int i = 0; i < stackCount; i++)
+    {
+        const MemStack* s = &stacks[i].info;
+        int n = snprintf(buf + len, size - len, "%s\"%s\":[%lu,%lu]", i == 0 ? "" : ",",
+            s->name, (unsigned long)s->size, (unsigned long)s->maxUsed);
+        if (n < 0 || (size_t)(len + n) >= size) return 0;
+        len += n;
+    }
+
+    int n = snprintf(buf + len, size - len, "},\"warnings\":%lu}", (unsigned long)stats.warnings);
+    if (n < 0 || (size_t)(len + n) >= size) return 0;
+    return len + n;
+}
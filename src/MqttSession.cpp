@@ -0,0 +1,174 @@
+/**
+ * @file MqttSession.cpp
+ * @brief Persistent MQTT session tracking
+ */
+
+#include <Arduino.h>
+#include "Log.h"
+#include "MqttSession.h"
+
+#define PACKET_TYPE_MASK 0xF0
+#define PACKET_CONNACK   0x20
+#define PACKET_SUBACK    0x90
+#define CONNACK_SP_FLAG  0x01
+
+// Packet framing of the broker-to-client stream, from the CONNACK on
+enum FrameState
+{
+    FRAME_OFF,                  // not following the stream
+    FRAME_HEADER,
+    FRAME_LENGTH,
+    FRAME_BODY
+};
+
+static FrameState frame = FRAME_OFF;
+static uint8_t frameType = 0;
+static uint32_t frameRemaining = 0;     // body bytes still to come
+static uint8_t lengthShift = 0;
+static bool frameFirstByte = false;
+
+static bool connackPresent = false;
+static unsigned long connectedAt = 0;
+static bool waitingFirst = false;
+static uint32_t subacksPending = 0;
+static unsigned long subscribedAt = 0;
+static MqttSessionStats stats = { 0, 0, 0, -1, 0, false, 0, -1 };
+
+static void packetDone()
+{
+    if ((frameType & PACKET_TYPE_MASK) == PACKET_SUBACK && subacksPending > 0)
+    {
+        stats.subacks++;
+        if (--subacksPending == 0) stats.subackMs = (int32_t)(millis() - subscribedAt);
+    }
+    frame = FRAME_HEADER;
+}
+
+/**
+ * Follow the packet framing over bytes read from the broker, picking the
+ * session-present flag out of the CONNACK and counting SUBACKs. Returns
+ * the number of bytes consumed (the rest of a body is skipped at once).
+ */
+static size_t sniff(const uint8_t* buf, size_t n)
+{
+    uint8_t b = buf[0];
+    switch (frame)
+    {
+    case FRAME_HEADER:
+        frameType = b;
+        frameRemaining = 0;
+        lengthShift = 0;
+        frame = FRAME_LENGTH;
+        return 1;
+    case FRAME_LENGTH:
+        frameRemaining |= (uint32_t)(b & 0x7F) << lengthShift;
+        lengthShift += 7;
+        if (b & 0x80) return 1;
+        frameFirstByte = true;
+        if (frameRemaining == 0) packetDone();
+        else frame = FRAME_BODY;
+        return 1;
+    case FRAME_BODY:
+    {
+        if (frameFirstByte && (frameType & PACKET_TYPE_MASK) == PACKET_CONNACK)
+            connackPresent = (b & CONNACK_SP_FLAG) != 0;
+        frameFirstByte = false;
+
+        size_t take = n < frameRemaining ? n : frameRemaining;
+        frameRemaining -= take;
+        if (frameRemaining == 0) packetDone();
+        return take;
+    }
+    default:
+        return n;
+    }
+}
+
+int SessionClient::read()
+{
+    int b = _client.read();
+    if (b >= 0 && frame != FRAME_OFF)
+    {
+        uint8_t byte = (uint8_t)b;
+        sniff(&byte, 1);
+    }
+    return b;
+}
+
+int SessionClient::read(uint8_t* buf, size_t size)
+{
+    int n = _client.read(buf, size);
+    for (int i = 0; i < n && frame != FRAME_OFF; )
+        i += sniff(buf + i, n - i);
+    return n;
+}
+
+void MqttSession_BeginConnect()
+{
+    // A new transport: the next byte read starts the CONNACK
+    frame = FRAME_HEADER;
+    connackPresent = false;
+    subacksPending = 0;
+}
+
+bool MqttSession_OnConnected()
+{
+    stats.connects++;
+    stats.sessionPresent = connackPresent;
+    if (connackPresent) stats.resumed++;
+
+    connectedAt = millis();
+    waitingFirst = true;
+    stats.firstMessageMs = -1;
+    stats.burstMessages = 0;
+    return connackPresent;
+}
+
+void MqttSession_OnResubscribe()
+{
+    stats.resubscribes++;
+}
+
+void MqttSession_OnSubscribeSent(uint32_t packets)
+{
+    if (subacksPending == 0)
+    {
+        subscribedAt = millis();
+        stats.subackMs = -1;
+    }
+    subacksPending += packets;
+}
+
+uint32_t MqttSession_SubacksPending()
+{
+    return subacksPending;
+}
+
+void MqttSession_OnMessage()
+{
+    unsigned long elapsed = millis() - connectedAt;
+    if (waitingFirst)
+    {
+        waitingFirst = false;
+        stats.firstMessageMs = (int32_t)elapsed;
+        LOG_INFO("First message %lu ms after connecting (session %s)\n",
+            elapsed, stats.sessionPresent ? "resumed" : "new");
+    }
+    if (elapsed < MQTT_SESSION_BURST_MS) stats.burstMessages++;
+}
+
+const MqttSessionStats* MqttSession_GetStats()
+{
+    return &stats;
+}
+
+size_t MqttSession_FormatStats(char* buf, size_t size)
+{
+    int len = snprintf(buf, size,
+        "{\"connects\":%lu,\"resumed\":%lu,\"resubscribes\":%lu,\"session_present\":%s,"
+        "\"first_msg_ms\":%ld,\"burst_msgs\":%lu,\"subacks\":%lu,\"suback_ms\":%ld}",
+        (unsigned long)stats.connects, (unsigned long)stats.resumed, (unsigned long)stats.resubscribes,
+        stats.sessionPresent ? "true" : "false", (long)stats.firstMessageMs,
+        (unsigned long)stats.burstMessages, (unsigned long)stats.subacks, (long)stats.subackMs);
+    return (len > 0 && (size_t)len < size) ? len : 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file PowerManager.cpp
+ * @brief Low-power idle between scheduled tasks, with duty-cycle accounting
+ */
+
+#include <Arduino.h>
+#include "mbed.h"
+#include "rtos_idle.h"
+#include "us_ticker_api.h"
+#include "PowerManager.h"
+
+static PowerStats stats;
+static unsigned long windowStart = 0;
+// Updated from the idle thread; sleep time is carried into whole
+// milliseconds so long windows do not overflow
+static volatile uint32_t sleepUs = 0;
+static volatile uint32_t sleepMs = 0;
+static volatile uint32_t wakes = 0;
+
+#if POWER_SAVE
+/**
+ * RTOS idle hook: sleep until the next interrupt
+ */
+static void idleHook()
+{
+    uint32_t start = us_ticker_read();
+    __WFI();
+    sleepUs += us_ticker_read() - start;
+    if (sleepUs >= 1000)
+    {
+        sleepMs += sleepUs / 1000;
+        sleepUs %= 1000;
+    }
+    wakes++;
+}
+#endif
+
+void Power_Init()
+{
+    windowStart = millis();
+#if POWER_SAVE
+    rtos_attach_idle_hook(idleHook);
+#endif
+}
+
+void Power_Idle(uint32_t ms)
+{
+    stats.idleCalls++;
+    stats.idleRequestedMs += ms;
+    delay(ms);
+}
+
+const PowerStats* Power_GetStats()
+{
+    stats.windowMs = millis() - windowStart;
+    stats.sleepMs = sleepMs;
+    stats.wakes = wakes;
+    return &stats;
+}
+
+size_t Power_FormatStats(char* buf, size_t size)
+{
+    Power_GetStats();
+
+    uint32_t sleepPermille = stats.windowMs ? (uint32_t)((uint64_t)stats.sleepMs * 1000 / stats.windowMs) : 0;
+    if (sleepPermille > 1000) sleepPermille = 1000;
+    int len = snprintf(buf, size,
+        "{\"mode\":\"%s\",\"window_ms\":%lu,\"sleep_ms\":%lu,\"duty_pct\":%lu.%lu,"
+        "\"wakes\":%lu,\"idle_calls\":%lu,\"idle_requested_ms\":%lu}",
+        POWER_SAVE ? "wfi" : "none", (unsigned long)stats.windowMs, (unsigned long)stats.sleepMs,
+        (unsigned long)((1000 - sleepPermille) / 10), (unsigned long)((1000 - sleepPermille) % 10),
+        (unsigned long)stats.wakes, (unsigned long)stats.idleCalls, (unsigned long)stats.idleRequestedMs);
+
+    // Start a new window
+    windowStart = millis();
+    sleepMs = 0;
+    wakes = 0;
+    memset(&stats, 0, sizeof(stats));
+    return (len > 0 && (size_t)len < size) ? len : 0;
+}
@@ -0,0 +1,209 @@
+/**
+ * @file RemoteConfig.cpp
+ * @brief Runtime application settings with remote updates
+ */
+
+#include <Arduino.h>
+#include "DeviceConfig.h"
+#include "JsonLite.h"
+#include "ConfigCache.h"
+#include "Log.h"
+#include "RemoteConfig.h"
+
+static RuntimeConfig active;
+static RuntimeConfig staged;
+static RuntimeConfig persisted;         // what EEPROM currently holds
+static bool stagedPending = false;
+static uint32_t stagedAtUs = 0;
+static unsigned long lastChangeMs = 0;
+static RemoteConfigStats stats;
+static RemoteConfigAppliedFn appliedFn = NULL;
+static RemoteConfigStatusFn statusFn = NULL;
+
+static void copyTopic(char* dst, const char* src)
+{
+    strncpy(dst, src, REMOTE_CONFIG_TOPIC_LEN - 1);
+    dst[REMOTE_CONFIG_TOPIC_LEN - 1] = '\0';
+}
+
+static void report(const char* status, const char* detail)
+{
+    if (!statusFn) return;
+
+    char json[256];
+    snprintf(json, sizeof(json),
+        "{\"status\":\"%s\",\"detail\":\"%s\",\"apply_us\":%lu,\"max_apply_us\":%lu,"
+        "\"applied\":%lu,\"rejected\":%lu,\"eeprom_writes\":%lu,\"persist_pending\":%s}",
+        status, detail, (unsigned long)stats.lastApplyUs, (unsigned long)stats.maxApplyUs,
+        (unsigned long)stats.applied, (unsigned long)stats.rejected,
+        (unsigned long)stats.eepromWrites, stats.persistPending ? "true" : "false");
+    statusFn(json);
+}
+
+/**
+ * Device topics are used as prefixes for derived topics, so they must not
+ * be empty or contain wildcards. An empty subscribe topic would also drop
+ * the config topic under it, cutting off further remote changes.
+ */
+static bool validTopic(const char* topic)
+{
+    return topic[0] != '\0' && strpbrk(topic, "+#") == NULL;
+}
+
+void RemoteConfig_Init(RemoteConfigAppliedFn applied, RemoteConfigStatusFn status)
+{
+    appliedFn = applied;
+    statusFn = status;
+
+    active.sendIntervalS = DeviceConfig_GetSendInterval();
+    active.sensorMask = DeviceConfig_GetSensorMask() & SENSOR_MASK_ALL;
+    copyTopic(active.publishTopic, DeviceConfig_GetPublishTopic());
+    copyTopic(active.subscribeTopic, DeviceConfig_GetSubscribeTopic());
+    persisted = active;
+}
+
+const RuntimeConfig* RemoteConfig_Get()
+{
+    return &active;
+}
+
+void RemoteConfig_OnMessage(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    const char* json = (const char*)payload;
+    uint32_t receivedUs = micros();
+
+    // Start from any update still waiting to be applied so none are lost
+    RuntimeConfig next = stagedPending ? staged : active;
+    long value;
+    char text[REMOTE_CONFIG_TOPIC_LEN];
+    size_t rawLen;
+    const char* error = NULL;
+
+    if (Json_GetRaw(json, length, "sendInterval", &rawLen))
+    {
+        if (!Json_GetInt(json, length, "sendInterval", &value) || value < 1 || value > REMOTE_CONFIG_MAX_INTERVAL_S)
+            error = "sendInterval";
+        else
+            next.sendIntervalS = (uint32_t)value;
+    }
+    if (!error && Json_GetRaw(json, length, "sensorMask", &rawLen))
+    {
+        if (!Json_GetInt(json, length, "sensorMask", &value) || value < 0 || (value & ~SENSOR_MASK_ALL))
+            error = "sensorMask";
+        else
+            next.sensorMask = (uint32_t)value;
+    }
+    if (!error && Json_GetRaw(json, length, "publishTopic", &rawLen))
+    {
+        if (!Json_GetString(json, length, "publishTopic", text, sizeof(text)) || !validTopic(text))
+            error = "publishTopic";
+        else
+            copyTopic(next.publishTopic, text);
+    }
+    if (!error && Json_GetRaw(json, length, "subscribeTopic", &rawLen))
+    {
+        if (!Json_GetString(json, length, "subscribeTopic", text, sizeof(text)) || !validTopic(text))
+            error = "subscribeTopic";
+        else
+            copyTopic(next.subscribeTopic, text);
+    }
+
+    if (error)
+    {
+        stats.rejected++;
+        report("rejected", error);
+        return;
+    }
+
+    staged = next;
+    if (!stagedPending) stagedAtUs = receivedUs;
+    stagedPending = true;
+}
+
+bool RemoteConfig_SetSendInterval(uint32_t seconds)
+{
+    if (seconds < 1 || seconds > REMOTE_CONFIG_MAX_INTERVAL_S) return false;
+
+    if (!stagedPending)
+    {
+        staged = active;
+        stagedAtUs = micros();
+        stagedPending = true;
+    }
+    staged.sendIntervalS = seconds;
+    return true;
+}
+
+/**
+ * Write fields that differ from EEPROM. Returns false if any write failed.
+ */
+static bool persist()
+{
+    bool ok = true;
+    char text[16];
+    uint32_t writes = stats.eepromWrites;
+
+    if (active.sendIntervalS != persisted.sendIntervalS)
+    {
+        snprintf(text, sizeof(text), "%lu", (unsigned long)active.sendIntervalS);
+        if (DeviceConfig_Save(SETTING_SEND_INTERVAL, text) == 0) { persisted.sendIntervalS = active.sendIntervalS; stats.eepromWrites++; }
+        else ok = false;
+    }
+    if (active.sensorMask != persisted.sensorMask)
+    {
+        snprintf(text, sizeof(text), "%lu", (unsigned long)active.sensorMask);
+        if (DeviceConfig_Save(SETTING_SENSOR_MASK, text) == 0) { persisted.sensorMask = active.sensorMask; stats.eepromWrites++; }
+        else ok = false;
+    }
+    if (strcmp(active.publishTopic, persisted.publishTopic) != 0)
+    {
+        if (DeviceConfig_Save(SETTING_PUBLISH_TOPIC, active.publishTopic) == 0) { copyTopic(persisted.publishTopic, active.publishTopic); stats.eepromWrites++; }
+        else ok = false;
+    }
+    if (strcmp(active.subscribeTopic, persisted.subscribeTopic) != 0)
+    {
+        if (DeviceConfig_Save(SETTING_SUBSCRIBE_TOPIC, active.subscribeTopic) == 0) { copyTopic(persisted.subscribeTopic, active.subscribeTopic); stats.eepromWrites++; }
+        else ok = false;
+    }
+    if (stats.eepromWrites != writes) ConfigCache_Invalidate();
+    return ok;
+}
+
+void RemoteConfig_Poll()
+{
+    if (stagedPending)
+    {
+        RuntimeConfig previous = active;
+        active = staged;
+        stagedPending = false;
+
+        if (appliedFn) appliedFn(&previous, &active);
+
+        stats.applied++;
+        stats.lastApplyUs = micros() - stagedAtUs;
+        if (stats.lastApplyUs > stats.maxApplyUs) stats.maxApplyUs = stats.lastApplyUs;
+        stats.persistPending = memcmp(&active, &persisted, sizeof(active)) != 0;
+        lastChangeMs = millis();
+        report("applied", "");
+    }
+
+    if (stats.persistPending && millis() - lastChangeMs >= REMOTE_CONFIG_PERSIST_DELAY_MS)
+        RemoteConfig_Flush();
+}
+
+void RemoteConfig_Flush()
+{
+    if (!stats.persistPending) return;
+
+    bool ok = persist();
+    // Retry failed writes after another quiet period
+    stats.persistPending = !ok;
+    lastChangeMs = millis();
+    LOG_INFO("Config persisted (%s), EEPROM writes so far: %lu\n",
+        ok ? "ok" : "failed", (unsigned long)stats.eepromWrites);
+}
+
+const RemoteConfigStats* RemoteConfig_GetStats()
+{
+    return &stats;
+}
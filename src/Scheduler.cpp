@@ -0,0 +1,219 @@
+/**
+ * @file Scheduler.cpp
+ * @brief Deadline-ordered cooperative task scheduler
+ */
+
+#include <Arduino.h>
+#include "Scheduler.h"
+
+struct SchedulerTask
+{
+    SchedulerTaskInfo info;
+    SchedulerTaskFn fn;
+    void* context;
+    int8_t heapPos;             // index in heap[], -1 while not queued
+};
+
+static SchedulerTask tasks[SCHEDULER_MAX_TASKS];
+static int taskCount = 0;
+static int8_t heap[SCHEDULER_MAX_TASKS];     // task ids, earliest deadline first
+static int heapSize = 0;
+static int running = -1;                    // task currently executing
+static bool runningRescheduled = false;
+static int slowest = -1;                    // longest run in the last RunDue()
+
+static uint32_t defaultClock()
+{
+    return millis();
+}
+
+static SchedulerClockFn clockFn = defaultClock;
+static uint32_t lastRaw = 0;
+static uint32_t epochs = 0;                 // completed wraps of the raw clock
+
+uint64_t Scheduler_Now()
+{
+    uint32_t raw = clockFn();
+    if (raw < lastRaw) epochs++;
+    lastRaw = raw;
+    return ((uint64_t)epochs << 32) | raw;
+}
+
+void Scheduler_SetClock(SchedulerClockFn clock)
+{
+    clockFn = clock ? clock : defaultClock;
+    lastRaw = clockFn();
+    epochs = 0;
+}
+
+// ===== Heap =====
+
+static bool earlier(int a, int b)
+{
+    return tasks[heap[a]].info.deadline < tasks[heap[b]].info.deadline;
+}
+
+static void swap(int a, int b)
+{
+    int8_t t = heap[a];
+    heap[a] = heap[b];
+    heap[b] = t;
+    tasks[heap[a]].heapPos = a;
+    tasks[heap[b]].heapPos = b;
+}
+
+static void siftUp(int i)
+{
+    while (i > 0 && earlier(i, (i - 1) / 2))
+    {
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void siftDown(int i)
+{
+    for (;;)
+    {
+        int smallest = i;
+        int left = 2 * i + 1, right = left + 1;
+        if (left < heapSize && earlier(left, smallest)) smallest = left;
+        if (right < heapSize && earlier(right, smallest)) smallest = right;
+        if (smallest == i) return;
+        swap(i, smallest);
+        i = smallest;
+    }
+}
+
+static void heapPush(int id)
+{
+    heap[heapSize] = (int8_t)id;
+    tasks[id].heapPos = heapSize++;
+    siftUp(heapSize - 1);
+}
+
+static void heapRemove(int id)
+{
+    int i = tasks[id].heapPos;
+    if (i < 0) return;
+
+    tasks[id].heapPos = -1;
+    if (--heapSize == i) return;
+
+    int moved = heap[heapSize];
+    heap[i] = (int8_t)moved;
+    tasks[moved].heapPos = i;
+    siftUp(i);
+    siftDown(tasks[moved].heapPos);
+}
+
+/**
+ * Move a task to a new deadline, queueing it if needed
+ */
+static void reschedule(int id, uint64_t deadline)
+{
+    heapRemove(id);
+    tasks[id].info.deadline = deadline;
+    heapPush(id);
+}
+
+// ===== API =====
+
+int Scheduler_Add(const char* name, SchedulerTaskFn fn, void* context, uint32_t periodMs, uint32_t firstDelayMs)
+{
+    if (taskCount >= SCHEDULER_MAX_TASKS || !fn) return -1;
+
+    int id = taskCount++;
+    SchedulerTask* t = &tasks[id];
+    memset(t, 0, sizeof(*t));
+    t->info.name = name;
+    t->info.periodMs = periodMs;
+    t->fn = fn;
+    t->context = context;
+    t->heapPos = -1;
+    reschedule(id, Scheduler_Now() + firstDelayMs);
+    return id;
+}
+
+void Scheduler_SetPeriod(int id, uint32_t periodMs)
+{
+    if (id < 0 || id >= taskCount) return;
+
+    tasks[id].info.periodMs = periodMs;
+    Scheduler_RunIn(id, periodMs);
+}
+
+void Scheduler_RunIn(int id, uint32_t delayMs)
+{
+    if (id < 0 || id >= taskCount) return;
+
+    // The running task is requeued after it returns
+    if (id == running) runningRescheduled = true;
+    reschedule(id, Scheduler_Now() + delayMs);
+}
+
+uint32_t Scheduler_RunDue()
+{
+    uint64_t now = Scheduler_Now();
+    uint32_t slowestUs = 0;
+    slowest = -1;
+
+    while (heapSize > 0 && tasks[heap[0]].info.deadline <= now)
+    {
+        int id = heap[0];
+        SchedulerTask* t = &tasks[id];
+        uint64_t due = t->info.deadline;
+        heapRemove(id);
+
+        uint32_t late = (uint32_t)(now - due);
+        if (late > t->info.maxLateMs) t->info.maxLateMs = late;
+
+        running = id;
+        runningRescheduled = false;
+        uint32_t startUs = micros();
+        t->fn(t->context);
+        uint32_t runUs = micros() - startUs;
+        running = -1;
+
+        t->info.runs++;
+        if (runUs > t->info.maxRunUs) t->info.maxRunUs = runUs;
+        if (slowest < 0 || runUs > slowestUs)
+        {
+            slowest = id;
+            slowestUs = runUs;
+        }
+
+        now = Scheduler_Now();
+        if (!runningRescheduled && t->info.periodMs > 0)
+        {
+            // Keep the original phase; skip periods that were missed entirely
+            uint64_t next = due + t->info.periodMs;
+            if (next <= now) next = now + t->info.periodMs;
+            reschedule(id, next);
+        }
+    }
+
+    if (heapSize == 0) return 0xFFFFFFFFu;
+    uint64_t wait = tasks[heap[0]].info.deadline - now;
+    return wait > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)wait;
+}
+
+int Scheduler_Count()
+{
+    return taskCount;
+}
+
+int Scheduler_Running()
+{
+    return running;
+}
+
+int Scheduler_LastSlowest()
+{
+    return slowest;
+}
+
+const SchedulerTaskInfo* Scheduler_GetInfo(int id)
+{
+    return (id >= 0 && id < taskCount) ? &tasks[id].info : NULL;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file SensorSampler.cpp
+ * @brief Sensor acquisition thread
+ */
+
+#include <Arduino.h>
+#include "SensorManager.h"
+#include "SensorSnapshot.h"
+#include "HealthMonitor.h"
+#include "MemMonitor.h"
+#include "SensorSampler.h"
+
+static rtos::Thread samplerThread(osPriorityAboveNormal, SENSOR_THREAD_STACK);
+static rtos::Mutex* bus = NULL;
+static SensorSamplerStats stats;
+static int healthId = -1;
+
+static void samplerMain()
+{
+    static char json[512];
+    static SensorReadings readings;
+
+    for (;;)
+    {
+        unsigned long start = millis();
+        uint32_t startUs = micros();
+
+        bus->lock();
+        bool ok = Sensors.toJson(json, sizeof(json));
+        bus->unlock();
+
+        uint32_t readUs = micros() - startUs;
+        if (readUs > stats.maxReadUs) stats.maxReadUs = readUs;
+
+        stats.samples++;
+        // The motion sensors are only exposed through Sensors.toJson(), so
+        // the whole set is read that way and parsed back into numbers
+        if (ok && SensorSnapshot_Parse(json, strlen(json), &readings))
+        {
+            readings.takenAt = start;
+            readings.sample = stats.samples;
+            SensorSnapshot_Write(&readings);
+        }
+        else
+        {
+            stats.failed++;
+        }
+
+        Health_CheckIn(healthId);
+        unsigned long elapsed = millis() - start;
+        rtos::Thread::wait(elapsed < SENSOR_SAMPLE_MS ? SENSOR_SAMPLE_MS - elapsed : 1);
+    }
+}
+
+void SensorSampler_Start(rtos::Mutex* i2c)
+{
+    bus = i2c;
+    stats.stackSize = SENSOR_THREAD_STACK;
+    healthId = Health_Register("sensor", SENSOR_STALL_MS);
+    Mem_AddThread("sensor", &samplerThread, SENSOR_THREAD_STACK);
+    samplerThread.start(callback(samplerMain));
+}
+
+const SensorSamplerStats* SensorSampler_GetStats()
+{
+    stats.stackMaxUsed = samplerThread.max_stack();
+    return &stats;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file SensorSnapshot.cpp
+ * @brief Latest sensor readings shared through a seqlock
+ */
+
+#include <Arduino.h>
+#include "mbed.h"
+#include "JsonLite.h"
+#include "RemoteConfig.h"
+#include "SensorSnapshot.h"
+
+static SensorReadings current;
+static volatile uint32_t sequence = 0;      // odd while a write is in progress
+static SensorSnapshotStats stats;
+
+/**
+ * Read {"x":..,"y":..,"z":..} for one motion sensor
+ */
+static bool parseAxes(const char* json, size_t length, const char* key, int32_t* axes)
+{
+    static const char* const names[] = { "x", "y", "z" };
+    size_t rawLen;
+    const char* raw = Json_GetRaw(json, length, key, &rawLen);
+    if (!raw) return false;
+
+    int32_t values[3];
+    for (int i = 0; i < 3; i++)
+    {
+        long value;
+        if (!Json_GetInt(raw, rawLen, names[i], &value)) return false;
+        values[i] = (int32_t)value;
+    }
+    memcpy(axes, values, sizeof(values));
+    return true;
+}
+
+bool SensorSnapshot_Parse(const char* json, size_t length, SensorReadings* r)
+{
+    // In SENSOR_* bit order
+    static const char* const scalars[] = { "temperature", "humidity", "pressure" };
+    static const char* const motion[] = { "accelerometer", "gyroscope", "magnetometer" };
+    float* scalarOut[] = { &r->temperature, &r->humidity, &r->pressure };
+    int32_t* motionOut[] = { r->accel, r->gyro, r->mag };
+
+    r->present = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (Json_GetFloat(json, length, scalars[i], scalarOut[i])) r->present |= SENSOR_TEMPERATURE << i;
+        if (parseAxes(json, length, motion[i], motionOut[i])) r->present |= SENSOR_ACCELEROMETER << i;
+    }
+    return r->present != 0;
+}
+
+void SensorSnapshot_Write(const SensorReadings* readings)
+{
+    sequence++;
+    __DMB();
+    memcpy(&current, readings, sizeof(current));
+    __DMB();
+    sequence++;
+    stats.writes++;
+}
+
+bool SensorSnapshot_Read(SensorReadings* out)
+{
+    for (;;)
+    {
+        uint32_t before = sequence;
+        if (before == 0) return false;
+        if (before & 1)
+        {
+            // Let the writer finish
+            stats.retries++;
+            rtos::Thread::yield();
+            continue;
+        }
+
+        __DMB();
+        memcpy(out, &current, sizeof(*out));
+        __DMB();
+        if (sequence == before) break;
+        stats.retries++;
+    }
+    stats.reads++;
+    return true;
+}
+
+const SensorSnapshotStats* SensorSnapshot_GetStats()
+{
+    return &stats;
+}
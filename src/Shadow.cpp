@@ -0,0 +1,212 @@
+/**
+ * @file Shadow.cpp
+ * @brief Device shadow: desired/reported state table with delta sync
+ */
+
+#include <Arduino.h>
+#include "JsonLite.h"
+#include "Log.h"
+#include "Shadow.h"
+
+struct ShadowProperty
+{
+    const char* name;
+    ShadowType type;
+    ShadowValue desired;
+    ShadowValue reported;
+    ShadowApplyFn apply;
+};
+
+static ShadowProperty properties[SHADOW_MAX_PROPERTIES];
+static int propertyCount = 0;
+static uint32_t dirty = 0;              // bit per property awaiting report
+static long desiredVersion = -1;        // last desired version applied
+static uint32_t reportedVersion = 0;
+static unsigned long lastReport = 0;
+static bool continuing = false;         // the last report was split
+static ShadowStats stats;
+static ShadowPublishFn publishFn = NULL;
+
+static bool equal(ShadowType type, ShadowValue a, ShadowValue b)
+{
+    switch (type)
+    {
+    case SHADOW_FLOAT: return a.f == b.f;
+    case SHADOW_BOOL:  return a.b == b.b;
+    default:           return a.i == b.i;
+    }
+}
+
+/**
+ * Parse the value of property p from the desired state object
+ */
+static bool parseValue(const ShadowProperty* p, const char* state, size_t length, ShadowValue* value)
+{
+    long i;
+    size_t rawLen;
+    const char* raw;
+
+    switch (p->type)
+    {
+    case SHADOW_FLOAT:
+        return Json_GetFloat(state, length, p->name, &value->f);
+    case SHADOW_BOOL:
+        raw = Json_GetRaw(state, length, p->name, &rawLen);
+        if (!raw) return false;
+        if (rawLen == 4 && memcmp(raw, "true", 4) == 0) { value->b = true; return true; }
+        if (rawLen == 5 && memcmp(raw, "false", 5) == 0) { value->b = false; return true; }
+        return false;
+    default:
+        if (!Json_GetInt(state, length, p->name, &i)) return false;
+        value->i = (int32_t)i;
+        return true;
+    }
+}
+
+static int formatValue(char* buf, size_t size, const ShadowProperty* p)
+{
+    switch (p->type)
+    {
+    case SHADOW_FLOAT: return snprintf(buf, size, "\"%s\":%.2f", p->name, p->reported.f);
+    case SHADOW_BOOL:  return snprintf(buf, size, "\"%s\":%s", p->name, p->reported.b ? "true" : "false");
+    default:           return snprintf(buf, size, "\"%s\":%ld", p->name, (long)p->reported.i);
+    }
+}
+
+void Shadow_Init(ShadowPublishFn publish)
+{
+    publishFn = publish;
+}
+
+int Shadow_Define(const char* name, ShadowType type, ShadowValue initial, ShadowApplyFn apply)
+{
+    if (propertyCount >= SHADOW_MAX_PROPERTIES) return -1;
+
+    ShadowProperty* p = &properties[propertyCount];
+    p->name = name;
+    p->type = type;
+    p->desired = initial;
+    p->reported = initial;
+    p->apply = apply;
+    dirty |= 1u << propertyCount;
+    return propertyCount++;
+}
+
+ShadowValue Shadow_GetReported(int index)
+{
+    ShadowValue none = {};
+    return (index >= 0 && index < propertyCount) ? properties[index].reported : none;
+}
+
+ShadowValue Shadow_GetDesired(int index)
+{
+    ShadowValue none = {};
+    return (index >= 0 && index < propertyCount) ? properties[index].desired : none;
+}
+
+void Shadow_SetReported(int index, ShadowValue value)
+{
+    if (index < 0 || index >= propertyCount) return;
+
+    ShadowProperty* p = &properties[index];
+    if (equal(p->type, p->reported, value)) return;
+    p->reported = value;
+    dirty |= 1u << index;
+}
+
+void Shadow_OnDesired(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    const char* json = (const char*)payload;
+    long version;
+    size_t stateLen;
+
+    if (!Json_GetInt(json, length, "version", &version)) return;
+    if (version <= desiredVersion)
+    {
+        LOG_WARN("Shadow: discarding stale version %ld (have %ld)\n", version, desiredVersion);
+        return;
+    }
+
+    const char* state = Json_GetRaw(json, length, "state", &stateLen);
+    if (!state) return;
+    desiredVersion = version;
+
+    for (int i = 0; i < propertyCount; i++)
+    {
+        ShadowProperty* p = &properties[i];
+        ShadowValue value;
+        if (!parseValue(p, state, stateLen, &value)) continue;
+
+        p->desired = value;
+        if (p->apply && p->apply(i, value))
+            Shadow_SetReported(i, value);
+        else
+            dirty |= 1u << i;   // report the value actually in effect
+    }
+}
+
+void Shadow_MarkAllDirty()
+{
+    dirty = propertyCount >= 32 ? 0xFFFFFFFFu : (1u << propertyCount) - 1;
+}
+
+void Shadow_Poll()
+{
+    if (dirty == 0 || !publishFn) return;
+    // The rest of a split report goes out without waiting
+    if (!continuing && millis() - lastReport < SHADOW_REPORT_MIN_MS) return;
+
+    char json[SHADOW_REPORT_MAX];
+    int header = snprintf(json, sizeof(json), "{\"version\":%lu,\"desiredVersion\":%ld,\"state\":{",
+        (unsigned long)(reportedVersion + 1), desiredVersion);
+    int len = header;
+    uint32_t sent = 0;
+    bool more = false;
+
+    for (int i = 0; i < propertyCount; i++)
+    {
+        uint32_t bit = 1u << i;
+        if (!(dirty & bit)) continue;
+
+        // Format after a separator, leaving room for the closing braces
+        int comma = sent ? 1 : 0;
+        int n = formatValue(json + len + comma, sizeof(json) - len - comma, &properties[i]);
+        if (n >= 0 && len + comma + n + 2 < (int)sizeof(json))
+        {
+            if (comma) json[len] = ',';
+            len += comma + n;
+            sent |= bit;
+        }
+        else if (n < 0 || header + n + 2 >= (int)sizeof(json))
+        {
+            // Would not fit in any report; retrying cannot help
+            LOG_WARN("Shadow: %s does not fit in a report, dropped\n", properties[i].name);
+            stats.dropped++;
+            dirty &= ~bit;
+        }
+        else
+        {
+            more = true;
+        }
+    }
+    if (sent == 0) return;
+
+    json[len++] = '}';
+    json[len++] = '}';
+    json[len] = '\0';
+
+    if (publishFn(json))
+    {
+        reportedVersion++;
+        dirty &= ~sent;
+        continuing = more;
+        lastReport = millis();
+        stats.reports++;
+        if (more) stats.splits++;
+    }
+}
+
+const ShadowStats* Shadow_GetStats()
+{
+    return &stats;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file TimeSync.cpp
+ * @brief Non-blocking SNTP client
+ */
+
+#include <Arduino.h>
+#include "mbed.h"
+#include "SystemWiFi.h"
+#include "DnsCache.h"
+#include "BootProfile.h"
+#include "Log.h"
+#include "TimeSync.h"
+
+#define NTP_PORT 123
+#define NTP_PACKET_SIZE 48
+#define NTP_MODE_CLIENT 3
+#define NTP_MODE_SERVER 4
+#define NTP_VERSION 3
+#define NTP_TX_TIME_OFFSET 40
+// Seconds from 1900-01-01 (NTP epoch) to 1970-01-01 (Unix epoch)
+#define NTP_UNIX_OFFSET 2208988800UL
+
+static UDPSocket sock;
+static bool sockOpen = false;
+static bool waiting = false;            // request in flight
+static bool synced = false;
+static bool gaveUp = false;            // a round failed before the first sync
+static int failedInRound = 0;
+static unsigned long sentAt = 0;
+static unsigned long nextAt = 0;        // next request due
+static TimeSyncStats stats;
+
+static void closeSocket()
+{
+    if (sockOpen) sock.close();
+    sockOpen = false;
+    waiting = false;
+}
+
+static bool sendRequest()
+{
+    char addr[DNS_CACHE_ADDR_LEN];
+    if (DnsCache_Resolve(TIME_SYNC_SERVER, addr, sizeof(addr)) != 0) return false;
+
+    if (!sockOpen)
+    {
+        if (sock.open(WiFiInterface()) != 0) return false;
+        sock.set_blocking(false);
+        sockOpen = true;
+    }
+
+    uint8_t packet[NTP_PACKET_SIZE];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = (NTP_VERSION << 3) | NTP_MODE_CLIENT;
+
+    SocketAddress server(addr, NTP_PORT);
+    if (sock.sendto(server, packet, sizeof(packet)) != NTP_PACKET_SIZE)
+    {
+        closeSocket();
+        return false;
+    }
+
+    stats.requests++;
+    sentAt = millis();
+    BootProfile_Begin(BOOT_NTP);
+    waiting = true;
+    return true;
+}
+
+/**
+ * Set the clock from a server reply. Returns false if it is not valid.
+ */
+static bool applyReply(const uint8_t* packet, unsigned long rttMs)
+{
+    uint8_t mode = packet[0] & 0x07;
+    uint8_t stratum = packet[1];
+    if (mode != NTP_MODE_SERVER || stratum == 0) return false;
+
+    const uint8_t* tx = packet + NTP_TX_TIME_OFFSET;
+    uint32_t ntpSeconds = ((uint32_t)tx[0] << 24) | ((uint32_t)tx[1] << 16) | ((uint32_t)tx[2] << 8) | tx[3];
+    if (ntpSeconds < NTP_UNIX_OFFSET) return false;
+
+    // The server stamped its reply about half a round trip ago
+    time_t now = (time_t)(ntpSeconds - NTP_UNIX_OFFSET) + (time_t)((rttMs / 2 + 500) / 1000);
+    stats.lastStepS = (int32_t)(now - time(NULL));
+    set_time(now);
+
+    stats.syncs++;
+    stats.lastRttMs = rttMs;
+    if (!synced) stats.firstSyncMs = millis();
+    synced = true;
+    gaveUp = false;
+    BootProfile_End(BOOT_NTP);
+    return true;
+}
+
+/**
+ * Record a failed request; give up the round after TIME_SYNC_ATTEMPTS
+ */
+static void failed()
+{
+    closeSocket();
+    if (++failedInRound >= TIME_SYNC_ATTEMPTS)
+    {
+        failedInRound = 0;
+        gaveUp = !synced;
+        nextAt = millis() + TIME_SYNC_RETRY_MS;
+        LOG_WARN("Time sync failed, retrying later\n");
+    }
+}
+
+uint32_t TimeSync_Run()
+{
+    unsigned long now = millis();
+
+    if (!waiting)
+    {
+        if ((long)(now - nextAt) < 0) return nextAt - now;
+        if (!sendRequest()) failed();
+        return waiting ? TIME_SYNC_POLL_MS : TIME_SYNC_TIMEOUT_MS;
+    }
+
+    uint8_t packet[NTP_PACKET_SIZE];
+    SocketAddress from;
+    int received = sock.recvfrom(&from, packet, sizeof(packet));
+    if (received == NSAPI_ERROR_WOULD_BLOCK)
+    {
+        if (now - sentAt < TIME_SYNC_TIMEOUT_MS) return TIME_SYNC_POLL_MS;
+        stats.timeouts++;
+        failed();
+        return 0;
+    }
+
+    if (received != NTP_PACKET_SIZE || !applyReply(packet, now - sentAt))
+    {
+        failed();
+        return 0;
+    }
+
+    closeSocket();
+    failedInRound = 0;
+    nextAt = now + TIME_SYNC_RESYNC_MS;
+    LOG_INFO("Time synced in %lu ms round trip (step %ld s)\n",
+        (unsigned long)stats.lastRttMs, (long)stats.lastStepS);
+    return TIME_SYNC_RESYNC_MS;
+}
+
+bool TimeSync_IsSynced()
+{
+    return synced;
+}
+
+bool TimeSync_GaveUp()
+{
+    return gaveUp;
+}
+
+const TimeSyncStats* TimeSync_GetStats()
+{
+    return &stats;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file TopicRouter.cpp
+ * @brief Topic-level trie routing inbound MQTT messages to handlers
+ */
+
+#include <string.h>
+#include "TopicRouter.h"
+
+#define NONE (-1)
+
+struct RouteNode
+{
+    const char* level;      // points into the registered pattern
+    uint16_t levelLen;
+    uint16_t hash;          // cheap pre-check before comparing levels
+    int16_t parent;         // key of this node in childIndex
+    int16_t plusChild;      // '+' child
+    int16_t handler;        // pattern ending at this node
+    int16_t hashHandler;    // pattern ending in '#' below this node
+};
+
+struct RouteHandler
+{
+    const char* pattern;
+    TopicHandler fn;
+    void* context;
+};
+
+static RouteNode nodes[TOPIC_ROUTER_MAX_NODES];
+static RouteHandler handlers[TOPIC_ROUTER_MAX_HANDLERS];
+static int nodeCount = 0;
+// Literal children of every node, open-addressed by (parent, level hash) so
+// finding a child does not depend on how many siblings it has
+static int16_t childIndex[TOPIC_ROUTER_INDEX_SIZE];
+static int handlerCount = 0;
+
+static uint16_t levelHash(const char* s, size_t len)
+{
+    uint16_t h = (uint16_t)len;
+    for (size_t i = 0; i < len; i++)
+        h = (uint16_t)(h * 31 + (uint8_t)s[i]);
+    return h;
+}
+
+static int newNode(const char* level, size_t len)
+{
+    if (nodeCount >= TOPIC_ROUTER_MAX_NODES) return NONE;
+
+    RouteNode* n = &nodes[nodeCount];
+    n->level = level;
+    n->levelLen = (uint16_t)len;
+    n->hash = levelHash(level, len);
+    n->parent = NONE;
+    n->plusChild = NONE;
+    n->handler = n->hashHandler = NONE;
+    return nodeCount++;
+}
+
+static unsigned indexSlot(int parent, uint16_t hash)
+{
+    return (((uint32_t)parent * 2654435761u) ^ ((uint32_t)hash * 40503u)) % TOPIC_ROUTER_INDEX_SIZE;
+}
+
+/**
+ * Look up a literal child. The index has more slots than there are nodes, so
+ * the probe always ends at an empty slot.
+ */
+static int findChild(int parent, const char* level, size_t len, uint16_t hash)
+{
+    for (unsigned i = indexSlot(parent, hash); childIndex[i] != NONE; i = (i + 1) % TOPIC_ROUTER_INDEX_SIZE)
+    {
+        const RouteNode* n = &nodes[childIndex[i]];
+        if (n->parent == parent && n->hash == hash && n->levelLen == len && memcmp(n->level, level, len) == 0)
+            return childIndex[i];
+    }
+    return NONE;
+}
+
+static void indexChild(int parent, int child)
+{
+    unsigned i = indexSlot(parent, nodes[child].hash);
+    while (childIndex[i] != NONE) i = (i + 1) % TOPIC_ROUTER_INDEX_SIZE;
+    childIndex[i] = (int16_t)child;
+    nodes[child].parent = (int16_t)parent;
+}
+
+/**
+ * Store a handler, reusing the slot of an existing registration
+ */
+static int setHandler(int16_t* slot, const char* pattern, TopicHandler fn, void* context)
+{
+    int index = *slot;
+    if (index == NONE)
+    {
+        if (handlerCount >= TOPIC_ROUTER_MAX_HANDLERS) return NONE;
+        index = handlerCount++;
+        *slot = (int16_t)index;
+    }
+    handlers[index].pattern = pattern;
+    handlers[index].fn = fn;
+    handlers[index].context = context;
+    return index;
+}
+
+void TopicRouter_Clear()
+{
+    nodeCount = 0;
+    handlerCount = 0;
+    memset(childIndex, 0xFF, sizeof(childIndex));     // all NONE
+    newNode("", 0);     // root
+}
+
+bool TopicRouter_Add(const char* pattern, TopicHandler handler, void* context)
+{
+    if (pattern == NULL || pattern[0] == '\0' || handler == NULL) return false;
+    if (nodeCount == 0) TopicRouter_Clear();
+
+    int node = 0;
+    const char* level = pattern;
+    while (true)
+    {
+        const char* end = strchr(level, '/');
+        size_t len = end ? (size_t)(end - level) : strlen(level);
+
+        if (len == 1 && level[0] == '#')
+        {
+            // '#' must be the last level
+            if (end) return false;
+            return setHandler(&nodes[node].hashHandler, pattern, handler, context) != NONE;
+        }
+
+        int child;
+        if (len == 1 && level[0] == '+')
+        {
+            child = nodes[node].plusChild;
+            if (child == NONE)
+            {
+                child = newNode(level, len);
+                if (child == NONE) return false;
+                nodes[node].plusChild = (int16_t)child;
+            }
+        }
+        else
+        {
+            // Wildcards are only valid as a whole level
+            if (memchr(level, '+', len) || memchr(level, '#', len)) return false;
+
+            uint16_t hash = levelHash(level, len);
+            child = findChild(node, level, len, hash);
+            if (child == NONE)
+            {
+                child = newNode(level, len);
+                if (child == NONE) return false;
+                indexChild(node, child);
+            }
+        }
+
+        node = child;
+        if (!end) break;
+        level = end + 1;
+    }
+
+    return setHandler(&nodes[node].handler, pattern, handler, context) != NONE;
+}
+
+struct DispatchContext
+{
+    const char* topic;
+    const uint8_t* payload;
+    unsigned int length;
+    int calls;
+};
+
+static void invoke(DispatchContext* ctx, int handler)
+{
+    if (handler == NONE) return;
+    handlers[handler].fn(ctx->topic, ctx->payload, ctx->length, handlers[handler].context);
+    ctx->calls++;
+}
+
+/**
+ * Match the topic levels starting at level against the subtree of node
+ */
+static void walk(DispatchContext* ctx, int node, const char* level, bool first)
+{
+    // Topics beginning with '$' are not matched by wildcards at the first level
+    bool wildcardsAllowed = !(first && level[0] == '$');
+
+    // "a/#" also matches "a" itself
+    if (wildcardsAllowed) invoke(ctx, nodes[node].hashHandler);
+
+    const char* end = strchr(level, '/');
+    size_t len = end ? (size_t)(end - level) : strlen(level);
+    uint16_t hash = levelHash(level, len);
+
+    int literal = findChild(node, level, len, hash);
+    int plus = wildcardsAllowed ? nodes[node].plusChild : NONE;
+
+    if (end)
+    {
+        if (literal != NONE) walk(ctx, literal, end + 1, false);
+        if (plus != NONE) walk(ctx, plus, end + 1, false);
+    }
+    else
+    {
+        if (literal != NONE)
+        {
+            invoke(ctx, nodes[literal].handler);
+            invoke(ctx, nodes[literal].hashHandler);
+        }
+        if (plus != NONE)
+        {
+            invoke(ctx, nodes[plus].handler);
+            invoke(ctx, nodes[plus].hashHandler);
+        }
+    }
+}
+
+int TopicRouter_Dispatch(const char* topic, const uint8_t* payload, unsigned int length)
+{
+    if (nodeCount == 0 || topic == NULL) return 0;
+
+    DispatchContext ctx = { topic, payload, length, 0 };
+    walk(&ctx, 0, topic, true);
+    return ctx.calls;
+}
+
+int TopicRouter_Count()
+{
+    return handlerCount;
+}
+
+const char* TopicRouter_GetPattern(int index)
+{
+    return (index >= 0 && index < handlerCount) ? handlers[index].pattern : NULL;
+}
+
+size_t TopicRouter_BuildSubscribe(uint8_t* buf, size_t size, uint16_t packetId, uint8_t qos, int* next)
+{
+    // Variable header (packet id) plus as many topic filters as fit, leaving
+    // up to 5 bytes for the fixed header
+    const size_t headerMax = 5;
+    if (size <= headerMax + 2) return 0;
+
+    size_t body = 2;
+    int last = *next;
+    while (last < handlerCount)
+    {
+        size_t need = 2 + strlen(handlers[last].pattern) + 1;
+        if (headerMax + body + need > size) break;
+        body += need;
+        last++;
+    }
+    if (last == *next) return 0;
+
+    // Fixed header: SUBSCRIBE with reserved flags 0b0010, then remaining length
+    size_t pos = 0;
+    buf[pos++] = 0x82;
+    size_t remaining = body;
+    do
+    {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        if (remaining > 0) digit |= 0x80;
+        buf[pos++] = digit;
+    } while (remaining > 0);
+
+    buf[pos++] = (uint8_t)(packetId >> 8);
+    buf[pos++] = (uint8_t)(packetId & 0xFF);
+
+    for (int i = *next; i < last; i++)
+    {
+        size_t len = strlen(handlers[i].pattern);
+        buf[pos++] = (uint8_t)(len >> 8);
+        buf[pos++] = (uint8_t)(len & 0xFF);
+        memcpy(buf + pos, handlers[i].pattern, len);
+        pos += len;
+        buf[pos++] = qos;
+    }
+
+    *next = last;
+    return pos;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file Trace.cpp
+ * @brief Binary event trace in a RAM ring, dumped over MQTT on request
+ */
+
+#include <Arduino.h>
+#include "JsonLite.h"
+#include "Log.h"
+#include "Trace.h"
+
+#if (TRACE_RECORDS & (TRACE_RECORDS - 1)) != 0
+#error "TRACE_RECORDS must be a power of two"
+#endif
+
+TraceRecord traceRing[TRACE_RECORDS];
+uint32_t traceCount = 0;
+bool tracePaused = false;
+
+static bool dumping = false;
+static uint16_t dumpId = 0;
+static uint16_t dumpSeq = 0;
+static uint32_t dumpFirst = 0;          // count of the oldest record to send
+static uint32_t dumpTotal = 0;
+static uint32_t dumpSent = 0;
+
+static void put16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void startDump()
+{
+    dumpId++;
+    Trace_Record(TRACE_DUMP, dumpId);
+    tracePaused = true;
+
+    dumpTotal = traceCount < TRACE_RECORDS ? traceCount : TRACE_RECORDS;
+    dumpFirst = traceCount - dumpTotal;
+    dumpSent = 0;
+    dumpSeq = 0;
+    dumping = true;
+    LOG_INFO("Trace: dump %u, %lu records\n", dumpId, (unsigned long)dumpTotal);
+}
+
+void Trace_OnCommand(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    char command[8];
+    if (!Json_GetString((const char*)payload, length, "trace", command, sizeof(command)))
+    {
+        LOG_WARN("Trace: unknown command\n");
+        return;
+    }
+
+    if (strcmp(command, "dump") == 0)
+    {
+        if (!dumping) startDump();
+    }
+    else if (strcmp(command, "clear") == 0)
+    {
+        if (!dumping) traceCount = 0;
+    }
+    else
+    {
+        LOG_WARN("Trace: unknown command '%s'\n", command);
+    }
+}
+
+bool Trace_DumpPending()
+{
+    return dumping;
+}
+
+size_t Trace_NextChunk(uint8_t* buf, size_t size)
+{
+    if (!dumping || size < TRACE_HEADER_SIZE + sizeof(TraceRecord)) return 0;
+
+    uint32_t count = dumpTotal - dumpSent;
+    uint32_t room = (size - TRACE_HEADER_SIZE) / sizeof(TraceRecord);
+    if (count > room) count = room;
+    if (count > TRACE_CHUNK_RECORDS) count = TRACE_CHUNK_RECORDS;
+    bool last = dumpSent + count == dumpTotal;
+
+    buf[0] = TRACE_FORMAT_VERSION;
+    buf[1] = last ? TRACE_FLAG_LAST : 0;
+    put16(buf + 2, dumpId);
+    put16(buf + 4, dumpSeq++);
+    put16(buf + 6, (uint16_t)count);
+    put32(buf + 8, TRACE_CLOCK_HZ);
+    put32(buf + 12, traceCount);
+
+    uint8_t* p = buf + TRACE_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++, p += sizeof(TraceRecord))
+    {
+        const TraceRecord* r = &traceRing[(dumpFirst + dumpSent + i) & (TRACE_RECORDS - 1)];
+        put32(p, r->time);
+        put16(p + 4, r->event);
+        put16(p + 6, r->a);
+        put32(p + 8, r->b);
+    }
+    dumpSent += count;
+
+    if (last) Trace_AbortDump();
+    return TRACE_HEADER_SIZE + count * sizeof(TraceRecord);
+}
+
+void Trace_AbortDump()
+{
+    dumping = false;
+    tracePaused = false;
+}
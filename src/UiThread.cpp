@@ -0,0 +1,143 @@
+/**
+ * @file UiThread.cpp
+ * @brief UI thread owning the OLED and RGB LED
+ */
+
+#include <Arduino.h>
+#include "SpscRing.h"
+#include "HealthMonitor.h"
+#include "MemMonitor.h"
+#include "UiThread.h"
+
+#define UI_SIGNAL_EVENT 0x1
+
+enum UiEventType
+{
+    UI_EVENT_LINES,
+    UI_EVENT_PATTERN,
+    UI_EVENT_FLASH
+};
+
+struct UiEvent
+{
+    uint8_t type;
+    uint8_t rgb[3];
+    uint16_t ms;
+    const LedPattern* pattern;
+    char lines[3][DISPLAY_COLS + 1];
+};
+
+static rtos::Thread uiThread(osPriorityBelowNormal, UI_THREAD_STACK);
+static SpscRing<UiEvent, UI_RING_SIZE> ring;
+static rtos::Mutex* bus = NULL;
+static DisplayWriteFn displayFn = NULL;
+static UiStats stats;
+static int healthId = -1;
+
+/**
+ * Display writer used by DisplayModel on the UI thread
+ */
+static void lockedWrite(int line, const char* text)
+{
+    bus->lock();
+    displayFn(line, text);
+    bus->unlock();
+}
+
+static void apply(const UiEvent* e)
+{
+    switch (e->type)
+    {
+    case UI_EVENT_LINES:
+        Display_SetLines(e->lines[0], e->lines[1], e->lines[2]);
+        break;
+    case UI_EVENT_PATTERN:
+        LedEffects_SetBase(e->pattern);
+        break;
+    case UI_EVENT_FLASH:
+        LedEffects_Flash(e->rgb[0], e->rgb[1], e->rgb[2], e->ms);
+        break;
+    }
+    stats.events++;
+}
+
+static void uiMain()
+{
+    UiEvent event;
+
+    for (;;)
+    {
+        Health_CheckIn(healthId);
+        while (ring.pop(&event)) apply(&event);
+
+        uint32_t ledNext = LedEffects_Run();
+        uint32_t displayNext = Display_Refresh();
+        uint32_t wait = ledNext < displayNext ? ledNext : displayNext;
+        if (wait > UI_MAX_SLEEP_MS) wait = UI_MAX_SLEEP_MS;
+
+        // Sleep until the next step is due or another event is posted
+        rtos::Thread::signal_wait(UI_SIGNAL_EVENT, wait);
+    }
+}
+
+static bool post(const UiEvent& event)
+{
+    if (!ring.push(event))
+    {
+        stats.dropped++;
+        return false;
+    }
+    uiThread.signal_set(UI_SIGNAL_EVENT);
+    return true;
+}
+
+void Ui_Start(DisplayWriteFn display, LedOutputFn led, rtos::Mutex* i2c)
+{
+    bus = i2c;
+    displayFn = display;
+    Display_Init(lockedWrite);
+    LedEffects_Init(led);
+    stats.stackSize = UI_THREAD_STACK;
+    healthId = Health_Register("ui", UI_STALL_MS);
+    Mem_AddThread("ui", &uiThread, UI_THREAD_STACK);
+    uiThread.start(callback(uiMain));
+}
+
+void Ui_PostLines(const char* line1, const char* line2, const char* line3)
+{
+    UiEvent event;
+    const char* text[3] = { line1, line2, line3 };
+
+    event.type = UI_EVENT_LINES;
+    for (int i = 0; i < 3; i++)
+    {
+        strncpy(event.lines[i], text[i] ? text[i] : "", DISPLAY_COLS);
+        event.lines[i][DISPLAY_COLS] = '\0';
+    }
+    post(event);
+}
+
+bool Ui_PostLedPattern(const LedPattern* pattern)
+{
+    UiEvent event;
+    event.type = UI_EVENT_PATTERN;
+    event.pattern = pattern;
+    return post(event);
+}
+
+void Ui_PostFlash(uint8_t r, uint8_t g, uint8_t b, uint16_t ms)
+{
+    UiEvent event;
+    event.type = UI_EVENT_FLASH;
+    event.rgb[0] = r;
+    event.rgb[1] = g;
+    event.rgb[2] = b;
+    event.ms = ms;
+    post(event);
+}
+
+const UiStats* Ui_GetStats()
+{
+    stats.stackMaxUsed = uiThread.max_stack();
+    return &stats;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file WiFiReconnect.cpp
+ * @brief Non-blocking Wi-Fi reconnect with a cached access point and lease
+ */
+
+#include <Arduino.h>
+#include "mico.h"
+#include "ConfigCache.h"
+#include "BootProfile.h"
+#include "Log.h"
+#include "WiFiReconnect.h"
+
+struct CachedLink
+{
+    bool valid;
+    uint8_t bssid[6];
+    uint8_t channel;
+    char ip[16];
+    char mask[16];
+    char gateway[16];
+    char dns[16];
+    unsigned long leaseAt;      // when the address was obtained via DHCP
+};
+
+enum ReconnectState
+{
+    STATE_IDLE,
+    STATE_FAST,
+    STATE_SCAN
+};
+
+static CachedLink cached;
+static ReconnectState state = STATE_IDLE;
+static unsigned long droppedAt = 0;
+static unsigned long stepAt = 0;
+static bool usingLease = false;
+static bool joining = false;            // first association after boot
+static WiFiReconnectStats stats;
+
+static void copyAddr(char* dst, const char* src)
+{
+    strncpy(dst, src, 15);
+    dst[15] = '\0';
+}
+
+static bool associated()
+{
+    LinkStatusTypeDef link;
+    return micoWlanGetLinkStatus(&link) == kNoErr && link.is_connected;
+}
+
+static bool linkUp()
+{
+    IPStatusTypedef ip;
+
+    if (!associated()) return false;
+    if (micoWlanGetIPStatus(&ip, Station) != kNoErr) return false;
+    return ip.ip[0] != '\0' && strcmp(ip.ip, "0.0.0.0") != 0;
+}
+
+/**
+ * Join the cached access point directly, without scanning
+ */
+static bool startFast()
+{
+    network_InitTypeDef_adv_st params;
+    memset(&params, 0, sizeof(params));
+
+    strncpy(params.ap_info.ssid, ConfigCache_Get(CONFIG_WIFI_SSID), sizeof(params.ap_info.ssid) - 1);
+    memcpy(params.ap_info.bssid, cached.bssid, sizeof(cached.bssid));
+    params.ap_info.channel = cached.channel;
+    params.ap_info.security = SECURITY_TYPE_AUTO;
+    strncpy(params.key, ConfigCache_Get(CONFIG_WIFI_PASSWORD), sizeof(params.key) - 1);
+    params.key_len = strlen(params.key);
+    params.wifi_retry_interval = 100;
+
+    usingLease = WIFI_LEASE_REUSE_MS > 0 && millis() - cached.leaseAt < WIFI_LEASE_REUSE_MS;
+    if (usingLease)
+    {
+        params.dhcpMode = DHCP_Disable;
+        copyAddr(params.local_ip_addr, cached.ip);
+        copyAddr(params.net_mask, cached.mask);
+        copyAddr(params.gateway_ip_addr, cached.gateway);
+        copyAddr(params.dnsServer_ip_addr, cached.dns);
+    }
+    else
+    {
+        params.dhcpMode = DHCP_Client;
+    }
+
+    return micoWlanStartAdv(&params) == kNoErr;
+}
+
+/**
+ * Scan for the configured network and use DHCP
+ */
+static bool startScan()
+{
+    network_InitTypeDef_st params;
+    memset(&params, 0, sizeof(params));
+
+    params.wifi_mode = Station;
+    strncpy(params.wifi_ssid, ConfigCache_Get(CONFIG_WIFI_SSID), sizeof(params.wifi_ssid) - 1);
+    strncpy(params.wifi_key, ConfigCache_Get(CONFIG_WIFI_PASSWORD), sizeof(params.wifi_key) - 1);
+    params.dhcpMode = DHCP_Client;
+    params.wifi_retry_interval = 100;
+
+    usingLease = false;
+    return micoWlanStart(&params) == kNoErr;
+}
+
+static void enter(ReconnectState next)
+{
+    bool ok = (next == STATE_FAST) ? startFast() : startScan();
+    state = next;
+    stepAt = millis();
+    LOG_INFO("WiFi: %s%s%s\n", joining ? "join" : (next == STATE_FAST ? "direct reconnect" : "scan reconnect"),
+        usingLease ? " with previous address" : "", ok ? "" : " (start failed)");
+}
+
+void WiFiReconnect_Remember()
+{
+    LinkStatusTypeDef link;
+    IPStatusTypedef ip;
+
+    if (micoWlanGetLinkStatus(&link) != kNoErr || !link.is_connected) return;
+    if (micoWlanGetIPStatus(&ip, Station) != kNoErr) return;
+
+    memcpy(cached.bssid, link.bssid, sizeof(cached.bssid));
+    cached.channel = (uint8_t)link.channel;
+    // A reused address is not a fresh lease; keep the original lease time
+    if (!usingLease)
+    {
+        copyAddr(cached.ip, ip.ip);
+        copyAddr(cached.mask, ip.mask);
+        copyAddr(cached.gateway, ip.gate);
+        copyAddr(cached.dns, ip.dns);
+        cached.leaseAt = millis();
+    }
+    cached.valid = true;
+}
+
+void WiFiReconnect_Join()
+{
+    if (state != STATE_IDLE) return;
+
+    joining = true;
+    droppedAt = millis();
+    BootProfile_Begin(BOOT_WIFI);
+    enter(STATE_SCAN);
+}
+
+void WiFiReconnect_Start()
+{
+    if (state != STATE_IDLE) return;
+
+    droppedAt = millis();
+    enter(cached.valid ? STATE_FAST : STATE_SCAN);
+}
+
+bool WiFiReconnect_Poll()
+{
+    if (state == STATE_IDLE)
+    {
+        // The server may hand a statically kept address to another client
+        // once the lease runs out; take a fresh one before that
+        if (usingLease && millis() - cached.leaseAt >= WIFI_LEASE_REUSE_MS)
+        {
+            LOG_INFO("WiFi: previous address held for %lu ms, renewing\n", (unsigned long)WIFI_LEASE_REUSE_MS);
+            stats.renewals++;
+            droppedAt = millis();
+            // Drop the link first so the old address is not taken for the
+            // new one; the reuse window is over, so the rejoin uses DHCP
+            micoWlanSuspendStation();
+            enter(STATE_FAST);
+            return false;
+        }
+        return linkUp();
+    }
+
+    unsigned long now = millis();
+    if (joining && associated())
+    {
+        // Associated; DHCP follows
+        BootProfile_End(BOOT_WIFI);
+        BootProfile_Begin(BOOT_DHCP);
+    }
+
+    if (linkUp())
+    {
+        if (joining)
+        {
+            joining = false;
+            BootProfile_End(BOOT_DHCP);
+            stats.joinMs = now - droppedAt;
+            LOG_INFO("WiFi: IP after %lu ms (join)\n", (unsigned long)stats.joinMs);
+            state = STATE_IDLE;
+            WiFiReconnect_Remember();
+            return true;
+        }
+
+        stats.reconnects++;
+        stats.lastPath = (state == STATE_FAST) ? WIFI_PATH_FAST : WIFI_PATH_SCAN;
+        if (state == STATE_FAST) stats.fast++;
+        stats.leaseReused = usingLease;
+        stats.lastTimeToIpMs = now - droppedAt;
+        if (stats.lastTimeToIpMs > stats.maxTimeToIpMs) stats.maxTimeToIpMs = stats.lastTimeToIpMs;
+        LOG_INFO("WiFi: IP after %lu ms (%s)\n", (unsigned long)stats.lastTimeToIpMs,
+            state == STATE_FAST ? "direct" : "scan");
+
+        state = STATE_IDLE;
+        WiFiReconnect_Remember();
+        return true;
+    }
+
+    if (state == STATE_FAST && now - stepAt >= WIFI_FAST_TIMEOUT_MS)
+    {
+        // The access point may have moved channel or gone; forget it
+        stats.fallbacks++;
+        cached.valid = false;
+        enter(STATE_SCAN);
+    }
+    else if (state == STATE_SCAN && now - stepAt >= WIFI_SCAN_TIMEOUT_MS)
+    {
+        enter(STATE_SCAN);
+    }
+    return false;
+}
+
+bool WiFiReconnect_InProgress()
+{
+    return state != STATE_IDLE;
+}
+
+const WiFiReconnectStats* WiFiReconnect_GetStats()
+{
+    return &stats;
+}
+
+size_t WiFiReconnect_FormatStats(char* buf, size_t size)
+{
+    static const char* const paths[] = { "none", "direct", "scan" };
+
+    int len = snprintf(buf, size,
+        "{\"reconnects\":%lu,\"direct\":%lu,\"fallbacks\":%lu,\"renewals\":%lu,\"last_path\":\"%s\","
+        "\"lease_reused\":%s,\"time_to_ip_ms\":%lu,\"max_time_to_ip_ms\":%lu}",
+        (unsigned long)stats.reconnects, (unsigned long)stats.fast, (unsigned long)stats.fallbacks,
+        (unsigned long)stats.renewals,
+        paths[stats.lastPath], stats.leaseReused ? "true" : "false",
+        (unsigned long)stats.lastTimeToIpMs, (unsigned long)stats.maxTimeToIpMs);
+    return (len > 0 && (size_t)len < size) ? len : 0;
+}
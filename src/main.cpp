@@ -13,9 +13,207 @@
 #include "RGB_LED.h"
 #include "DeviceConfig.h"
 #include "SensorManager.h"
-#include "SystemTime.h"
+#include "SystemWiFi.h"
+#include "CertStore.h"
+#include "ConnStats.h"
+#include "DnsCache.h"
+#include "BrokerList.h"
+#include "TopicRouter.h"
+#include "InboundQueue.h"
+#include "BlobTransfer.h"
+#include "FirmwareUpdate.h"
+#include "RemoteConfig.h"
+#include "Shadow.h"
+#include "MqttSession.h"
+#include "WiFiReconnect.h"
+#include "Scheduler.h"
+#include "PowerManager.h"
+#include "LedEffects.h"
+#include "DisplayModel.h"
+#include "UiThread.h"
+#include "SensorSampler.h"
+#include "SensorSnapshot.h"
+#include "HealthMonitor.h"
+#include "TimeSync.h"
+#include "BootProfile.h"
+#include "ConfigCache.h"
+#include "MemMonitor.h"
+#include "Log.h"
+#include "Trace.h"
 #include <time.h>
 
+// Additional brokers tried after the configured one, "host[:port],..."
+#ifndef BROKER_FAILOVER_LIST
+#define BROKER_FAILOVER_LIST ""
+#endif
+
+// Connect to the cached broker address. The TLS client only accepts a
+// hostname, which it resolves itself and also needs for SNI and the
+// certificate name check, so the cache serves the plain profile only.
+#define BROKER_ADDR_CACHE (CONNECTION_PROFILE == PROFILE_MQTT_USERPASS)
+
+// Persistent session: the broker keeps subscriptions and queues QoS 1
+// messages while the device is offline. Set to 0 for clean sessions.
+#ifndef MQTT_PERSISTENT_SESSION
+#define MQTT_PERSISTENT_SESSION 1
+#endif
+
+// Subscription QoS; QoS 1 is needed for the broker to queue messages
+#ifndef MQTT_SUBSCRIBE_QOS
+#define MQTT_SUBSCRIBE_QOS (MQTT_PERSISTENT_SESSION ? 1 : 0)
+#endif
+
+#ifndef DIAG_CONNECT_SUFFIX
+#define DIAG_CONNECT_SUFFIX "/diag/connect"
+#endif
+
+#ifndef DIAG_INBOUND_SUFFIX
+#define DIAG_INBOUND_SUFFIX "/diag/inbound"
+#endif
+
+#ifndef DIAG_SESSION_SUFFIX
+#define DIAG_SESSION_SUFFIX "/diag/session"
+#endif
+
+#ifndef DIAG_WIFI_SUFFIX
+#define DIAG_WIFI_SUFFIX "/diag/wifi"
+#endif
+
+#ifndef DIAG_POWER_SUFFIX
+#define DIAG_POWER_SUFFIX "/diag/power"
+#endif
+
+#ifndef DIAG_THREADS_SUFFIX
+#define DIAG_THREADS_SUFFIX "/diag/threads"
+#endif
+
+#ifndef DIAG_HEALTH_SUFFIX
+#define DIAG_HEALTH_SUFFIX "/diag/health"
+#endif
+
+#ifndef DIAG_BOOT_SUFFIX
+#define DIAG_BOOT_SUFFIX "/diag/boot"
+#endif
+
+#ifndef DIAG_MEM_SUFFIX
+#define DIAG_MEM_SUFFIX "/diag/mem"
+#endif
+
+#ifndef DIAG_LOG_SUFFIX
+#define DIAG_LOG_SUFFIX "/diag/log"
+#endif
+
+// Chunked blob transfers: chunks arrive on <subscribe topic>/blob and are
+// acknowledged on <publish topic>/blob/ack
+#ifndef BLOB_TOPIC_SUFFIX
+#define BLOB_TOPIC_SUFFIX "/blob"
+#endif
+
+#ifndef BLOB_ACK_SUFFIX
+#define BLOB_ACK_SUFFIX "/blob/ack"
+#endif
+
+// OTA manifests arrive on <subscribe topic>/ota; progress is reported on
+// <publish topic>/ota/status
+#ifndef OTA_TOPIC_SUFFIX
+#define OTA_TOPIC_SUFFIX "/ota"
+#endif
+
+#ifndef OTA_STATUS_SUFFIX
+#define OTA_STATUS_SUFFIX "/ota/status"
+#endif
+
+// Remote settings updates arrive on <subscribe topic>/config; results are
+// reported on <publish topic>/config/status
+#ifndef CONFIG_TOPIC_SUFFIX
+#define CONFIG_TOPIC_SUFFIX "/config"
+#endif
+
+#ifndef CONFIG_STATUS_SUFFIX
+#define CONFIG_STATUS_SUFFIX "/config/status"
+#endif
+
+// Trace dump requests arrive on <subscribe topic>/trace; the chunks are
+// published to <publish topic>/diag/trace
+#ifndef TRACE_TOPIC_SUFFIX
+#define TRACE_TOPIC_SUFFIX "/trace"
+#endif
+
+#ifndef DIAG_TRACE_SUFFIX
+#define DIAG_TRACE_SUFFIX "/diag/trace"
+#endif
+
+// Gap between trace dump chunks
+#ifndef TRACE_CHUNK_MS
+#define TRACE_CHUNK_MS 20
+#endif
+
+// Device shadow: desired state on <subscribe topic>/shadow/desired, reported
+// deltas on <publish topic>/shadow/reported
+#ifndef SHADOW_DESIRED_SUFFIX
+#define SHADOW_DESIRED_SUFFIX "/shadow/desired"
+#endif
+
+#ifndef SHADOW_REPORTED_SUFFIX
+#define SHADOW_REPORTED_SUFFIX "/shadow/reported"
+#endif
+
+// Sensor lines on the OLED, refreshed at the sampling rate
+#ifndef DISPLAY_SENSOR_MS
+#define DISPLAY_SENSOR_MS SENSOR_SAMPLE_MS
+#endif
+
+// Interval for periodic diagnostics messages
+#ifndef DIAG_INTERVAL_MS
+#define DIAG_INTERVAL_MS 60000
+#endif
+
+// Time per MQTT service run spent handling queued inbound messages
+#ifndef INBOUND_BUDGET_MS
+#define INBOUND_BUDGET_MS 20
+#endif
+
+#ifndef WIFI_CHECK_INTERVAL
+#define WIFI_CHECK_INTERVAL 5000
+#endif
+
+// Task periods: link polling while Wi-Fi reconnects, MQTT socket service,
+// and the back-off after a failed broker connect
+#ifndef WIFI_RECONNECT_POLL_MS
+#define WIFI_RECONNECT_POLL_MS 100
+#endif
+
+#ifndef MQTT_POLL_MS
+#define MQTT_POLL_MS 10
+#endif
+
+// With power saving, the MQTT socket is polled at MQTT_IDLE_POLL_MS once no
+// message has arrived for MQTT_ACTIVE_HOLD_MS. Keepalive only needs a poll
+// within each keepalive period, and the Wi-Fi interrupt still wakes the
+// core so the network stack handles packets as they arrive.
+#ifndef MQTT_IDLE_POLL_MS
+#define MQTT_IDLE_POLL_MS (POWER_SAVE ? 250 : MQTT_POLL_MS)
+#endif
+
+#ifndef MQTT_ACTIVE_HOLD_MS
+#define MQTT_ACTIVE_HOLD_MS 2000
+#endif
+
+#ifndef MQTT_RETRY_MS
+#define MQTT_RETRY_MS 2000
+#endif
+
+// The network thread is reported stalled (and the watchdog resets the
+// device) after this long without finishing a loop or a broker attempt
+#ifndef NETWORK_STALL_MS
+#define NETWORK_STALL_MS 60000
+#endif
+
+// RGB LED flash after each publish
+#ifndef LED_PUBLISH_FLASH_MS
+#define LED_PUBLISH_FLASH_MS 100
+#endif
+
 #if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS
   #include "AZ3166WiFiClient.h"
   static WiFiClient wifiClient;
@@ -25,22 +223,88 @@
 #endif
 // Global objects
 static RGB_LED rgbLed;
-static PubSubClient mqttClient(wifiClient);
+static rtos::Mutex i2cMutex;            // sensors and OLED share the bus
+static SessionClient sessionClient(wifiClient);
+static PubSubClient mqttClient(sessionClient);
+
+// Routed topic patterns (the router references, not copies, them)
+static char subscribePattern[REMOTE_CONFIG_TOPIC_LEN];
+static char blobTopic[128];
+static char otaTopic[128];
+static char configTopic[128];
+static char shadowTopic[128];
+static char traceTopic[128];
 
 // State
 static int messageCount = 0;
 static bool hasWifi = false;
 static bool hasMqtt = false;
+static unsigned int appliedCertGeneration = 0;
+static bool routesSubscribed = false;   // broker holds the current route set
+static bool dropSession = false;        // broker may hold stale subscriptions
+
+// Scheduler task ids
+static int wifiTask = -1;
+static int mqttTask = -1;
+static int publishTask = -1;
+static int diagTask = -1;
+static int timeTask = -1;
+static int memTask = -1;
+static int traceTask = -1;
+static int dnsTask = -1;
+static int displayTask = -1;
+
+// Health monitor id of the network thread, and the setup step in progress
+static int netHealth = -1;
+static const char* setupStep = NULL;
+
+// RGB LED status patterns
+static const LedPattern ledNoWifi = { LED_EFFECT_BLINK, 255, 0, 0, 500, 500 };
+static const LedPattern ledConnecting = { LED_EFFECT_PULSE, 255, 160, 0, 600, 600 };
+static const LedPattern ledIdle = { LED_EFFECT_SOLID, 0, 0, 0, 0, 0 };
+
+// Registers the tasks above; defined after setup() with the task bodies
+void scheduleTasks();
+
+// Device shadow properties
+// ledMode: status LEDs with publish flash, all off, or status without flash
+enum LedMode { LED_MODE_STATUS = 0, LED_MODE_OFF, LED_MODE_QUIET };
+static int shadowInterval = -1;
+static int shadowTempHigh = -1;
+static int shadowTempLow = -1;
+static int shadowLedMode = -1;
+static int shadowTempAlert = -1;
+static int shadowLogLevel = -1;
+
+/**
+ * Display and LED writers; these run on the UI thread
+ */
+void writeOledLine(int line, const char* text)
+{
+    Screen.print(line, text);
+}
+
+void writeRgbLed(uint8_t r, uint8_t g, uint8_t b)
+{
+    rgbLed.setColor(r, g, b);
+}
 
 /**
- * Update OLED display
+ * What the network thread is doing, recorded if it stalls (called from the
+ * health monitor's timer interrupt)
+ */
+const char* networkActivity()
+{
+    const SchedulerTaskInfo* task = Scheduler_GetInfo(Scheduler_Running());
+    return task ? task->name : setupStep;
+}
+
+/**
+ * Update OLED display. The UI thread draws the changed lines.
  */
 void updateDisplay(const char* line1, const char* line2 = NULL, const char* line3 = NULL)
 {
-    Screen.clean();
-    Screen.print(0, line1);
-    if (line2) Screen.print(1, line2);
-    if (line3) Screen.print(2, line3);
+    Ui_PostLines(line1, line2, line3);
 }
 
 /**
@@ -48,251 +312,1006 @@ void updateDisplay(const char* line1, const char* line2 = NULL, const char* line
  */
 void updateLEDs()
 {
-    digitalWrite(LED_AZURE, hasMqtt ? HIGH : LOW);
-    digitalWrite(LED_USER, (hasWifi && hasMqtt) ? HIGH : LOW);
-    
-    if (!hasWifi)
-        rgbLed.setRed();
-    else if (!hasMqtt)
-        rgbLed.setYellow();
+    static const LedPattern* posted = NULL;
+    const LedPattern* pattern;
+
+    int mode = Shadow_GetReported(shadowLedMode).i;
+    if (mode == LED_MODE_OFF)
+    {
+        digitalWrite(LED_AZURE, LOW);
+        digitalWrite(LED_USER, LOW);
+        pattern = &ledIdle;
+    }
     else
-        rgbLed.turnOff();
+    {
+        digitalWrite(LED_AZURE, hasMqtt ? HIGH : LOW);
+        digitalWrite(LED_USER, (hasWifi && hasMqtt) ? HIGH : LOW);
+
+        if (!hasWifi)
+            pattern = &ledNoWifi;
+        else if (!hasMqtt)
+            pattern = &ledConnecting;
+        else
+            pattern = &ledIdle;
+    }
+
+    // A pattern dropped on a full ring is posted again on the next call
+    if (pattern != posted && Ui_PostLedPattern(pattern))
+        posted = pattern;
+}
+
+/**
+ * Handler for messages on the configured subscribe topic
+ */
+void printMessage(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    LOG_INFO("\n[Message Received] %s: %.*s\n", topic, (int)length, (const char*)payload);
 }
 
 /**
- * MQTT message callback
+ * MQTT message callback. Runs inside mqttClient.loop(), so it only queues
+ * the message; handlers run later from loop() via InboundQueue_Process().
  */
 void messageCallback(char* topic, byte* payload, unsigned int length)
 {
-    Serial.printf("\n[Message Received] %s: ", topic);
-    Serial.write(payload, length);
-    Serial.println();
+    MqttSession_OnMessage();
+    bool queued = InboundQueue_Push(topic, payload, length);
+    Trace_Record(TRACE_MESSAGE, queued, length);
 }
 
 /**
- * Connect to MQTT broker (profile-dependent: userpass, userpass+TLS, or mTLS)
+ * Subscribe to every routed pattern, packing as many topic filters into each
+ * SUBSCRIBE packet as the buffer allows. PubSubClient only sends one filter
+ * per packet, so the packets are written to the transport directly; the
+ * SUBACKs are consumed (and ignored) by mqttClient.loop(). Returns false if
+ * a packet could not be sent.
  */
-bool connectMQTT()
+bool subscribeRoutes()
 {
-    const char* host = DeviceConfig_GetBrokerHost();
-    int port = DeviceConfig_GetBrokerPort();
-    
-    Serial.printf("Connecting to %s:%d...\n", host, port);
+    static uint16_t packetId = 0xF000;   // kept clear of PubSubClient's ids
+    uint8_t packet[512];
+    int next = 0;
+
+    while (next < TopicRouter_Count())
+    {
+        int first = next;
+        size_t len = TopicRouter_BuildSubscribe(packet, sizeof(packet), packetId, MQTT_SUBSCRIBE_QOS, &next);
+        BootProfile_Begin(BOOT_SUBACK);
+        if (len == 0 || wifiClient.write(packet, len) != len)
+        {
+            LOG_WARN("Subscribe failed at: %s\n", TopicRouter_GetPattern(first));
+            return false;
+        }
+        MqttSession_OnSubscribeSent(1);
+        if (++packetId == 0) packetId = 0xF000;
+        LOG_INFO("Subscribed to %d topic(s) in one packet\n", next - first);
+    }
+    MqttSession_OnResubscribe();
+    return true;
+}
+
+/**
+ * Connect to one MQTT broker (profile-dependent: userpass, userpass+TLS, or mTLS)
+ */
+bool connectBroker(int broker, const char* host, int port)
+{
+    LOG_INFO("Connecting to %s:%d...\n", host, port);
     
     wifiClient.stop();
-    rgbLed.setYellow();
+    unsigned long start = millis();
 
+    // Credentials are loaded and validated once (connectMQTT checks them);
+    // only re-apply them to the client when the cached set changes
+    if (appliedCertGeneration != CertStore_GetGeneration())
+    {
 #if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS
-    // Plain TCP — no TLS configuration needed
+        // Plain TCP — no TLS configuration needed
 #elif CONNECTION_PROFILE == PROFILE_MQTT_USERPASS_TLS
-    wifiClient.setTimeout(2000);
-    wifiClient.setCACert(DeviceConfig_GetCACert());
+        wifiClient.setTimeout(2000);
+        wifiClient.setCACert(CertStore_GetCACert());
 #elif CONNECTION_PROFILE == PROFILE_MQTT_MTLS
-    wifiClient.setTimeout(2000);
-    wifiClient.setCACert(DeviceConfig_GetCACert());
-    wifiClient.setCertificate(DeviceConfig_GetClientCert());
-    wifiClient.setPrivateKey(DeviceConfig_GetClientKey());
+        wifiClient.setTimeout(2000);
+        wifiClient.setCACert(CertStore_GetCACert());
+        wifiClient.setCertificate(CertStore_GetClientCert());
+        wifiClient.setPrivateKey(CertStore_GetClientKey());
 #endif
+        appliedCertGeneration = CertStore_GetGeneration();
+    }
+
+    ConnStats_BeginAttempt(broker);
+
+    // Settings come from the RAM copy; the checksum is checked first and
+    // the copy is read again if it was damaged
+    ConnStats_PhaseStart(CONN_PHASE_CONFIG);
+    ConfigCache_Verify();
+    const char* deviceId = ConfigCache_Get(CONFIG_DEVICE_ID);
+    const char* devicePassword = ConfigCache_Get(CONFIG_DEVICE_PASSWORD);
+    ConnStats_PhaseEnd(CONN_PHASE_CONFIG, 0);
+
+#if BROKER_ADDR_CACHE
+    // DNS, served from the cache on immediate reconnects
+    ConnStats_PhaseStart(CONN_PHASE_DNS);
+    BootProfile_Begin(BOOT_DNS);
+    char brokerAddr[DNS_CACHE_ADDR_LEN];
+    bool addrFromCache = false;
+    int dnsResult = DnsCache_Resolve(host, brokerAddr, sizeof(brokerAddr), &addrFromCache);
+    ConnStats_PhaseEnd(CONN_PHASE_DNS, dnsResult);
+    if (dnsResult == 0) BootProfile_End(BOOT_DNS);
+    if (dnsResult != 0)
+    {
+        LOG_WARN("MQTT failed, DNS error=%d\n", dnsResult);
+        ConnStats_PrintLast();
+        return false;
+    }
+    const char* target = brokerAddr;
+#else
+    // The TLS client resolves the hostname itself, inside the transport phase
+    const char* target = host;
+#endif
+
+    // TCP (and TLS handshake on secure profiles). PubSubClient reuses an
+    // already-connected transport, which lets this phase be timed on its own.
+    ConnStats_PhaseStart(CONN_PHASE_TRANSPORT);
+    BootProfile_Begin(BOOT_TLS);
+    int transportResult = wifiClient.connect(target, port);
+    ConnStats_PhaseEnd(CONN_PHASE_TRANSPORT, transportResult == 1 ? 0 : (transportResult == 0 ? -1 : transportResult));
+    if (transportResult != 1)
+    {
+#if BROKER_ADDR_CACHE
+        LOG_WARN("MQTT failed, transport error=%d (%s %s)\n",
+            transportResult, brokerAddr, addrFromCache ? "cached" : "resolved");
+        ConnStats_PrintLast();
+        // Force a fresh lookup next time in case the address moved
+        DnsCache_ReportFailure(host);
+#else
+        LOG_WARN("MQTT failed, transport error=%d\n", transportResult);
+        ConnStats_PrintLast();
+#endif
+        return false;
+    }
+    BootProfile_End(BOOT_TLS);
 
     mqttClient.setServer(host, port);
     mqttClient.setBufferSize(1024);
     mqttClient.setKeepAlive(60);
     mqttClient.setSocketTimeout(30);
 
-    const char* deviceId = DeviceConfig_GetDeviceId();
-
-#if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS || CONNECTION_PROFILE == PROFILE_MQTT_USERPASS_TLS
-    char devicePassword[680];
-    DeviceConfig_Read(SETTING_DEVICE_PASSWORD, devicePassword, sizeof(devicePassword));
-    if (!mqttClient.connect(deviceId, deviceId, devicePassword))
-#else
-    if (!mqttClient.connect(deviceId, deviceId, ""))
-#endif
+    // MQTT CONNECT / CONNACK. The client id is the device id, so the broker
+    // can match a persistent session across reconnects.
+    ConnStats_PhaseStart(CONN_PHASE_MQTT);
+    BootProfile_Begin(BOOT_CONNACK);
+    MqttSession_BeginConnect();
+    const bool cleanSession = !MQTT_PERSISTENT_SESSION || dropSession;
+    bool mqttOk = mqttClient.connect(deviceId, deviceId, devicePassword, NULL, 0, false, NULL, cleanSession);
+    ConnStats_PhaseEnd(CONN_PHASE_MQTT, mqttOk ? 0 : mqttClient.state());
+    if (!mqttOk)
     {
-        Serial.printf("MQTT failed, state=%d\n", mqttClient.state());
+        LOG_WARN("MQTT failed, state=%d\n", mqttClient.state());
+        ConnStats_PrintLast();
+        wifiClient.stop();
         return false;
     }
     
-    Serial.println("MQTT connected!");
+    ConnStats_EndAttempt();
+    BootProfile_End(BOOT_CONNACK);
+    dropSession = false;
+    bool resumed = MqttSession_OnConnected();
+    LOG_INFO("MQTT connected in %lu ms (session %s)\n", millis() - start, resumed ? "resumed" : "new");
+    ConnStats_PrintLast();
+    return true;
+}
+
+/**
+ * Connect to the healthiest broker, failing over through the rest of the
+ * list within the same call
+ */
+bool connectMQTT()
+{
+    // Bad local credentials would fail every broker alike; they are not
+    // recorded as a connect attempt or held against any endpoint
+    if (!CertStore_Load()) return false;
+
+    uint32_t tried = 0;
+    for (int n = 0; n < BrokerList_Count(); n++)
+    {
+        int broker = BrokerList_Select(millis(), tried);
+        if (broker < 0) break;
+        // Only fail over to endpoints that are not cooling down; the first
+        // pick may be cooling down when every endpoint failed recently
+        if (n > 0 && BrokerList_IsCoolingDown(broker, millis())) break;
+        tried |= 1u << broker;
+        Health_CheckIn(netHealth);
+
+        const BrokerEndpoint* endpoint = BrokerList_Get(broker);
+        Trace_Record(TRACE_CONNECT_BEGIN, broker);
+        bool connected = connectBroker(broker, endpoint->host, endpoint->port);
+        Trace_Record(TRACE_CONNECT_END, connected, (uint32_t)mqttClient.state());
+        if (connected)
+        {
+            // Score on handshake cost: transport (incl. TLS) plus CONNACK
+            const ConnAttempt* a = ConnStats_GetLast();
+            BrokerList_ReportSuccess(broker, (a->phaseUs[CONN_PHASE_TRANSPORT] + a->phaseUs[CONN_PHASE_MQTT]) / 1000);
+            return true;
+        }
+        BrokerList_ReportFailure(broker, millis());
+    }
+    return false;
+}
+
+/**
+ * Build <publish topic><suffix>; returns false if no publish topic is set
+ */
+bool buildDiagTopic(char* topic, size_t size, const char* suffix)
+{
+    const char* publishTopic = RemoteConfig_Get()->publishTopic;
+    if (publishTopic[0] == '\0') return false;
+
+    snprintf(topic, size, "%s%s", publishTopic, suffix);
+    return true;
+}
+
+/**
+ * Build <subscribe topic><suffix> for a command topic. Returns false if no
+ * subscribe topic is set or it contains wildcards.
+ */
+bool buildCommandTopic(char* topic, size_t size, const char* suffix)
+{
+    const char* subscribeTopic = RemoteConfig_Get()->subscribeTopic;
+    if (subscribeTopic[0] == '\0' || strpbrk(subscribeTopic, "+#") != NULL) return false;
+
+    snprintf(topic, size, "%s%s", subscribeTopic, suffix);
+    return true;
+}
+
+/**
+ * Publish a blob transfer acknowledgement
+ */
+bool publishBlobAck(const char* json)
+{
+    char topic[128];
+    return buildDiagTopic(topic, sizeof(topic), BLOB_ACK_SUFFIX) && mqttClient.publish(topic, json);
+}
+
+/**
+ * Publish an OTA status report
+ */
+bool publishOtaStatus(const char* json)
+{
+    char topic[128];
+    return buildDiagTopic(topic, sizeof(topic), OTA_STATUS_SUFFIX) && mqttClient.publish(topic, json);
+}
+
+/**
+ * Publish the result of a remote settings update
+ */
+bool publishConfigStatus(const char* json)
+{
+    char topic[128];
+    return buildDiagTopic(topic, sizeof(topic), CONFIG_STATUS_SUFFIX) && mqttClient.publish(topic, json);
+}
+
+/**
+ * Start sending a trace dump when one is requested
+ */
+void onTraceCommand(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    Trace_OnCommand(topic, payload, length, context);
+    if (Trace_DumpPending()) Scheduler_RunIn(traceTask, 0);
+}
+
+/**
+ * Register handlers for the configured subscribe topic and the command topics
+ */
+void registerRoutes()
+{
+    const char* subscribeTopic = RemoteConfig_Get()->subscribeTopic;
+    if (subscribeTopic[0] != '\0')
+    {
+        strcpy(subscribePattern, subscribeTopic);
+        TopicRouter_Add(subscribePattern, printMessage);
+        LOG_INFO("Subscribe to: %s\n", subscribePattern);
+    }
+
+    BlobTransfer_Init(publishBlobAck);
+    if (buildCommandTopic(blobTopic, sizeof(blobTopic), BLOB_TOPIC_SUFFIX))
+        TopicRouter_Add(blobTopic, BlobTransfer_OnMessage);
+
+    FirmwareUpdate_Init(publishOtaStatus, FirmwareFlash_GetDevicePort());
+    if (buildCommandTopic(otaTopic, sizeof(otaTopic), OTA_TOPIC_SUFFIX))
+        TopicRouter_Add(otaTopic, FirmwareUpdate_OnManifest);
+
+    if (buildCommandTopic(configTopic, sizeof(configTopic), CONFIG_TOPIC_SUFFIX))
+        TopicRouter_Add(configTopic, RemoteConfig_OnMessage);
+
+    if (buildCommandTopic(shadowTopic, sizeof(shadowTopic), SHADOW_DESIRED_SUFFIX))
+        TopicRouter_Add(shadowTopic, Shadow_OnDesired);
+
+    if (buildCommandTopic(traceTopic, sizeof(traceTopic), TRACE_TOPIC_SUFFIX))
+        TopicRouter_Add(traceTopic, onTraceCommand);
+}
+
+/**
+ * Publish a reported-state delta
+ */
+bool publishShadowReported(const char* json)
+{
+    char topic[128];
+    return mqttClient.connected() && buildDiagTopic(topic, sizeof(topic), SHADOW_REPORTED_SUFFIX) &&
+        mqttClient.publish(topic, json);
+}
+
+/**
+ * Shadow apply callbacks
+ */
+bool applyShadowInterval(int index, ShadowValue value)
+{
+    // Reported once RemoteConfig applies it (see onConfigApplied)
+    RemoteConfig_SetSendInterval((uint32_t)value.i);
+    return false;
+}
+
+bool applyShadowThreshold(int index, ShadowValue value)
+{
+    return value.f > -40.0f && value.f < 120.0f;
+}
+
+bool applyShadowLedMode(int index, ShadowValue value)
+{
+    if (value.i < LED_MODE_STATUS || value.i > LED_MODE_QUIET) return false;
+    Shadow_SetReported(index, value);
+    updateLEDs();
     return true;
 }
 
+bool applyShadowLogLevel(int index, ShadowValue value)
+{
+    if (value.i < LOG_LEVEL_NONE || value.i > LOG_LEVEL_DEBUG) return false;
+    Log_SetLevel(value.i);
+    Shadow_SetReported(index, value);
+    return true;
+}
+
+/**
+ * Define the device shadow properties
+ */
+void defineShadow()
+{
+    ShadowValue v;
+    Shadow_Init(publishShadowReported);
+
+    v.i = (int32_t)RemoteConfig_Get()->sendIntervalS;
+    shadowInterval = Shadow_Define("sendInterval", SHADOW_INT, v, applyShadowInterval);
+    v.f = 35.0f;
+    shadowTempHigh = Shadow_Define("tempHigh", SHADOW_FLOAT, v, applyShadowThreshold);
+    v.f = 0.0f;
+    shadowTempLow = Shadow_Define("tempLow", SHADOW_FLOAT, v, applyShadowThreshold);
+    v.i = LED_MODE_STATUS;
+    shadowLedMode = Shadow_Define("ledMode", SHADOW_INT, v, applyShadowLedMode);
+    v.b = false;
+    shadowTempAlert = Shadow_Define("tempAlert", SHADOW_BOOL, v, NULL);
+    v.i = Log_GetLevel();
+    shadowLogLevel = Shadow_Define("logLevel", SHADOW_INT, v, applyShadowLogLevel);
+}
+
+/**
+ * Apply remote settings changes: restart the publish interval and move the
+ * subscriptions when the subscribe topic changes
+ */
+void onConfigApplied(const RuntimeConfig* previous, const RuntimeConfig* current)
+{
+    if (current->sendIntervalS != previous->sendIntervalS)
+    {
+        ShadowValue v;
+        v.i = (int32_t)current->sendIntervalS;
+        Shadow_SetReported(shadowInterval, v);
+        Scheduler_SetPeriod(publishTask, current->sendIntervalS * 1000UL);
+        LOG_INFO("Send interval:    %lu s\n", (unsigned long)current->sendIntervalS);
+    }
+
+    if (strcmp(current->subscribeTopic, previous->subscribeTopic) != 0)
+    {
+        // The route patterns still hold the previous topics
+        bool unsubscribed = mqttClient.connected();
+        for (int i = 0; unsubscribed && i < TopicRouter_Count(); i++)
+            unsubscribed = mqttClient.unsubscribe(TopicRouter_GetPattern(i));
+
+        // A persistent session would keep whatever could not be unsubscribed
+        // now, so the next connect starts a clean one
+        if (!unsubscribed && MQTT_PERSISTENT_SESSION)
+        {
+            dropSession = true;
+            LOG_INFO("Old subscriptions dropped at next connect\n");
+        }
+
+        TopicRouter_Clear();
+        registerRoutes();
+        routesSubscribed = mqttClient.connected() && subscribeRoutes();
+    }
+}
+
+/**
+ * Format the sensor groups that are enabled in the sensor mask and were
+ * read as a JSON object. Returns the length, or 0 if it does not fit.
+ */
+size_t formatSensorJson(char* json, size_t size, const SensorReadings* r, uint32_t mask)
+{
+    // In SENSOR_* bit order
+    static const char* const keys[] = { "temperature", "humidity", "pressure", "accelerometer", "gyroscope", "magnetometer" };
+    const float scalars[] = { r->temperature, r->humidity, r->pressure };
+    const int32_t* axes[] = { r->accel, r->gyro, r->mag };
+
+    size_t len = snprintf(json, size, "{");
+    for (int i = 0; i < 6; i++)
+    {
+        if (!(mask & r->present & (1u << i))) continue;
+
+        const char* sep = len > 1 ? "," : "";
+        int n = (i < 3)
+            ? snprintf(json + len, size - len, "%s\"%s\":%.2f", sep, keys[i], scalars[i])
+            : snprintf(json + len, size - len, "%s\"%s\":{\"x\":%ld,\"y\":%ld,\"z\":%ld}", sep, keys[i],
+                (long)axes[i - 3][0], (long)axes[i - 3][1], (long)axes[i - 3][2]);
+        if (n < 0 || len + n >= size - 1) return 0;
+        len += n;
+    }
+    json[len++] = '}';
+    json[len] = '\0';
+    return len;
+}
+
+/**
+ * Publish the connection-attempt timing summary to <publish topic>/diag/connect
+ */
+void publishConnectStats()
+{
+    char topic[128];
+    if (!ConnStats_HasUnreported() || !buildDiagTopic(topic, sizeof(topic), DIAG_CONNECT_SUFFIX)) return;
+
+    // Sized to leave room for the topic within the 1024-byte MQTT buffer.
+    // Static: only the network thread publishes.
+    static char summary[768];
+    while (ConnStats_FormatSummary(summary, sizeof(summary)) > 0)
+    {
+        if (!mqttClient.publish(topic, summary)) break;
+        ConnStats_MarkReported();
+    }
+}
+
+/**
+ * Publish the loop and watchdog state to <publish topic>/diag/health
+ */
+void publishHealth()
+{
+    char topic[128];
+    char json[384];
+    if (buildDiagTopic(topic, sizeof(topic), DIAG_HEALTH_SUFFIX) &&
+        Health_FormatStats(json, sizeof(json)) > 0)
+    {
+        mqttClient.publish(topic, json);
+    }
+}
+
+/**
+ * Publish the heap and stack headroom to <publish topic>/diag/mem
+ */
+void publishMemory()
+{
+    char topic[128];
+    char json[384];
+    if (buildDiagTopic(topic, sizeof(topic), DIAG_MEM_SUFFIX) &&
+        Mem_FormatStats(json, sizeof(json)) > 0)
+    {
+        LOG_INFO("Memory: %s\n", json);
+        mqttClient.publish(topic, json);
+    }
+}
+
+/**
+ * Publish the boot profile to <publish topic>/diag/boot
+ */
+void publishBootProfile()
+{
+    char topic[128];
+    char json[384];
+    if (buildDiagTopic(topic, sizeof(topic), DIAG_BOOT_SUFFIX) &&
+        BootProfile_Format(json, sizeof(json)) > 0)
+    {
+        LOG_INFO("Boot profile: %s\n", json);
+        mqttClient.publish(topic, json);
+    }
+}
+
+/**
+ * Publish periodic diagnostics
+ */
+void publishDiagnostics()
+{
+    char topic[128];
+    char json[256];
+
+    if (buildDiagTopic(topic, sizeof(topic), DIAG_INBOUND_SUFFIX) &&
+        InboundQueue_FormatStats(json, sizeof(json)) > 0)
+    {
+        mqttClient.publish(topic, json);
+    }
+
+    if (buildDiagTopic(topic, sizeof(topic), DIAG_SESSION_SUFFIX) &&
+        MqttSession_FormatStats(json, sizeof(json)) > 0)
+    {
+        mqttClient.publish(topic, json);
+    }
+
+    if (WiFiReconnect_GetStats()->reconnects > 0 && buildDiagTopic(topic, sizeof(topic), DIAG_WIFI_SUFFIX) &&
+        WiFiReconnect_FormatStats(json, sizeof(json)) > 0)
+    {
+        mqttClient.publish(topic, json);
+    }
+
+    if (buildDiagTopic(topic, sizeof(topic), DIAG_THREADS_SUFFIX))
+    {
+        const SensorSamplerStats* sensor = SensorSampler_GetStats();
+        const UiStats* ui = Ui_GetStats();
+        snprintf(json, sizeof(json),
+            "{\"sensor\":{\"stack\":%lu,\"stack_max\":%lu,\"samples\":%lu,\"failed\":%lu,\"read_retries\":%lu,\"max_read_us\":%lu},"
+            "\"ui\":{\"stack\":%lu,\"stack_max\":%lu,\"events\":%lu,\"dropped\":%lu}}",
+            (unsigned long)sensor->stackSize, (unsigned long)sensor->stackMaxUsed, (unsigned long)sensor->samples,
+            (unsigned long)sensor->failed, (unsigned long)SensorSnapshot_GetStats()->retries, (unsigned long)sensor->maxReadUs,
+            (unsigned long)ui->stackSize, (unsigned long)ui->stackMaxUsed, (unsigned long)ui->events,
+            (unsigned long)ui->dropped);
+        mqttClient.publish(topic, json);
+    }
+
+    publishHealth();
+    publishMemory();
+
+    if (buildDiagTopic(topic, sizeof(topic), DIAG_LOG_SUFFIX) &&
+        Log_FormatStats(json, sizeof(json)) > 0)
+    {
+        mqttClient.publish(topic, json);
+    }
+
+    if (buildDiagTopic(topic, sizeof(topic), DIAG_POWER_SUFFIX) &&
+        Power_FormatStats(json, sizeof(json)) > 0)
+    {
+        LOG_INFO("Power: %s\n", json);
+        mqttClient.publish(topic, json);
+    }
+}
+
 /**
  * Publish telemetry data
  */
 void publishTelemetry()
 {
     if (!mqttClient.connected()) return;
+    Trace_Record(TRACE_PUBLISH_BEGIN);
     
-    char sensorJson[512];
-    if (!Sensors.toJson(sensorJson, sizeof(sensorJson))) return;
+    // Consistent copy of the newest readings from the sampler thread
+    SensorReadings readings;
+    if (!SensorSnapshot_Read(&readings)) return;
+
+    // Static rather than on the network thread's stack
+    static char sensorJson[512];
+    size_t sensorLen = formatSensorJson(sensorJson, sizeof(sensorJson), &readings, RemoteConfig_Get()->sensorMask);
+    if (sensorLen == 0) return;
     
-    // Get ISO 8601 timestamp
-    char timestamp[25];
-    time_t now = time(NULL);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    // ISO 8601 timestamp member, left out while the clock is not set
+    char timestamp[40] = "";
+    if (TimeSync_IsSynced())
+    {
+        time_t now = time(NULL);
+        strftime(timestamp, sizeof(timestamp), ",\"timestamp\":\"%Y-%m-%dT%H:%M:%SZ\"", gmtime(&now));
+    }
     
     // Build final payload with messageId, deviceId, timestamp, and all sensor data
-    char payload[700];
+    static char payload[700];
     snprintf(payload, sizeof(payload),
-        "{\"messageId\":%d,\"deviceId\":\"%s\",\"timestamp\":\"%s\",%s",
-        messageCount++, DeviceConfig_GetDeviceId(), timestamp, sensorJson + 1);  // skip leading '{' to merge objects
+        "{\"messageId\":%d,\"deviceId\":\"%s\"%s%s%s",
+        messageCount++, ConfigCache_Get(CONFIG_DEVICE_ID), timestamp,
+        sensorLen > 2 ? "," : "", sensorJson + 1);  // skip leading '{' to merge objects
     
-    const char* publishTopic = DeviceConfig_GetPublishTopic();
+    const char* publishTopic = RemoteConfig_Get()->publishTopic;
     if (publishTopic[0] == '\0') return;
 
-    if (mqttClient.publish(publishTopic, payload))
+    size_t payloadLen = strlen(payload);
+    bool sent = mqttClient.publish(publishTopic, payload);
+    Trace_Record(TRACE_PUBLISH_END, sent, payloadLen);
+    if (sent)
     {
-        Serial.printf("[%d] %s\n", messageCount - 1, payload);
-        
-        float temp = Sensors.getTemperature();
-        float hum = Sensors.getHumidity();
-        float pres = Sensors.getPressure();
-        
-        char line2[20], line3[20];
-        snprintf(line2, sizeof(line2), "T:%.1fC H:%.0f%%", temp, hum);
-        snprintf(line3, sizeof(line3), "P:%.0f hPa", pres);
-        updateDisplay(WiFi.localIP().get_address(), line2, line3);
-        rgbLed.setBlue();
-        delay(100);
-        rgbLed.turnOff();
+        // The whole payload only at debug level (cut at LOG_LINE_MAX)
+        if (Log_Enabled(LOG_LEVEL_DEBUG))
+            LOG_DEBUG("[%d] %s\n", messageCount - 1, payload);
+        else
+            LOG_INFO("[%d] published %u bytes\n", messageCount - 1, (unsigned)payloadLen);
+        static bool firstPublished = false;
+        if (!firstPublished)
+        {
+            firstPublished = true;
+            BootProfile_FirstPublish();
+            publishBootProfile();
+        }
+
+        if (readings.present & SENSOR_TEMPERATURE)
+        {
+            float temp = readings.temperature;
+            ShadowValue alert;
+            alert.b = temp > Shadow_GetReported(shadowTempHigh).f || temp < Shadow_GetReported(shadowTempLow).f;
+            Shadow_SetReported(shadowTempAlert, alert);
+        }
+
+        if (Shadow_GetReported(shadowLedMode).i == LED_MODE_STATUS)
+        {
+            Ui_PostFlash(0, 0, 255, LED_PUBLISH_FLASH_MS);
+        }
     }
 }
 
+/**
+ * DNS cache resolver: a lookup through the Wi-Fi interface
+ */
+int resolveHost(const char* host, char* addr, size_t size)
+{
+    SocketAddress result;
+    int ret = WiFiInterface()->gethostbyname(host, &result);
+    if (ret != 0) return ret;
+
+    strncpy(addr, result.get_ip_address(), size - 1);
+    addr[size - 1] = '\0';
+    return 0;
+}
+
 void setup()
 {
 
 
-    Serial.begin(115200);
-    delay(500);
+    // Before any thread starts
+    Mem_Init();
+    Log_Init();
+
+    BootProfile_Init();
+    // Before the threads start, so they can register
+    Health_Init();
+    netHealth = Health_Register("net", NETWORK_STALL_MS, networkActivity);
+    setupStep = "setup";
     
+    BootProfile_Begin(BOOT_DISPLAY);
     Screen.init();
+    Screen.clean();
+    BootProfile_End(BOOT_DISPLAY);
     rgbLed.turnOff();
+    Ui_Start(writeOledLine, writeRgbLed, &i2cMutex);
     pinMode(LED_AZURE, OUTPUT);
     pinMode(LED_USER, OUTPUT);
+
+    // Start associating first; the driver joins in the background while the
+    // sensors start and the settings and credentials are loaded. The join
+    // reads the Wi-Fi settings, so the settings cache is filled first.
+    ConfigCache_Load();
+    InitSystemWiFi();
+    DnsCache_SetResolver(resolveHost);
+    WiFiReconnect_Join();
+    updateDisplay("Connecting WiFi", ConfigCache_Get(CONFIG_WIFI_SSID));
+    SensorSampler_Start(&i2cMutex);
     
-    updateDisplay("MQTT", "Initializing...");
-    Serial.println("\n=== MXChip MQTT Demo ===\n");
-    Serial.printf("Profile:          %s\n", DeviceConfig_GetProfileName());
-    Serial.printf("WiFi SSID:        %s\n", DeviceConfig_GetWifiSsid());
-    Serial.printf("WiFi password len:%d\n", (int)strlen(DeviceConfig_GetWifiPassword()));
-    Serial.printf("Broker host:      %s\n", DeviceConfig_GetBrokerHost());
-    Serial.printf("Broker port:      %d\n", DeviceConfig_GetBrokerPort());
-    Serial.printf("Device ID:        %s\n", DeviceConfig_GetDeviceId());
-    Serial.printf("Send interval:    %d s\n", DeviceConfig_GetSendInterval());
-    Serial.printf("Publish topic:    \"%s\"\n", DeviceConfig_GetPublishTopic());
-    Serial.printf("Subscribe topic:  \"%s\"\n", DeviceConfig_GetSubscribeTopic());
+    BootProfile_Begin(BOOT_CONFIG);
+    RemoteConfig_Init(onConfigApplied, publishConfigStatus);
+    defineShadow();
+    updateLEDs();
+    LOG_INFO("\n=== MXChip MQTT Demo ===\n\n");
+    LOG_INFO("Profile:          %s\n", DeviceConfig_GetProfileName());
+    LOG_INFO("WiFi SSID:        %s\n", ConfigCache_Get(CONFIG_WIFI_SSID));
+    LOG_INFO("WiFi password len:%d\n", (int)strlen(ConfigCache_Get(CONFIG_WIFI_PASSWORD)));
+    LOG_INFO("Broker host:      %s\n", ConfigCache_Get(CONFIG_BROKER_HOST));
+    LOG_INFO("Broker port:      %d\n", ConfigCache_GetBrokerPort());
+    LOG_INFO("Device ID:        %s\n", ConfigCache_Get(CONFIG_DEVICE_ID));
+    LOG_INFO("Send interval:    %lu s\n", (unsigned long)RemoteConfig_Get()->sendIntervalS);
+    LOG_INFO("Publish topic:    \"%s\"\n", RemoteConfig_Get()->publishTopic);
+    LOG_INFO("Subscribe topic:  \"%s\"\n", RemoteConfig_Get()->subscribeTopic);
+    LOG_INFO("Sensor mask:      0x%02lx\n", (unsigned long)RemoteConfig_Get()->sensorMask);
 #if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS || CONNECTION_PROFILE == PROFILE_MQTT_USERPASS_TLS
+    LOG_INFO("Device password len:%d\n", (int)strlen(ConfigCache_Get(CONFIG_DEVICE_PASSWORD)));
+#endif
+#if CONFIG_CACHE
+    LOG_INFO("Config load time: %lu us (%u bytes)\n",
+        (unsigned long)ConfigCache_GetStats()->loadUs, (unsigned)ConfigCache_GetStats()->poolUsed);
+#endif
+    if (!CertStore_Load())
     {
-        char _pw[680];
-        DeviceConfig_Read(SETTING_DEVICE_PASSWORD, _pw, sizeof(_pw));
-        Serial.printf("Device password len:%d\n", (int)strlen(_pw));
+        LOG_ERROR("TLS credentials invalid, check configuration\n");
     }
-#endif
 #if CONNECTION_PROFILE == PROFILE_MQTT_USERPASS_TLS || CONNECTION_PROFILE == PROFILE_MQTT_MTLS
-    Serial.printf("CA cert len:      %d\n", (int)strlen(DeviceConfig_GetCACert()));
+    LOG_INFO("CA cert len:      %d\n", (int)strlen(CertStore_GetCACert()));
 #endif
 #if CONNECTION_PROFILE == PROFILE_MQTT_MTLS
-    Serial.printf("Client cert len:  %d\n", (int)strlen(DeviceConfig_GetClientCert()));
-    Serial.printf("Client key len:   %d\n", (int)strlen(DeviceConfig_GetClientKey()));
+    LOG_INFO("Client cert len:  %d\n", (int)strlen(CertStore_GetClientCert()));
+    LOG_INFO("Client key len:   %d\n", (int)strlen(CertStore_GetClientKey()));
+#endif
+#if CONNECTION_PROFILE != PROFILE_MQTT_USERPASS
+    LOG_INFO("Cert parse time:  %lu ms\n", CertStore_GetParseTimeMs());
 #endif
+    BootProfile_End(BOOT_CONFIG);
+
+    BrokerList_Init(ConfigCache_Get(CONFIG_BROKER_HOST), ConfigCache_GetBrokerPort(), BROKER_FAILOVER_LIST);
+    mqttClient.setCallback(messageCallback);
+    registerRoutes();
     
-    // Connect to WiFi (uses EEPROM credentials via DeviceConfig)
-    updateDisplay("Connecting WiFi", DeviceConfig_GetWifiSsid());
-    if (WiFi.begin() != WL_CONNECTED)
+    // Joining, time sync and the broker connection continue as tasks; a
+    // failure at any step is retried there like a dropped connection
+    scheduleTasks();
+    Power_Init();
+    setupStep = NULL;
+    Health_CheckIn(netHealth);
+    LOG_INFO("Setup done in %lu ms\n", millis());
+}
+
+/**
+ * Resolve the broker that will be tried first, so the lookup overlaps the
+ * time sync instead of delaying the connect (cached address profile only)
+ */
+void prefetchBroker()
+{
+#if BROKER_ADDR_CACHE
+    int broker = BrokerList_Select(millis());
+    if (broker < 0) return;
+
+    char addr[DNS_CACHE_ADDR_LEN];
+    BootProfile_Begin(BOOT_DNS);
+    if (DnsCache_Resolve(BrokerList_Get(broker)->host, addr, sizeof(addr)) == 0)
+        BootProfile_End(BOOT_DNS);
+#endif
+}
+
+/**
+ * Check the Wi-Fi link; while it is down, poll the background reconnect
+ */
+void wifiTaskRun(void* context)
+{
+    if (hasWifi)
     {
-        updateDisplay("WiFi FAILED!", DeviceConfig_GetWifiSsid());
-        while (1) delay(1000);
+        // Link state as the reconnect logic sees it; this also renews a
+        // reused address when its time is up
+        hasWifi = WiFiReconnect_Poll();
+        if (hasWifi)
+        {
+            // Retries an LED pattern the UI ring had no room for
+            updateLEDs();
+            return;
+        }
+
+        hasMqtt = false;
+        updateLEDs();
+        if (!WiFiReconnect_InProgress())
+        {
+            LOG_WARN("WiFi lost, reconnecting...\n");
+            WiFiReconnect_Start();
+        }
     }
-    
-    hasWifi = true;
-    Serial.printf("IP: %s\n", WiFi.localIP().get_address());
-    
-    // Sync time via NTP
-    updateDisplay("Syncing time...");
-    SyncTime();
-    
-    // Connect to MQTT
-    updateDisplay("Connecting MQTT", DeviceConfig_GetBrokerHost());
-    if (!connectMQTT())
+
+    // The driver associates in the background; just check on it
+    if (!WiFiReconnect_Poll())
     {
-        updateDisplay("MQTT FAILED!", DeviceConfig_GetBrokerHost());
-        while (1) delay(1000);
+        Scheduler_RunIn(wifiTask, WIFI_RECONNECT_POLL_MS);
+        return;
     }
-    
-    hasMqtt = true;
+    hasWifi = true;
     updateLEDs();
-    
-    if (DeviceConfig_GetSubscribeTopic()[0] != '\0')
-    {
-        mqttClient.setCallback(messageCallback);
-        mqttClient.subscribe(DeviceConfig_GetSubscribeTopic());
-        Serial.printf("Subscribed to: %s\n", DeviceConfig_GetSubscribeTopic());
-    }
-    
-    updateDisplay("Ready", WiFi.localIP().get_address(), DeviceConfig_GetDeviceId());
-    Serial.println("Ready!\n");
+    LOG_INFO("IP: %s\n", WiFi.localIP().get_address());
+    updateDisplay("Connecting MQTT", ConfigCache_Get(CONFIG_BROKER_HOST));
+
+    // Send the SNTP request (if one is due), then resolve the broker while
+    // it is in flight
+    Scheduler_RunIn(timeTask, TimeSync_Run());
+    prefetchBroker();
+    Scheduler_RunIn(mqttTask, 0);
 }
 
-void loop()
+/**
+ * Keep the clock in sync; runs only while the link is up
+ */
+void timeTaskRun(void* context)
 {
-    static unsigned long lastPublish = 0;
-    static unsigned long lastWiFiCheck = 0;
-    unsigned long now = millis();
-    
-    // Check WiFi periodically
-    if (now - lastWiFiCheck >= 5000)
+    if (!hasWifi) return;
+    Scheduler_RunIn(timeTask, TimeSync_Run());
+}
+
+/**
+ * Track the heap minimum and the stack high-water marks
+ */
+void memTaskRun(void* context)
+{
+    Mem_Sample();
+}
+
+/**
+ * Send the next chunk of a requested trace dump
+ */
+void traceTaskRun(void* context)
+{
+    if (!Trace_DumpPending()) return;
+
+    static uint8_t chunk[TRACE_HEADER_SIZE + TRACE_CHUNK_RECORDS * sizeof(TraceRecord)];
+    char topic[128];
+    size_t len = Trace_NextChunk(chunk, sizeof(chunk));
+    if (len == 0) return;
+
+    if (!hasMqtt || !buildDiagTopic(topic, sizeof(topic), DIAG_TRACE_SUFFIX) ||
+        !mqttClient.publish(topic, chunk, len))
     {
-        lastWiFiCheck = now;
-        hasWifi = (WiFi.status() == WL_CONNECTED);
-        
-        if (!hasWifi)
-        {
-            hasMqtt = false;
-            updateLEDs();
-            Serial.println("WiFi lost, reconnecting...");
-            WiFi.begin();
-            return;
-        }
+        LOG_WARN("Trace: dump abandoned\n");
+        Trace_AbortDump();
+        return;
     }
-    
+    if (Trace_DumpPending()) Scheduler_RunIn(traceTask, TRACE_CHUNK_MS);
+}
+
+/**
+ * Service the MQTT connection and everything driven from it, reconnecting
+ * when the session drops
+ */
+void mqttTaskRun(void* context)
+{
     if (!hasWifi)
     {
-        delay(100);
+        // Nothing to do until the link is back; wifiTaskRun() wakes this
+        // task as soon as it is
+        Scheduler_RunIn(mqttTask, WIFI_CHECK_INTERVAL);
         return;
     }
-    
-    // Handle MQTT
+
     if (mqttClient.connected())
     {
+        static uint32_t lastReceived = 0;
+        static unsigned long lastTraffic = 0;
+
         hasMqtt = true;
         mqttClient.loop();
-    }
-    else
-    {
-        hasMqtt = false;
-        updateLEDs();
-        
-        if (connectMQTT())
+        InboundQueue_Process(INBOUND_BUDGET_MS);
+        if (MqttSession_SubacksPending() == 0) BootProfile_End(BOOT_SUBACK);
+
+        // Poll quickly while messages are flowing, slowly when idle
+        if (InboundQueue_GetStats()->received != lastReceived)
         {
-            hasMqtt = true;
-            updateLEDs();
-        if (DeviceConfig_GetSubscribeTopic()[0] != '\0')
-            mqttClient.subscribe(DeviceConfig_GetSubscribeTopic());
+            lastReceived = InboundQueue_GetStats()->received;
+            lastTraffic = millis();
         }
-        else
+        if (millis() - lastTraffic >= MQTT_ACTIVE_HOLD_MS)
+            Scheduler_RunIn(mqttTask, MQTT_IDLE_POLL_MS);
+
+        RemoteConfig_Poll();
+        Shadow_Poll();
+        FirmwareUpdate_Poll();
+
+        if (FirmwareUpdate_IsPendingReboot())
         {
-            delay(2000);
-            return;
+            LOG_INFO("Rebooting into new firmware...\n");
+            RemoteConfig_Flush();
+            updateDisplay("Firmware update", "Rebooting...");
+            // Let the final status report go out before resetting
+            mqttClient.loop();
+            wifiClient.flush();
+            delay(500);
+            Log_Flush(LOG_FLUSH_MS);
+            NVIC_SystemReset();
         }
+        return;
     }
-    
-    // Publish telemetry
-    if (now - lastPublish >= (unsigned long)DeviceConfig_GetSendInterval() * 1000)
+
+    hasMqtt = false;
+    updateLEDs();
+
+#if CONNECTION_PROFILE != PROFILE_MQTT_USERPASS
+    // Certificate validity checks need the clock, so there is no point
+    // connecting without it; after a failed sync round wait for a retry
+    if (!TimeSync_IsSynced())
     {
-        lastPublish = now;
-        publishTelemetry();
+        Scheduler_RunIn(mqttTask, TimeSync_GaveUp() ? MQTT_RETRY_MS : TIME_SYNC_POLL_MS);
+        return;
     }
-    
-    delay(10);
+#endif
+
+    if (!connectMQTT())
+    {
+        Scheduler_RunIn(mqttTask, MQTT_RETRY_MS);
+        return;
+    }
+
+    hasMqtt = true;
+    updateLEDs();
+    // A resumed session still holds the subscriptions
+    if (!MqttSession_GetStats()->sessionPresent || !routesSubscribed)
+        routesSubscribed = subscribeRoutes();
+    else
+        LOG_INFO("Session resumed, skipping resubscribe\n");
+    publishConnectStats();
+    BlobTransfer_AnnounceState();
+    Shadow_MarkAllDirty();
+
+    if (!BootProfile_IsComplete())
+    {
+        BootProfile_Complete();
+        // Report a watchdog reset as soon as it can be seen
+        if (Health_GetLastStall()->valid) publishHealth();
+    }
+    updateDisplay("Ready", WiFi.localIP().get_address(), ConfigCache_Get(CONFIG_DEVICE_ID));
+}
+
+void publishTaskRun(void* context)
+{
+    // Hold telemetry for the first sync; if that fails it is sent
+    // without a timestamp
+    if (hasMqtt && (TimeSync_IsSynced() || TimeSync_GaveUp())) publishTelemetry();
+}
+
+/**
+ * Refresh cached addresses close to expiry while the session is up, so a
+ * reconnect finds a fresh broker address. One lookup per run at most.
+ */
+void dnsTaskRun(void* context)
+{
+    if (hasMqtt) DnsCache_Refresh();
+}
+
+/**
+ * Show the latest readings on the OLED, independent of publishing. A sensor
+ * that was not read shows "--". Until the session is up the connection
+ * screens keep the display.
+ */
+void displayTaskRun(void* context)
+{
+    static uint32_t shown = 0;
+    SensorReadings readings;
+    if (!hasMqtt || !SensorSnapshot_Read(&readings) || readings.sample == shown) return;
+    shown = readings.sample;
+
+    char temp[8] = "--", hum[8] = "--", pres[12] = "--";
+    if (readings.present & SENSOR_TEMPERATURE)
+        snprintf(temp, sizeof(temp), "%.1fC", readings.temperature);
+    if (readings.present & SENSOR_HUMIDITY)
+        snprintf(hum, sizeof(hum), "%.0f%%", readings.humidity);
+    if (readings.present & SENSOR_PRESSURE)
+        snprintf(pres, sizeof(pres), "%.0f hPa", readings.pressure);
+
+    char line2[20], line3[20];
+    snprintf(line2, sizeof(line2), "T:%s H:%s", temp, hum);
+    snprintf(line3, sizeof(line3), "P:%s", pres);
+    updateDisplay(WiFi.localIP().get_address(), line2, line3);
+}
+
+void diagTaskRun(void* context)
+{
+    if (!hasMqtt) return;
+    publishDiagnostics();
+    BlobTransfer_Poll();
+}
+
+/**
+ * Register the periodic work with the scheduler
+ */
+void scheduleTasks()
+{
+    wifiTask = Scheduler_Add("wifi", wifiTaskRun, NULL, WIFI_CHECK_INTERVAL, 0);
+    mqttTask = Scheduler_Add("mqtt", mqttTaskRun, NULL, MQTT_POLL_MS, 0);
+    publishTask = Scheduler_Add("publish", publishTaskRun, NULL, RemoteConfig_Get()->sendIntervalS * 1000UL, 0);
+    diagTask = Scheduler_Add("diag", diagTaskRun, NULL, DIAG_INTERVAL_MS, DIAG_INTERVAL_MS);
+    timeTask = Scheduler_Add("time", timeTaskRun, NULL, 0, 0);
+    memTask = Scheduler_Add("mem", memTaskRun, NULL, MEM_SAMPLE_MS, MEM_SAMPLE_MS);
+    traceTask = Scheduler_Add("trace", traceTaskRun, NULL, 0, 0);
+    displayTask = Scheduler_Add("display", displayTaskRun, NULL, DISPLAY_SENSOR_MS, DISPLAY_SENSOR_MS);
+#if BROKER_ADDR_CACHE
+    dnsTask = Scheduler_Add("dns", dnsTaskRun, NULL, DNS_CACHE_RETRY_MS, DNS_CACHE_RETRY_MS);
+#endif
+}
+
+void loop()
+{
+    Trace_Record(TRACE_LOOP_BEGIN);
+    Health_LoopBegin();
+    uint32_t idleMs = Scheduler_RunDue();
+    int slowestId = Scheduler_LastSlowest();
+    const SchedulerTaskInfo* slowest = Scheduler_GetInfo(slowestId);
+    Health_LoopEnd(slowest ? slowest->name : NULL);
+    Trace_Record(TRACE_LOOP_END, slowest ? slowestId : 0xFFFF, idleMs);
+    Health_CheckIn(netHealth);
+
+    // Sleep until the next task is due
+    if (idleMs > 0) Power_Idle(idleMs);
 }
@@ -0,0 +1,39 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the framework header in the native tests
+ *
+ * Provides only what the host-built modules use. The clock does not run on
+ * its own; tests set it through Host_Clock().
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct HostClock
+{
+    uint32_t ms;
+    uint32_t us;
+};
+
+inline HostClock& Host_Clock()
+{
+    static HostClock clock;
+    return clock;
+}
+
+inline unsigned long millis()
+{
+    return Host_Clock().ms;
+}
+
+inline unsigned long micros()
+{
+    return Host_Clock().us;
+}
+
+#endif // HOST_ARDUINO_H
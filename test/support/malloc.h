@@ -0,0 +1,25 @@
+/**
+ * @file malloc.h
+ * @brief Host stand-in for newlib's malloc.h in the native tests
+ *
+ * glibc deprecates mallinfo(), and the host heap says nothing about the
+ * device's, so heap in use always reads 0.
+ */
+
+#ifndef HOST_MALLOC_H
+#define HOST_MALLOC_H
+
+#include <stdlib.h>
+
+struct mallinfo
+{
+    int uordblks;   // bytes in use
+};
+
+inline struct mallinfo mallinfo()
+{
+    struct mallinfo info = { 0 };
+    return info;
+}
+
+#endif // HOST_MALLOC_H
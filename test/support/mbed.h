@@ -0,0 +1,30 @@
+/**
+ * @file mbed.h
+ * @brief Host stand-in for the mbed OS header in the native tests
+ *
+ * Provides only what the host-built modules use: the memory barrier and a
+ * thread yield, mapped onto the host's.
+ */
+
+#ifndef HOST_MBED_H
+#define HOST_MBED_H
+
+#include <thread>
+
+inline void __DMB()
+{
+    __sync_synchronize();
+}
+
+namespace rtos
+{
+struct Thread
+{
+    static void yield()
+    {
+        std::this_thread::yield();
+    }
+};
+}
+
+#endif // HOST_MBED_H
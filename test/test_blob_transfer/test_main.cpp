@@ -0,0 +1,294 @@
+/**
+ * @file test_main.cpp
+ * @brief BlobTransfer go-back-N ordering, CRC checks and header validation
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "BlobTransfer.h"
+
+#define KIND 1
+#define CHUNK 4
+
+// What the sink and the ack callback saw
+static uint8_t stored[64];
+static size_t storedLen;
+static int begins;
+static int finishes;
+static bool finishedOk;
+static char lastAck[128];
+static int acks;
+
+static bool sinkBegin(uint16_t id, uint32_t totalSize, void* context)
+{
+    begins++;
+    storedLen = 0;
+    return true;
+}
+
+static bool sinkWrite(uint32_t offset, const uint8_t* data, size_t length, void* context)
+{
+    if (offset != storedLen || offset + length > sizeof(stored)) return false;
+    memcpy(stored + offset, data, length);
+    storedLen += length;
+    return true;
+}
+
+static bool sinkFinish(bool ok, void* context)
+{
+    finishes++;
+    finishedOk = ok;
+    return true;
+}
+
+static const BlobSink sink = { sinkBegin, sinkWrite, sinkFinish, NULL };
+
+static bool recordAck(const char* json)
+{
+    snprintf(lastAck, sizeof(lastAck), "%s", json);
+    acks++;
+    return true;
+}
+
+static void putU16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void putU32(uint8_t* p, uint32_t v)
+{
+    putU16(p, (uint16_t)(v >> 16));
+    putU16(p + 2, (uint16_t)v);
+}
+
+/**
+ * Send chunk seq of data (totalSize bytes in CHUNK-byte chunks)
+ */
+static void sendChunk(uint16_t id, uint16_t seq, const uint8_t* data, uint32_t totalSize,
+    uint16_t chunkSize = CHUNK, bool corrupt = false)
+{
+    uint8_t msg[BLOB_HEADER_SIZE + 64] = { 0 };
+    uint32_t offset = (uint32_t)seq * chunkSize;
+    size_t len = offset < totalSize ? totalSize - offset : 0;
+    if (len > chunkSize) len = chunkSize;
+    if (len > sizeof(msg) - BLOB_HEADER_SIZE) len = sizeof(msg) - BLOB_HEADER_SIZE;
+
+    msg[0] = BLOB_PROTOCOL_VERSION;
+    msg[1] = KIND;
+    putU16(msg + 4, id);
+    putU16(msg + 6, seq);
+    putU16(msg + 8, chunkSize);
+    putU32(msg + 12, totalSize);
+    if (data) memcpy(msg + BLOB_HEADER_SIZE, data + offset, len);
+    putU32(msg + 16, BlobTransfer_Crc32(0, msg + BLOB_HEADER_SIZE, len) ^ (corrupt ? 1 : 0));
+    BlobTransfer_OnMessage("blob", msg, (unsigned int)(BLOB_HEADER_SIZE + len), NULL);
+}
+
+static void assertAck(const char* status, unsigned next)
+{
+    char expected[64];
+    snprintf(expected, sizeof(expected), "\"next\":%u,", next);
+    TEST_ASSERT_NOT_NULL(strstr(lastAck, expected));
+    snprintf(expected, sizeof(expected), "\"status\":\"%s\"", status);
+    TEST_ASSERT_NOT_NULL(strstr(lastAck, expected));
+}
+
+static const uint8_t data[] = "0123456789abcdefghijklmnopqrstuv";     // 32 bytes, 8 chunks
+
+void setUp()
+{
+    BlobTransfer_Init(recordAck);
+    BlobTransfer_RegisterSink(KIND, &sink);
+    storedLen = 0;
+    begins = finishes = acks = 0;
+    finishedOk = false;
+    lastAck[0] = '\0';
+}
+
+void tearDown()
+{
+    // Expire whatever a test left active so the next one starts idle
+    Host_Clock().ms += BLOB_IDLE_TIMEOUT_MS + 1;
+    BlobTransfer_Poll();
+}
+
+void test_crc32_known_value()
+{
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, BlobTransfer_Crc32(0, (const uint8_t*)"123456789", 9));
+
+    // Continuing from a previous CRC equals one pass over the whole buffer
+    uint32_t crc = BlobTransfer_Crc32(0, (const uint8_t*)"1234", 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926, BlobTransfer_Crc32(crc, (const uint8_t*)"56789", 5));
+}
+
+void test_in_order_transfer_completes()
+{
+    for (uint16_t seq = 0; seq < 8; seq++)
+    {
+        sendChunk(10, seq, data, 32);
+        if (seq == BLOB_WINDOW / 2 - 1) assertAck("ok", BLOB_WINDOW / 2);
+    }
+    assertAck("done", 8);
+    TEST_ASSERT_EQUAL_INT(1, begins);
+    TEST_ASSERT_EQUAL_INT(1, finishes);
+    TEST_ASSERT_TRUE(finishedOk);
+    TEST_ASSERT_EQUAL_size_t(32, storedLen);
+    TEST_ASSERT_EQUAL_MEMORY(data, stored, 32);
+}
+
+void test_short_last_chunk()
+{
+    for (uint16_t seq = 0; seq < 3; seq++) sendChunk(11, seq, data, 10);
+    assertAck("done", 3);
+    TEST_ASSERT_EQUAL_size_t(10, storedLen);
+    TEST_ASSERT_EQUAL_MEMORY(data, stored, 10);
+}
+
+void test_crc_mismatch_rejected_and_resent()
+{
+    sendChunk(12, 0, data, 32);
+    sendChunk(12, 1, data, 32, CHUNK, true);
+    assertAck("crc", 1);
+    TEST_ASSERT_EQUAL_size_t(CHUNK, storedLen);
+
+    // The sender resends from the acknowledged chunk
+    for (uint16_t seq = 1; seq < 8; seq++) sendChunk(12, seq, data, 32);
+    assertAck("done", 8);
+    TEST_ASSERT_EQUAL_MEMORY(data, stored, 32);
+}
+
+void test_corrupt_first_chunk_does_not_start()
+{
+    sendChunk(13, 0, data, 32, CHUNK, true);
+    assertAck("crc", 0);
+    TEST_ASSERT_EQUAL_INT(0, begins);
+}
+
+void test_gap_goes_back_to_next_expected()
+{
+    sendChunk(14, 0, data, 32);
+    sendChunk(14, 1, data, 32);
+
+    // Chunk 2 is lost; the window keeps going and every later chunk is refused
+    sendChunk(14, 3, data, 32);
+    assertAck("seq", 2);
+    sendChunk(14, 4, data, 32);
+    assertAck("seq", 2);
+    TEST_ASSERT_EQUAL_size_t(2 * CHUNK, storedLen);
+
+    // Go back to 2 and resend the rest of the window
+    for (uint16_t seq = 2; seq < 8; seq++) sendChunk(14, seq, data, 32);
+    assertAck("done", 8);
+    TEST_ASSERT_EQUAL_MEMORY(data, stored, 32);
+}
+
+void test_duplicate_chunk_acknowledged()
+{
+    sendChunk(15, 0, data, 32);
+    sendChunk(15, 1, data, 32);
+    sendChunk(15, 0, data, 32);
+    assertAck("dup", 2);
+    TEST_ASSERT_EQUAL_size_t(2 * CHUNK, storedLen);
+}
+
+void test_unknown_transfer_must_start_at_zero()
+{
+    sendChunk(16, 3, data, 32);
+    assertAck("unknown", 0);
+    TEST_ASSERT_EQUAL_INT(0, begins);
+}
+
+void test_wrong_length_rejected()
+{
+    sendChunk(17, 0, data, 32);
+
+    // A chunk claiming the same header but carrying only 2 bytes of data
+    sendChunk(17, 1, data, 6);
+    assertAck("length", 1);
+    TEST_ASSERT_EQUAL_size_t(CHUNK, storedLen);
+}
+
+void test_chunk_count_over_16_bits_rejected()
+{
+    // 65536 one-byte chunks cannot be numbered
+    sendChunk(18, 0, data, 0x10000, 1);
+    assertAck("size", 0);
+    TEST_ASSERT_EQUAL_INT(0, begins);
+
+    // A total size near 4 GiB must not wrap the chunk count either
+    sendChunk(18, 0, data, 0xFFFFFFFF, 1);
+    assertAck("size", 0);
+    TEST_ASSERT_EQUAL_INT(0, begins);
+}
+
+void test_chunk_count_at_limit_accepted()
+{
+    sendChunk(19, 0, data, 0xFFFF, 1);
+    TEST_ASSERT_EQUAL_INT(1, begins);
+    TEST_ASSERT_EQUAL_size_t(1, storedLen);
+    TEST_ASSERT_NULL(strstr(lastAck, "size"));
+}
+
+void test_new_id_replaces_active_transfer()
+{
+    sendChunk(20, 0, data, 32);
+    sendChunk(21, 0, data, 32);
+    TEST_ASSERT_EQUAL_INT(2, begins);
+    TEST_ASSERT_EQUAL_INT(1, finishes);
+    TEST_ASSERT_FALSE(finishedOk);
+
+    // The old transfer is gone
+    sendChunk(20, 1, data, 32);
+    assertAck("unknown", 0);
+}
+
+void test_idle_transfer_expires()
+{
+    sendChunk(22, 0, data, 32);
+    Host_Clock().ms += BLOB_IDLE_TIMEOUT_MS;
+    BlobTransfer_Poll();
+    TEST_ASSERT_EQUAL_INT(0, finishes);
+
+    Host_Clock().ms += 1;
+    BlobTransfer_Poll();
+    TEST_ASSERT_EQUAL_INT(1, finishes);
+    TEST_ASSERT_FALSE(finishedOk);
+}
+
+void test_query_and_announce()
+{
+    uint8_t msg[BLOB_HEADER_SIZE] = { BLOB_PROTOCOL_VERSION, KIND, BLOB_FLAG_QUERY };
+    putU16(msg + 4, 23);
+    BlobTransfer_OnMessage("blob", msg, sizeof(msg), NULL);
+    assertAck("idle", 0);
+
+    sendChunk(23, 0, data, 32);
+    BlobTransfer_OnMessage("blob", msg, sizeof(msg), NULL);
+    assertAck("ok", 1);
+
+    acks = 0;
+    BlobTransfer_AnnounceState();
+    TEST_ASSERT_EQUAL_INT(1, acks);
+    assertAck("ok", 1);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_crc32_known_value);
+    RUN_TEST(test_in_order_transfer_completes);
+    RUN_TEST(test_short_last_chunk);
+    RUN_TEST(test_crc_mismatch_rejected_and_resent);
+    RUN_TEST(test_corrupt_first_chunk_does_not_start);
+    RUN_TEST(test_gap_goes_back_to_next_expected);
+    RUN_TEST(test_duplicate_chunk_acknowledged);
+    RUN_TEST(test_unknown_transfer_must_start_at_zero);
+    RUN_TEST(test_wrong_length_rejected);
+    RUN_TEST(test_chunk_count_over_16_bits_rejected);
+    RUN_TEST(test_chunk_count_at_limit_accepted);
+    RUN_TEST(test_new_id_replaces_active_transfer);
+    RUN_TEST(test_idle_transfer_expires);
+    RUN_TEST(test_query_and_announce);
+    return UNITY_END();
+}
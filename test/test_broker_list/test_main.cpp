@@ -0,0 +1,163 @@
+/**
+ * @file test_main.cpp
+ * @brief BrokerList parsing, scoring, selection and cooldown
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "BrokerList.h"
+
+void setUp()
+{
+    BrokerList_Init("primary.example.com", 8883, "");
+}
+
+void tearDown()
+{
+}
+
+void test_primary_only()
+{
+    TEST_ASSERT_EQUAL_INT(1, BrokerList_Count());
+    TEST_ASSERT_EQUAL_STRING("primary.example.com", BrokerList_Get(0)->host);
+    TEST_ASSERT_EQUAL_INT(8883, BrokerList_Get(0)->port);
+    TEST_ASSERT_NULL(BrokerList_Get(1));
+    TEST_ASSERT_NULL(BrokerList_Get(-1));
+}
+
+void test_parse_extra_list()
+{
+    int count = BrokerList_Init("primary", 1883, "west:8883, east ,north:0,,south:1884");
+    TEST_ASSERT_EQUAL_INT(BROKER_LIST_MAX < 5 ? BROKER_LIST_MAX : 5, count);
+    TEST_ASSERT_EQUAL_STRING("west", BrokerList_Get(1)->host);
+    TEST_ASSERT_EQUAL_INT(8883, BrokerList_Get(1)->port);
+    // Surrounding spaces are trimmed, a missing port uses the primary one
+    TEST_ASSERT_EQUAL_STRING("east", BrokerList_Get(2)->host);
+    TEST_ASSERT_EQUAL_INT(1883, BrokerList_Get(2)->port);
+    // An invalid port falls back to the primary one too
+    TEST_ASSERT_EQUAL_STRING("north", BrokerList_Get(3)->host);
+    TEST_ASSERT_EQUAL_INT(1883, BrokerList_Get(3)->port);
+}
+
+void test_parse_skips_bad_entries()
+{
+    char longHost[BROKER_HOST_LEN + 8];
+    memset(longHost, 'a', sizeof(longHost) - 1);
+    longHost[sizeof(longHost) - 1] = '\0';
+
+    char list[BROKER_HOST_LEN + 32];
+    snprintf(list, sizeof(list), ":1883,%s,ok", longHost);
+    TEST_ASSERT_EQUAL_INT(2, BrokerList_Init("primary", 1883, list));
+    TEST_ASSERT_EQUAL_STRING("ok", BrokerList_Get(1)->host);
+
+    // No primary: the list alone
+    TEST_ASSERT_EQUAL_INT(1, BrokerList_Init("", 1883, "backup"));
+    TEST_ASSERT_EQUAL_STRING("backup", BrokerList_Get(0)->host);
+    TEST_ASSERT_EQUAL_INT(0, BrokerList_Init(NULL, 1883, NULL));
+}
+
+void test_parse_stops_at_capacity()
+{
+    TEST_ASSERT_EQUAL_INT(BROKER_LIST_MAX, BrokerList_Init("p", 1, "a,b,c,d,e,f,g,h,i,j"));
+}
+
+void test_unmeasured_ties_go_to_first()
+{
+    BrokerList_Init("a", 1, "b,c");
+    TEST_ASSERT_EQUAL_INT(0, BrokerList_Select(1000));
+    TEST_ASSERT_EQUAL_INT(1, BrokerList_Select(1000, 1u << 0));
+    TEST_ASSERT_EQUAL_INT(-1, BrokerList_Select(1000, 0x7));
+}
+
+void test_select_fastest()
+{
+    BrokerList_Init("a", 1, "b,c");
+    BrokerList_ReportSuccess(0, 2000);
+    BrokerList_ReportSuccess(1, 400);
+    TEST_ASSERT_EQUAL_INT(1, BrokerList_Select(1000));
+
+    // Moving average: one slow connect does not outweigh the history
+    BrokerList_ReportSuccess(1, 2400);
+    TEST_ASSERT_EQUAL_UINT32(900, BrokerList_Get(1)->avgConnectMs);
+    TEST_ASSERT_EQUAL_INT(1, BrokerList_Select(1000));
+}
+
+void test_failure_penalty_and_cooldown()
+{
+    BrokerList_Init("a", 1, "b");
+    BrokerList_ReportSuccess(0, 100);
+    BrokerList_ReportSuccess(1, 500);
+
+    BrokerList_ReportFailure(0, 1000);
+    TEST_ASSERT_TRUE(BrokerList_IsCoolingDown(0, 1000));
+    TEST_ASSERT_TRUE(BrokerList_IsCoolingDown(0, 1000 + BROKER_COOLDOWN_MS - 1));
+    TEST_ASSERT_FALSE(BrokerList_IsCoolingDown(0, 1000 + BROKER_COOLDOWN_MS));
+    TEST_ASSERT_EQUAL_INT(1, BrokerList_Select(2000));
+
+    // After the cooldown the penalty still ranks it behind the other one
+    TEST_ASSERT_EQUAL_UINT32(100 + BROKER_FAILURE_PENALTY_MS, BrokerList_Score(BrokerList_Get(0)));
+    TEST_ASSERT_EQUAL_INT(1, BrokerList_Select(1000 + BROKER_COOLDOWN_MS));
+
+    // A success clears both
+    BrokerList_ReportSuccess(0, 100);
+    TEST_ASSERT_FALSE(BrokerList_IsCoolingDown(0, 1000));
+    TEST_ASSERT_EQUAL_INT(0, BrokerList_Select(1000));
+}
+
+void test_cooldown_doubles_up_to_max()
+{
+    uint32_t expected = BROKER_COOLDOWN_MS;
+    for (int i = 0; i < 16; i++)
+    {
+        BrokerList_ReportFailure(0, 0);
+        TEST_ASSERT_EQUAL_UINT32(expected, BrokerList_Get(0)->cooldownUntil);
+        expected = expected * 2 > BROKER_COOLDOWN_MAX_MS ? BROKER_COOLDOWN_MAX_MS : expected * 2;
+    }
+}
+
+void test_all_cooling_down_picks_earliest()
+{
+    BrokerList_Init("a", 1, "b,c");
+    BrokerList_ReportFailure(0, 3000);
+    BrokerList_ReportFailure(1, 1000);
+    BrokerList_ReportFailure(2, 2000);
+    TEST_ASSERT_EQUAL_INT(1, BrokerList_Select(3000));
+    TEST_ASSERT_EQUAL_INT(2, BrokerList_Select(3000, 1u << 1));
+}
+
+void test_cooldown_across_millis_wrap()
+{
+    uint32_t now = 0xFFFFFFFFu - 1000;
+    BrokerList_ReportFailure(0, now);
+    // The deadline wraps past zero
+    TEST_ASSERT_TRUE(BrokerList_Get(0)->cooldownUntil < now);
+    TEST_ASSERT_TRUE(BrokerList_IsCoolingDown(0, now));
+    TEST_ASSERT_TRUE(BrokerList_IsCoolingDown(0, now + BROKER_COOLDOWN_MS - 1));
+    TEST_ASSERT_FALSE(BrokerList_IsCoolingDown(0, now + BROKER_COOLDOWN_MS));
+}
+
+void test_out_of_range_reports_ignored()
+{
+    BrokerList_ReportFailure(5, 0);
+    BrokerList_ReportSuccess(-1, 0);
+    TEST_ASSERT_FALSE(BrokerList_IsCoolingDown(5, 0));
+    TEST_ASSERT_EQUAL_UINT8(0, BrokerList_Get(0)->failures);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_primary_only);
+    RUN_TEST(test_parse_extra_list);
+    RUN_TEST(test_parse_skips_bad_entries);
+    RUN_TEST(test_parse_stops_at_capacity);
+    RUN_TEST(test_unmeasured_ties_go_to_first);
+    RUN_TEST(test_select_fastest);
+    RUN_TEST(test_failure_penalty_and_cooldown);
+    RUN_TEST(test_cooldown_doubles_up_to_max);
+    RUN_TEST(test_all_cooling_down_picks_earliest);
+    RUN_TEST(test_cooldown_across_millis_wrap);
+    RUN_TEST(test_out_of_range_reports_ignored);
+    return UNITY_END();
+}
@@ -0,0 +1,180 @@
+/**
+ * @file test_main.cpp
+ * @brief DnsCache hits, expiry, refresh window and failures against a stub
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "DnsCache.h"
+
+// The cache has no reset, so every test uses its own host names, and the
+// ones it used are invalidated afterwards
+static char used[16][DNS_CACHE_HOST_LEN];
+static int usedCount = 0;
+static int lookups = 0;
+static int failWith = 0;
+static char nextAddr[DNS_CACHE_ADDR_LEN];
+
+static int stubResolve(const char* host, char* addr, size_t size)
+{
+    lookups++;
+    if (failWith) return failWith;
+    snprintf(addr, size, "%s", nextAddr);
+    return 0;
+}
+
+static void resolveOk(const char* host, const char* expected, bool expectCached)
+{
+    if (usedCount < 16 && strlen(host) < DNS_CACHE_HOST_LEN)
+        strcpy(used[usedCount++], host);
+
+    char addr[DNS_CACHE_ADDR_LEN];
+    bool cached = !expectCached;
+    TEST_ASSERT_EQUAL_INT(0, DnsCache_Resolve(host, addr, sizeof(addr), &cached));
+    TEST_ASSERT_EQUAL_STRING(expected, addr);
+    TEST_ASSERT_EQUAL(expectCached, cached);
+}
+
+void setUp()
+{
+    // Time only moves forward, so older tests hold the older entries
+    Host_Clock().ms += 1000;
+    lookups = 0;
+    failWith = 0;
+    strcpy(nextAddr, "10.0.0.1");
+    DnsCache_SetResolver(stubResolve);
+}
+
+void tearDown()
+{
+    for (int i = 0; i < usedCount; i++)
+        DnsCache_ReportFailure(used[i]);
+    usedCount = 0;
+}
+
+void test_hit_within_ttl()
+{
+    resolveOk("hit.example", "10.0.0.1", false);
+    strcpy(nextAddr, "10.0.0.2");
+    Host_Clock().ms += DNS_CACHE_TTL_MS - 1;
+    resolveOk("hit.example", "10.0.0.1", true);
+    TEST_ASSERT_EQUAL_INT(1, lookups);
+}
+
+void test_expired_entry_resolved_again()
+{
+    resolveOk("expiry.example", "10.0.0.1", false);
+    strcpy(nextAddr, "10.0.0.2");
+    Host_Clock().ms += DNS_CACHE_TTL_MS;
+    resolveOk("expiry.example", "10.0.0.2", false);
+    TEST_ASSERT_EQUAL_INT(2, lookups);
+}
+
+void test_failed_lookup_serves_expired_address()
+{
+    resolveOk("stale.example", "10.0.0.1", false);
+    Host_Clock().ms += DNS_CACHE_TTL_MS;
+    failWith = -3009;
+    resolveOk("stale.example", "10.0.0.1", true);
+}
+
+void test_reported_failure_forces_lookup()
+{
+    resolveOk("fail.example", "10.0.0.1", false);
+    DnsCache_ReportFailure("fail.example");
+    strcpy(nextAddr, "10.0.0.2");
+    resolveOk("fail.example", "10.0.0.2", false);
+
+    // A failed address is not served when the lookup fails too
+    DnsCache_ReportFailure("fail.example");
+    failWith = -3009;
+    char addr[DNS_CACHE_ADDR_LEN];
+    TEST_ASSERT_EQUAL_INT(-3009, DnsCache_Resolve("fail.example", addr, sizeof(addr)));
+}
+
+void test_refresh_window()
+{
+    resolveOk("refresh.example", "10.0.0.1", false);
+    lookups = 0;
+
+    // Not yet within DNS_CACHE_REFRESH_MS of expiry
+    Host_Clock().ms += DNS_CACHE_TTL_MS - DNS_CACHE_REFRESH_MS - 1;
+    TEST_ASSERT_FALSE(DnsCache_Refresh());
+
+    Host_Clock().ms += 1;
+    strcpy(nextAddr, "10.0.0.2");
+    TEST_ASSERT_TRUE(DnsCache_Refresh());
+    TEST_ASSERT_EQUAL_INT(1, lookups);
+
+    // The refreshed entry starts a new lifetime
+    Host_Clock().ms += DNS_CACHE_TTL_MS - 1;
+    resolveOk("refresh.example", "10.0.0.2", true);
+}
+
+void test_failed_refresh_spaced_and_keeps_address()
+{
+    resolveOk("retry.example", "10.0.0.1", false);
+    Host_Clock().ms += DNS_CACHE_TTL_MS - DNS_CACHE_REFRESH_MS;
+    failWith = -3009;
+    lookups = 0;
+    TEST_ASSERT_TRUE(DnsCache_Refresh());
+
+    // No second attempt until DNS_CACHE_RETRY_MS has passed
+    Host_Clock().ms += DNS_CACHE_RETRY_MS - 1;
+    TEST_ASSERT_FALSE(DnsCache_Refresh());
+    Host_Clock().ms += 1;
+    TEST_ASSERT_TRUE(DnsCache_Refresh());
+    TEST_ASSERT_EQUAL_INT(2, lookups);
+
+    // The address is still served until it expires
+    resolveOk("retry.example", "10.0.0.1", true);
+}
+
+void test_oldest_entry_recycled()
+{
+    char host[16];
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++)
+    {
+        snprintf(host, sizeof(host), "r%d.example", i);
+        resolveOk(host, "10.0.0.1", false);
+        Host_Clock().ms += 10;
+    }
+    // One more host takes the slot of r0, the oldest
+    resolveOk("new.example", "10.0.0.1", false);
+    lookups = 0;
+    resolveOk("r1.example", "10.0.0.1", true);
+    resolveOk("r0.example", "10.0.0.1", false);
+    TEST_ASSERT_EQUAL_INT(1, lookups);
+}
+
+void test_long_host_not_cached()
+{
+    char host[DNS_CACHE_HOST_LEN + 8];
+    memset(host, 'a', sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    resolveOk(host, "10.0.0.1", false);
+    resolveOk(host, "10.0.0.1", false);
+    TEST_ASSERT_EQUAL_INT(2, lookups);
+}
+
+void test_no_resolver_fails()
+{
+    DnsCache_SetResolver(NULL);
+    char addr[DNS_CACHE_ADDR_LEN];
+    TEST_ASSERT_TRUE(DnsCache_Resolve("none.example", addr, sizeof(addr)) != 0);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hit_within_ttl);
+    RUN_TEST(test_expired_entry_resolved_again);
+    RUN_TEST(test_failed_lookup_serves_expired_address);
+    RUN_TEST(test_reported_failure_forces_lookup);
+    RUN_TEST(test_refresh_window);
+    RUN_TEST(test_failed_refresh_spaced_and_keeps_address);
+    RUN_TEST(test_oldest_entry_recycled);
+    RUN_TEST(test_long_host_not_cached);
+    RUN_TEST(test_no_resolver_fails);
+    return UNITY_END();
+}
@@ -0,0 +1,309 @@
+/**
+ * @file test_main.cpp
+ * @brief FirmwareUpdate manifest checks and erase-ahead pipeline on a RAM flash
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "mbedtls/sha256.h"
+#include "BlobTransfer.h"
+#include "FirmwareUpdate.h"
+
+#define REGION_SIZE 8192
+#define BLOCK 512
+#define CHUNK 256
+#define IMAGE_SIZE 3000     // six erase blocks, twelve chunks
+
+// ===== RAM flash port =====
+
+static uint8_t region[REGION_SIZE];
+static int eraseCalls;
+static bool failErase;
+static bool activated;
+static uint32_t activatedSize;
+
+static uint32_t ramRegionSize()
+{
+    return REGION_SIZE;
+}
+
+static bool ramErase(uint32_t offset, uint32_t length)
+{
+    if (failErase || offset + length > REGION_SIZE) return false;
+    memset(region + offset, 0xFF, length);
+    eraseCalls++;
+    return true;
+}
+
+static bool ramProgram(uint32_t offset, const uint8_t* data, size_t length)
+{
+    if (offset + length > REGION_SIZE) return false;
+
+    // Like NOR flash, only erased bytes can be programmed
+    for (size_t i = 0; i < length; i++)
+        if (region[offset + i] != 0xFF) return false;
+    memcpy(region + offset, data, length);
+    return true;
+}
+
+static bool ramActivate(uint32_t imageSize)
+{
+    activated = true;
+    activatedSize = imageSize;
+    return true;
+}
+
+static const FirmwareFlashPort ramPort = { BLOCK, ramRegionSize, ramErase, ramProgram, ramActivate };
+
+// ===== Helpers =====
+
+static uint8_t image[IMAGE_SIZE];
+static char imageHash[65];
+static char lastStatus[256];
+static int statuses;
+
+static bool recordStatus(const char* json)
+{
+    snprintf(lastStatus, sizeof(lastStatus), "%s", json);
+    statuses++;
+    return true;
+}
+
+static bool ignoreAck(const char* json)
+{
+    return true;
+}
+
+static void assertStatus(const char* status)
+{
+    char expected[48];
+    snprintf(expected, sizeof(expected), "\"status\":\"%s\"", status);
+    TEST_ASSERT_NOT_NULL(strstr(lastStatus, expected));
+}
+
+static void sendManifest(long id, long size, const char* hash)
+{
+    char json[160];
+    int len = snprintf(json, sizeof(json), "{\"id\":%ld,\"size\":%ld,\"sha256\":\"%s\"}", id, size, hash);
+    FirmwareUpdate_OnManifest("ota", (const uint8_t*)json, (unsigned int)len, NULL);
+}
+
+static void putU16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void putU32(uint8_t* p, uint32_t v)
+{
+    putU16(p, (uint16_t)(v >> 16));
+    putU16(p + 2, (uint16_t)v);
+}
+
+/**
+ * Send image chunk seq as a firmware blob
+ */
+static void sendChunk(uint16_t id, uint16_t seq)
+{
+    uint8_t msg[BLOB_HEADER_SIZE + CHUNK] = { BLOB_PROTOCOL_VERSION, BLOB_KIND_FIRMWARE };
+    uint32_t offset = (uint32_t)seq * CHUNK;
+    size_t len = IMAGE_SIZE - offset < CHUNK ? IMAGE_SIZE - offset : CHUNK;
+
+    putU16(msg + 4, id);
+    putU16(msg + 6, seq);
+    putU16(msg + 8, CHUNK);
+    putU32(msg + 12, IMAGE_SIZE);
+    memcpy(msg + BLOB_HEADER_SIZE, image + offset, len);
+    putU32(msg + 16, BlobTransfer_Crc32(0, msg + BLOB_HEADER_SIZE, len));
+    BlobTransfer_OnMessage("blob", msg, (unsigned int)(BLOB_HEADER_SIZE + len), NULL);
+}
+
+static const uint16_t CHUNKS = (IMAGE_SIZE + CHUNK - 1) / CHUNK;
+
+void setUp()
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        for (size_t i = 0; i < sizeof(image); i++) image[i] = (uint8_t)(i * 7 + (i >> 8));
+
+        uint8_t digest[32];
+        mbedtls_sha256_context sha;
+        mbedtls_sha256_init(&sha);
+        mbedtls_sha256_starts(&sha, 0);
+        mbedtls_sha256_update(&sha, image, sizeof(image));
+        mbedtls_sha256_finish(&sha, digest);
+        for (int i = 0; i < 32; i++) snprintf(imageHash + i * 2, 3, "%02x", digest[i]);
+
+        BlobTransfer_Init(ignoreAck);
+        FirmwareUpdate_Init(recordStatus, &ramPort);
+        initialized = true;
+    }
+
+    memset(region, 0, sizeof(region));      // programmed, not erased
+    eraseCalls = 0;
+    failErase = false;
+    activated = false;
+    statuses = 0;
+    lastStatus[0] = '\0';
+}
+
+void tearDown()
+{
+}
+
+void test_host_sha256()
+{
+    uint8_t digest[32];
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    mbedtls_sha256_update(&sha, (const uint8_t*)"abc", 3);
+    mbedtls_sha256_finish(&sha, digest);
+
+    const uint8_t expected[] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+    };
+    TEST_ASSERT_EQUAL_MEMORY(expected, digest, 32);
+}
+
+void test_manifest_id_out_of_range_ignored()
+{
+    sendManifest(-1, IMAGE_SIZE, imageHash);
+    sendManifest(65536, IMAGE_SIZE, imageHash);
+    sendManifest(70001, IMAGE_SIZE, imageHash);
+    TEST_ASSERT_EQUAL_INT(0, statuses);
+
+    FirmwareUpdate_Poll();
+    TEST_ASSERT_EQUAL_INT(0, eraseCalls);
+
+    sendManifest(65535, IMAGE_SIZE, imageHash);
+    assertStatus("erasing");
+    TEST_ASSERT_NOT_NULL(strstr(lastStatus, "\"id\":65535,"));
+}
+
+void test_manifest_checks()
+{
+    sendManifest(30, REGION_SIZE + 1, imageHash);
+    assertStatus("rejected");
+    sendManifest(31, 0, imageHash);
+    assertStatus("rejected");
+    sendManifest(32, IMAGE_SIZE, "abcd");
+    assertStatus("rejected");
+
+    FirmwareUpdate_Poll();
+    TEST_ASSERT_EQUAL_INT(0, eraseCalls);
+}
+
+void test_chunks_refused_until_armed()
+{
+    sendManifest(40, IMAGE_SIZE, imageHash);
+    assertStatus("erasing");
+
+    sendChunk(40, 0);
+    assertStatus("erasing");
+    TEST_ASSERT_EQUAL_UINT8(0, region[0]);
+}
+
+void test_unpolled_writes_erase_inline()
+{
+    sendManifest(50, IMAGE_SIZE, imageHash);
+    FirmwareUpdate_Poll();
+    assertStatus("armed");
+    TEST_ASSERT_EQUAL_INT(1, eraseCalls);
+
+    // Without Poll between chunks, every later block is erased by the write
+    // that reaches it
+    for (uint16_t seq = 0; seq + 1 < CHUNKS; seq++) sendChunk(50, seq);
+    assertStatus("receiving");
+    TEST_ASSERT_EQUAL_INT(IMAGE_SIZE / BLOCK, FirmwareUpdate_GetStats()->eraseStalls);
+    TEST_ASSERT_EQUAL_MEMORY(image, region, (CHUNKS - 1) * CHUNK);
+}
+
+void test_hash_mismatch_not_activated()
+{
+    char wrong[65];
+    memcpy(wrong, imageHash, sizeof(wrong));
+    wrong[0] = wrong[0] == '0' ? '1' : '0';
+
+    sendManifest(60, IMAGE_SIZE, wrong);
+    FirmwareUpdate_Poll();
+    for (uint16_t seq = 0; seq < CHUNKS; seq++)
+    {
+        sendChunk(60, seq);
+        FirmwareUpdate_Poll();
+    }
+    assertStatus("hash_mismatch");
+    TEST_ASSERT_FALSE(activated);
+    TEST_ASSERT_FALSE(FirmwareUpdate_IsPendingReboot());
+}
+
+void test_erase_failure_reported()
+{
+    sendManifest(70, IMAGE_SIZE, imageHash);
+    FirmwareUpdate_Poll();
+    sendChunk(70, 0);
+
+    failErase = true;
+    FirmwareUpdate_Poll();
+    assertStatus("erase_failed");
+
+    // The transfer is dropped, later chunks are not written
+    failErase = false;
+    sendChunk(70, 1);
+    TEST_ASSERT_EQUAL_UINT8(0xFF, region[CHUNK]);
+}
+
+void test_update_erases_ahead_and_activates()
+{
+    sendManifest(80, IMAGE_SIZE, imageHash);
+    assertStatus("erasing");
+    TEST_ASSERT_EQUAL_INT(0, eraseCalls);
+
+    // Only the first block is erased before the transfer
+    FirmwareUpdate_Poll();
+    assertStatus("armed");
+    TEST_ASSERT_EQUAL_INT(1, eraseCalls);
+    FirmwareUpdate_Poll();
+    TEST_ASSERT_EQUAL_INT(1, eraseCalls);
+
+    for (uint16_t seq = 0; seq < CHUNKS; seq++)
+    {
+        sendChunk(80, seq);
+        FirmwareUpdate_Poll();
+
+        // One block ahead of the write position, never the whole region
+        uint32_t written = (uint32_t)(seq + 1) * CHUNK;
+        uint32_t blocksNeeded = (written + BLOCK - 1) / BLOCK + 1;
+        uint32_t blocksInImage = (IMAGE_SIZE + BLOCK - 1) / BLOCK;
+        TEST_ASSERT_EQUAL_INT(blocksNeeded < blocksInImage ? blocksNeeded : blocksInImage, eraseCalls);
+    }
+
+    assertStatus("verified");
+    TEST_ASSERT_EQUAL_UINT32(0, FirmwareUpdate_GetStats()->eraseStalls);
+    TEST_ASSERT_EQUAL_UINT32(IMAGE_SIZE, FirmwareUpdate_GetStats()->bytesWritten);
+    TEST_ASSERT_EQUAL_MEMORY(image, region, IMAGE_SIZE);
+    TEST_ASSERT_TRUE(activated);
+    TEST_ASSERT_EQUAL_UINT32(IMAGE_SIZE, activatedSize);
+    TEST_ASSERT_TRUE(FirmwareUpdate_IsPendingReboot());
+
+    // Nothing else is accepted until the reboot
+    sendManifest(81, IMAGE_SIZE, imageHash);
+    assertStatus("verified");
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_host_sha256);
+    RUN_TEST(test_manifest_id_out_of_range_ignored);
+    RUN_TEST(test_manifest_checks);
+    RUN_TEST(test_chunks_refused_until_armed);
+    RUN_TEST(test_unpolled_writes_erase_inline);
+    RUN_TEST(test_hash_mismatch_not_activated);
+    RUN_TEST(test_erase_failure_reported);
+    // Last: a verified update latches until the reboot
+    RUN_TEST(test_update_erases_ahead_and_activates);
+    return UNITY_END();
+}
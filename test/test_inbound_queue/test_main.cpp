@@ -0,0 +1,170 @@
+/**
+ * @file test_main.cpp
+ * @brief InboundQueue FIFO order, pool limits, time budget and statistics
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "TopicRouter.h"
+#include "InboundQueue.h"
+
+static char received[INBOUND_POOL_SIZE * 2][32];
+static int receivedCount = 0;
+static uint32_t handlerCostMs = 0;
+
+static void record(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    if (receivedCount < (int)(sizeof(received) / sizeof(received[0])))
+        snprintf(received[receivedCount++], sizeof(received[0]), "%s=%.*s", topic, (int)length, (const char*)payload);
+    Host_Clock().ms += handlerCostMs;
+}
+
+static bool push(const char* topic, const char* payload)
+{
+    return InboundQueue_Push(topic, (const uint8_t*)payload, strlen(payload));
+}
+
+void setUp()
+{
+    Host_Clock().ms = 1000;
+    handlerCostMs = 0;
+    receivedCount = 0;
+    TopicRouter_Clear();
+    TopicRouter_Add("t/#", record);
+}
+
+void tearDown()
+{
+    // The queue has no reset; leave it empty for the next test
+    handlerCostMs = 0;
+    while (InboundQueue_Process(0) > 0) {}
+}
+
+void test_fifo_order_and_contents()
+{
+    TEST_ASSERT_TRUE(push("t/a", "1"));
+    TEST_ASSERT_TRUE(push("t/b", "22"));
+    TEST_ASSERT_TRUE(push("t/c", ""));
+    TEST_ASSERT_EQUAL_UINT8(3, InboundQueue_GetStats()->depth);
+
+    TEST_ASSERT_EQUAL_INT(3, InboundQueue_Process(100));
+    TEST_ASSERT_EQUAL_INT(3, receivedCount);
+    TEST_ASSERT_EQUAL_STRING("t/a=1", received[0]);
+    TEST_ASSERT_EQUAL_STRING("t/b=22", received[1]);
+    TEST_ASSERT_EQUAL_STRING("t/c=", received[2]);
+    TEST_ASSERT_EQUAL_UINT8(0, InboundQueue_GetStats()->depth);
+}
+
+void test_ring_wraps_around()
+{
+    // Offset the ring so the next batch straddles the end of the pool
+    push("t/x", "x");
+    InboundQueue_Process(100);
+    receivedCount = 0;
+
+    char topic[8];
+    for (int i = 0; i < INBOUND_POOL_SIZE; i++)
+    {
+        snprintf(topic, sizeof(topic), "t/%d", i);
+        TEST_ASSERT_TRUE(push(topic, "v"));
+    }
+    TEST_ASSERT_EQUAL_INT(INBOUND_POOL_SIZE, InboundQueue_Process(100));
+    for (int i = 0; i < INBOUND_POOL_SIZE; i++)
+    {
+        snprintf(topic, sizeof(topic), "t/%d=v", i);
+        TEST_ASSERT_EQUAL_STRING(topic, received[i]);
+    }
+}
+
+void test_full_pool_drops()
+{
+    uint32_t dropped = InboundQueue_GetStats()->dropped;
+    for (int i = 0; i < INBOUND_POOL_SIZE; i++)
+        TEST_ASSERT_TRUE(push("t/a", "1"));
+
+    TEST_ASSERT_FALSE(push("t/a", "1"));
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, InboundQueue_GetStats()->dropped);
+    TEST_ASSERT_EQUAL_UINT8(INBOUND_POOL_SIZE, InboundQueue_GetStats()->highWater);
+
+    // A slot is free again once a message has been handled
+    InboundQueue_Process(0);
+    TEST_ASSERT_TRUE(push("t/a", "1"));
+}
+
+void test_oversize_rejected()
+{
+    static uint8_t payload[INBOUND_SLOT_SIZE];
+    uint32_t oversize = InboundQueue_GetStats()->oversize;
+
+    // Topic, terminator and payload must fit one slot
+    TEST_ASSERT_FALSE(InboundQueue_Push("t/a", payload, INBOUND_SLOT_SIZE - 3));
+    TEST_ASSERT_EQUAL_UINT32(oversize + 1, InboundQueue_GetStats()->oversize);
+    TEST_ASSERT_TRUE(InboundQueue_Push("t/a", payload, INBOUND_SLOT_SIZE - 4));
+}
+
+void test_budget_limits_processing()
+{
+    push("t/a", "1");
+    push("t/b", "2");
+    push("t/c", "3");
+    handlerCostMs = 10;
+
+    // Stops once the budget is spent; the rest waits for the next call
+    TEST_ASSERT_EQUAL_INT(2, InboundQueue_Process(15));
+    TEST_ASSERT_EQUAL_UINT8(1, InboundQueue_GetStats()->depth);
+    TEST_ASSERT_EQUAL_INT(1, InboundQueue_Process(15));
+}
+
+void test_at_least_one_per_call()
+{
+    push("t/a", "1");
+    push("t/b", "2");
+    handlerCostMs = 50;
+    TEST_ASSERT_EQUAL_INT(1, InboundQueue_Process(0));
+    TEST_ASSERT_EQUAL_INT(1, InboundQueue_Process(0));
+    TEST_ASSERT_EQUAL_INT(0, InboundQueue_Process(0));
+}
+
+void test_unrouted_counted()
+{
+    uint32_t unrouted = InboundQueue_GetStats()->unrouted;
+    push("other", "1");
+    InboundQueue_Process(100);
+    TEST_ASSERT_EQUAL_UINT32(unrouted + 1, InboundQueue_GetStats()->unrouted);
+    TEST_ASSERT_EQUAL_INT(0, receivedCount);
+}
+
+void test_latency_tracked()
+{
+    push("t/a", "1");
+    Host_Clock().ms += 75;
+    InboundQueue_Process(100);
+    TEST_ASSERT_GREATER_OR_EQUAL(75, InboundQueue_GetStats()->maxLatencyMs);
+}
+
+void test_format_stats()
+{
+    char buf[256];
+    size_t len = InboundQueue_FormatStats(buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_EQUAL_size_t(strlen(buf), len);
+    TEST_ASSERT_EQUAL_UINT8('{', buf[0]);
+    TEST_ASSERT_EQUAL_UINT8('}', buf[len - 1]);
+
+    TEST_ASSERT_EQUAL_size_t(0, InboundQueue_FormatStats(buf, 16));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_order_and_contents);
+    RUN_TEST(test_ring_wraps_around);
+    RUN_TEST(test_full_pool_drops);
+    RUN_TEST(test_oversize_rejected);
+    RUN_TEST(test_budget_limits_processing);
+    RUN_TEST(test_at_least_one_per_call);
+    RUN_TEST(test_unrouted_counted);
+    RUN_TEST(test_latency_tracked);
+    RUN_TEST(test_format_stats);
+    return UNITY_END();
+}
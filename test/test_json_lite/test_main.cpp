@@ -0,0 +1,150 @@
+/**
+ * @file test_main.cpp
+ * @brief JsonLite member lookup, numbers, strings and raw values
+ */
+
+#include <string.h>
+#include <unity.h>
+#include "JsonLite.h"
+
+static bool getInt(const char* json, const char* key, long* value)
+{
+    return Json_GetInt(json, strlen(json), key, value);
+}
+
+static bool getString(const char* json, const char* key, char* out, size_t size)
+{
+    return Json_GetString(json, strlen(json), key, out, size);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_int_members()
+{
+    const char* json = "{\"id\":12, \"size\" : 412345 ,\"neg\":-7}";
+    long value = 0;
+    TEST_ASSERT_TRUE(getInt(json, "id", &value));
+    TEST_ASSERT_EQUAL_INT32(12, value);
+    TEST_ASSERT_TRUE(getInt(json, "size", &value));
+    TEST_ASSERT_EQUAL_INT32(412345, value);
+    TEST_ASSERT_TRUE(getInt(json, "neg", &value));
+    TEST_ASSERT_EQUAL_INT32(-7, value);
+    TEST_ASSERT_FALSE(getInt(json, "missing", &value));
+}
+
+void test_int_rejects_other_types()
+{
+    const char* json = "{\"s\":\"12\",\"f\":1.5,\"b\":true,\"o\":{\"x\":1}}";
+    long value = 0;
+    TEST_ASSERT_FALSE(getInt(json, "s", &value));
+    TEST_ASSERT_FALSE(getInt(json, "f", &value));
+    TEST_ASSERT_FALSE(getInt(json, "b", &value));
+    TEST_ASSERT_FALSE(getInt(json, "o", &value));
+}
+
+void test_float_members()
+{
+    const char* json = "{\"t\":21.5,\"i\":3,\"e\":-1e2}";
+    float value = 0;
+    TEST_ASSERT_TRUE(Json_GetFloat(json, strlen(json), "t", &value));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.5f, value);
+    TEST_ASSERT_TRUE(Json_GetFloat(json, strlen(json), "i", &value));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.0f, value);
+    TEST_ASSERT_TRUE(Json_GetFloat(json, strlen(json), "e", &value));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -100.0f, value);
+}
+
+void test_string_members_and_escapes()
+{
+    const char* json = "{\"a\":\"plain\",\"b\":\"say \\\"hi\\\" \\\\ \\n\",\"c\":\"\"}";
+    char out[32];
+    TEST_ASSERT_TRUE(getString(json, "a", out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("plain", out);
+    // \" and \\ are unescaped, other escapes are kept as written
+    TEST_ASSERT_TRUE(getString(json, "b", out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("say \"hi\" \\ \\n", out);
+    TEST_ASSERT_TRUE(getString(json, "c", out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("", out);
+}
+
+void test_string_too_long_or_wrong_type()
+{
+    const char* json = "{\"a\":\"abcdef\",\"n\":5}";
+    char out[6];
+    TEST_ASSERT_FALSE(getString(json, "a", out, sizeof(out)));
+    TEST_ASSERT_FALSE(getString(json, "n", out, sizeof(out)));
+    char fits[7];
+    TEST_ASSERT_TRUE(getString(json, "a", fits, sizeof(fits)));
+}
+
+void test_nested_values_skipped()
+{
+    const char* json = "{\"o\":{\"id\":1,\"s\":\"}\"},\"a\":[1,{\"id\":2}],\"id\":3}";
+    long value = 0;
+    // Only top-level members match
+    TEST_ASSERT_TRUE(getInt(json, "id", &value));
+    TEST_ASSERT_EQUAL_INT32(3, value);
+
+    size_t len = 0;
+    const char* raw = Json_GetRaw(json, strlen(json), "a", &len);
+    TEST_ASSERT_NOT_NULL(raw);
+    TEST_ASSERT_EQUAL_size_t(strlen("[1,{\"id\":2}]"), len);
+    TEST_ASSERT_EQUAL_MEMORY("[1,{\"id\":2}]", raw, len);
+
+    raw = Json_GetRaw(json, strlen(json), "o", &len);
+    TEST_ASSERT_NOT_NULL(raw);
+    TEST_ASSERT_EQUAL_MEMORY("{\"id\":1,\"s\":\"}\"}", raw, len);
+}
+
+void test_key_must_match_whole_name()
+{
+    const char* json = "{\"idx\":1,\"xid\":2,\"id\":3}";
+    long value = 0;
+    TEST_ASSERT_TRUE(getInt(json, "id", &value));
+    TEST_ASSERT_EQUAL_INT32(3, value);
+}
+
+void test_length_bounds_the_input()
+{
+    // Not NUL-terminated after the object; the length ends the search
+    const char* json = "{\"a\":1}{\"b\":2}";
+    long value = 0;
+    TEST_ASSERT_TRUE(Json_GetInt(json, 7, "a", &value));
+    TEST_ASSERT_FALSE(Json_GetInt(json, 7, "b", &value));
+
+    // A number cut off by the length is read only up to it
+    TEST_ASSERT_TRUE(Json_GetInt("{\"a\":123}", 7, "a", &value));
+    TEST_ASSERT_EQUAL_INT32(12, value);
+}
+
+void test_malformed_input()
+{
+    long value = 0;
+    TEST_ASSERT_FALSE(getInt("", "a", &value));
+    TEST_ASSERT_FALSE(getInt("[1,2]", "a", &value));
+    TEST_ASSERT_FALSE(getInt("{a:1}", "a", &value));
+    TEST_ASSERT_FALSE(getInt("{\"a\" 1}", "a", &value));
+    TEST_ASSERT_FALSE(getInt("{\"a\":", "a", &value));
+    TEST_ASSERT_FALSE(getInt("{\"x\":\"unterminated", "a", &value));
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_int_members);
+    RUN_TEST(test_int_rejects_other_types);
+    RUN_TEST(test_float_members);
+    RUN_TEST(test_string_members_and_escapes);
+    RUN_TEST(test_string_too_long_or_wrong_type);
+    RUN_TEST(test_nested_values_skipped);
+    RUN_TEST(test_key_must_match_whole_name);
+    RUN_TEST(test_length_bounds_the_input);
+    RUN_TEST(test_malformed_input);
+    return UNITY_END();
+}
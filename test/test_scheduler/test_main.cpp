@@ -0,0 +1,203 @@
+/**
+ * @file test_main.cpp
+ * @brief Scheduler deadline order, periods, rescheduling and clock wrap
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "Scheduler.h"
+
+struct Probe
+{
+    char name;
+    uint32_t costUs;            // added to the clock on each run
+    uint32_t retryMs;           // if set, the task reschedules itself
+    int runningId;              // Scheduler_Running() seen during the run
+};
+
+static uint32_t now = 0;
+static char order[32];
+static bool recording = true;
+
+static uint32_t virtualClock()
+{
+    return now;
+}
+
+static void record(void* context)
+{
+    if (!recording) return;
+
+    Probe* p = (Probe*)context;
+    size_t n = strlen(order);
+    if (n + 1 < sizeof(order))
+    {
+        order[n] = p->name;
+        order[n + 1] = '\0';
+    }
+    p->runningId = Scheduler_Running();
+    Host_Clock().us += p->costUs;
+    if (p->retryMs) Scheduler_RunIn(p->runningId, p->retryMs);
+}
+
+static int add(Probe* probe, uint32_t periodMs, uint32_t firstDelayMs)
+{
+    int id = Scheduler_Add("probe", record, probe, periodMs, firstDelayMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, id);
+    return id;
+}
+
+void setUp()
+{
+    now = 1000;
+    order[0] = '\0';
+    Scheduler_SetClock(virtualClock);
+}
+
+void tearDown()
+{
+    // Tasks cannot be removed; turn every one into a one-shot and let it
+    // run out so nothing fires in the next test
+    recording = false;
+    for (int i = 0; i < Scheduler_Count(); i++)
+        Scheduler_SetPeriod(i, 0);
+    Scheduler_RunDue();
+    recording = true;
+}
+
+void test_runs_in_deadline_order()
+{
+    static Probe a = { 'A', 0, 0, -1 }, b = { 'B', 300, 0, -1 }, c = { 'C', 50, 0, -1 };
+    add(&a, 0, 30);
+    int idB = add(&b, 0, 10);
+    add(&c, 0, 20);
+
+    now += 9;
+    TEST_ASSERT_EQUAL_UINT32(1, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_STRING("", order);
+
+    now += 21;
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_STRING("BCA", order);
+    TEST_ASSERT_EQUAL_INT(idB, b.runningId);
+    TEST_ASSERT_EQUAL_INT(-1, Scheduler_Running());
+    TEST_ASSERT_EQUAL_INT(idB, Scheduler_LastSlowest());
+    TEST_ASSERT_EQUAL_UINT32(300, Scheduler_GetInfo(idB)->maxRunUs);
+
+    // One-shot tasks do not run again on their own
+    now += 1000;
+    Scheduler_RunDue();
+    TEST_ASSERT_EQUAL_STRING("BCA", order);
+    TEST_ASSERT_EQUAL_INT(-1, Scheduler_LastSlowest());
+}
+
+void test_periodic_keeps_phase()
+{
+    static Probe p = { 'P', 0, 0, -1 };
+    int id = add(&p, 100, 100);
+
+    now += 100;
+    TEST_ASSERT_EQUAL_UINT32(100, Scheduler_RunDue());
+
+    // A late run does not shift the following deadlines
+    now += 150;
+    TEST_ASSERT_EQUAL_UINT32(50, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_UINT32(50, Scheduler_GetInfo(id)->maxLateMs);
+    TEST_ASSERT_EQUAL_UINT64(1300, Scheduler_GetInfo(id)->deadline);
+
+    // Periods missed entirely are skipped rather than run back to back
+    now += 450;
+    TEST_ASSERT_EQUAL_UINT32(100, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_STRING("PPP", order);
+    TEST_ASSERT_EQUAL_UINT32(3, Scheduler_GetInfo(id)->runs);
+}
+
+void test_task_reschedules_itself()
+{
+    static Probe p = { 'R', 0, 500, -1 };
+    int id = add(&p, 100, 100);
+
+    now += 100;
+    // The task's own RunIn() replaces its period for this run
+    TEST_ASSERT_EQUAL_UINT32(500, Scheduler_RunDue());
+    now += 499;
+    Scheduler_RunDue();
+    TEST_ASSERT_EQUAL_STRING("R", order);
+    now += 1;
+    Scheduler_RunDue();
+    TEST_ASSERT_EQUAL_STRING("RR", order);
+    TEST_ASSERT_EQUAL_UINT32(2, Scheduler_GetInfo(id)->runs);
+}
+
+void test_run_in_and_set_period()
+{
+    static Probe p = { 'S', 0, 0, -1 };
+    int id = add(&p, 1000, 1000);
+
+    // Pulled forward from outside the task
+    Scheduler_RunIn(id, 10);
+    now += 10;
+    TEST_ASSERT_EQUAL_UINT32(1000, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_STRING("S", order);
+
+    Scheduler_SetPeriod(id, 200);
+    TEST_ASSERT_EQUAL_UINT32(200, Scheduler_RunDue());
+    now += 200;
+    TEST_ASSERT_EQUAL_UINT32(200, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_STRING("SS", order);
+
+    // Ids out of range are ignored
+    Scheduler_RunIn(-1, 0);
+    Scheduler_SetPeriod(SCHEDULER_MAX_TASKS, 0);
+    TEST_ASSERT_NULL(Scheduler_GetInfo(-1));
+}
+
+void test_deadlines_across_clock_wrap()
+{
+    now = 0xFFFFFFFFu - 49;
+    Scheduler_SetClock(virtualClock);
+
+    static Probe a = { 'A', 0, 0, -1 }, b = { 'B', 0, 0, -1 };
+    add(&b, 0, 80);
+    int idA = add(&a, 100, 20);
+
+    now += 20;
+    TEST_ASSERT_EQUAL_UINT32(60, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_STRING("A", order);
+
+    // The raw clock wraps to a small value; B is still due after A
+    now += 60;
+    TEST_ASSERT_TRUE(now < 100);
+    TEST_ASSERT_EQUAL_UINT32(40, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_STRING("AB", order);
+    TEST_ASSERT_TRUE(Scheduler_Now() > 0xFFFFFFFFu);
+
+    now += 40;
+    TEST_ASSERT_EQUAL_UINT32(100, Scheduler_RunDue());
+    TEST_ASSERT_EQUAL_STRING("ABA", order);
+    TEST_ASSERT_EQUAL_UINT32(0, Scheduler_GetInfo(idA)->maxLateMs);
+}
+
+void test_table_full()
+{
+    static Probe p = { 'F', 0, 0, -1 };
+    TEST_ASSERT_EQUAL_INT(-1, Scheduler_Add("null", NULL, NULL, 0, 0));
+
+    while (Scheduler_Count() < SCHEDULER_MAX_TASKS)
+        add(&p, 0, 0);
+    TEST_ASSERT_EQUAL_INT(-1, Scheduler_Add("extra", record, &p, 0, 0));
+    TEST_ASSERT_EQUAL_INT(SCHEDULER_MAX_TASKS, Scheduler_Count());
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_runs_in_deadline_order);
+    RUN_TEST(test_periodic_keeps_phase);
+    RUN_TEST(test_task_reschedules_itself);
+    RUN_TEST(test_run_in_and_set_period);
+    RUN_TEST(test_deadlines_across_clock_wrap);
+    // Fills the task table, so it runs last
+    RUN_TEST(test_table_full);
+    return UNITY_END();
+}
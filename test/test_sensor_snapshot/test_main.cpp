@@ -0,0 +1,154 @@
+/**
+ * @file test_main.cpp
+ * @brief SensorSnapshot parsing of partial sets and torn-read protection
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <thread>
+#include "RemoteConfig.h"
+#include "SensorSnapshot.h"
+
+static bool parse(const char* json, SensorReadings* r)
+{
+    return SensorSnapshot_Parse(json, strlen(json), r);
+}
+
+/**
+ * A set whose every field holds n, so a torn copy shows as a mismatch
+ */
+static void fill(SensorReadings* r, uint32_t n)
+{
+    r->takenAt = n;
+    r->sample = n;
+    r->temperature = r->humidity = r->pressure = (float)n;
+    for (int i = 0; i < 3; i++)
+        r->accel[i] = r->gyro[i] = r->mag[i] = (int32_t)n;
+    r->present = n;
+}
+
+static bool consistent(const SensorReadings* r)
+{
+    uint32_t n = r->sample;
+    bool same = r->takenAt == n && r->present == n &&
+        r->temperature == (float)n && r->humidity == (float)n && r->pressure == (float)n;
+    for (int i = 0; i < 3; i++)
+        same = same && r->accel[i] == (int32_t)n && r->gyro[i] == (int32_t)n && r->mag[i] == (int32_t)n;
+    return same;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_read_before_first_write()
+{
+    // Runs first: nothing has been written yet
+    SensorReadings r;
+    TEST_ASSERT_FALSE(SensorSnapshot_Read(&r));
+}
+
+void test_parse_full_set()
+{
+    SensorReadings r;
+    TEST_ASSERT_TRUE(parse("{\"temperature\":21.50,\"humidity\":40.25,\"pressure\":1013.00,"
+        "\"accelerometer\":{\"x\":1,\"y\":-2,\"z\":1000},\"gyroscope\":{\"x\":3,\"y\":4,\"z\":5},"
+        "\"magnetometer\":{\"x\":-6,\"y\":7,\"z\":8}}", &r));
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_MASK_ALL, r.present);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.5f, r.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 40.25f, r.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1013.0f, r.pressure);
+    TEST_ASSERT_EQUAL_INT32(-2, r.accel[1]);
+    TEST_ASSERT_EQUAL_INT32(1000, r.accel[2]);
+    TEST_ASSERT_EQUAL_INT32(5, r.gyro[2]);
+    TEST_ASSERT_EQUAL_INT32(-6, r.mag[0]);
+}
+
+void test_parse_partial_set()
+{
+    SensorReadings r;
+    TEST_ASSERT_TRUE(parse("{\"humidity\":40,\"gyroscope\":{\"x\":3,\"y\":4,\"z\":5}}", &r));
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_HUMIDITY | SENSOR_GYROSCOPE, r.present);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 40.0f, r.humidity);
+    TEST_ASSERT_EQUAL_INT32(4, r.gyro[1]);
+}
+
+void test_parse_skips_malformed_groups()
+{
+    SensorReadings r;
+    fill(&r, 9);
+    // A motion group missing an axis is left out and left untouched
+    TEST_ASSERT_TRUE(parse("{\"temperature\":\"warm\",\"pressure\":990,"
+        "\"accelerometer\":{\"x\":1,\"y\":2},\"magnetometer\":[1,2,3]}", &r));
+    TEST_ASSERT_EQUAL_UINT32(SENSOR_PRESSURE, r.present);
+    TEST_ASSERT_EQUAL_INT32(9, r.accel[0]);
+}
+
+void test_parse_nothing_read()
+{
+    SensorReadings r;
+    TEST_ASSERT_FALSE(parse("{}", &r));
+    TEST_ASSERT_FALSE(parse("{\"other\":1}", &r));
+    TEST_ASSERT_FALSE(parse("", &r));
+    TEST_ASSERT_EQUAL_UINT32(0, r.present);
+}
+
+void test_write_then_read()
+{
+    SensorReadings in, out;
+    fill(&in, 42);
+    uint32_t writes = SensorSnapshot_GetStats()->writes;
+    uint32_t reads = SensorSnapshot_GetStats()->reads;
+
+    SensorSnapshot_Write(&in);
+    TEST_ASSERT_TRUE(SensorSnapshot_Read(&out));
+    TEST_ASSERT_EQUAL_MEMORY(&in, &out, sizeof(in));
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, SensorSnapshot_GetStats()->writes);
+    TEST_ASSERT_EQUAL_UINT32(reads + 1, SensorSnapshot_GetStats()->reads);
+}
+
+void test_no_torn_reads_under_concurrent_writes()
+{
+    static volatile bool stop = false;
+    std::thread writer([]() {
+        SensorReadings r;
+        for (uint32_t n = 1; !stop; n++)
+        {
+            fill(&r, n);
+            SensorSnapshot_Write(&r);
+        }
+    });
+
+    int torn = 0;
+    uint32_t last = 0, backwards = 0;
+    for (int i = 0; i < 200000; i++)
+    {
+        SensorReadings r;
+        SensorSnapshot_Read(&r);
+        if (!consistent(&r)) torn++;
+        if (r.sample < last) backwards++;
+        last = r.sample;
+    }
+    stop = true;
+    writer.join();
+
+    TEST_ASSERT_EQUAL_INT(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(0, backwards);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_read_before_first_write);
+    RUN_TEST(test_parse_full_set);
+    RUN_TEST(test_parse_partial_set);
+    RUN_TEST(test_parse_skips_malformed_groups);
+    RUN_TEST(test_parse_nothing_read);
+    RUN_TEST(test_write_then_read);
+    RUN_TEST(test_no_torn_reads_under_concurrent_writes);
+    return UNITY_END();
+}
@@ -0,0 +1,210 @@
+/**
+ * @file test_main.cpp
+ * @brief Shadow desired updates, coalesced reports and report splitting
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "Shadow.h"
+
+#define NAME_70 "property_with_a_long_name_that_takes_up_a_quarter_of_the_report_buffer"
+
+// Longer than any report can hold
+static char hugeName[SHADOW_REPORT_MAX + 16];
+
+static const char* const names[] = {
+    "count", NAME_70 "_1", NAME_70 "_2", NAME_70 "_3", NAME_70 "_4", hugeName, "flag", "ratio"
+};
+#define PROPERTIES (int)(sizeof(names) / sizeof(names[0]))
+#define OVERSIZE 5
+#define RATIO 7
+
+static char messages[8][SHADOW_REPORT_MAX];
+static int messageCount;
+static bool publishFails;
+
+static bool record(const char* json)
+{
+    if (publishFails) return false;
+    if (messageCount < 8)
+        snprintf(messages[messageCount], sizeof(messages[0]), "%s", json);
+    messageCount++;
+    return true;
+}
+
+static bool acceptValue(int index, ShadowValue value)
+{
+    return true;
+}
+
+static bool rejectValue(int index, ShadowValue value)
+{
+    return false;
+}
+
+/**
+ * Let SHADOW_REPORT_MIN_MS pass, then poll until nothing more is sent
+ */
+static void pollAll()
+{
+    Host_Clock().ms += SHADOW_REPORT_MIN_MS;
+    messageCount = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        int before = messageCount;
+        Shadow_Poll();
+        if (messageCount == before) break;
+    }
+}
+
+/**
+ * Number of messages in which property name is reported
+ */
+static int reportsOf(const char* name)
+{
+    char key[SHADOW_REPORT_MAX + 32];
+    snprintf(key, sizeof(key), "\"%s\":", name);
+    int found = 0;
+    for (int i = 0; i < messageCount && i < 8; i++)
+        if (strstr(messages[i], key)) found++;
+    return found;
+}
+
+static void deliverDesired(const char* json)
+{
+    Shadow_OnDesired("shadow", (const uint8_t*)json, (unsigned int)strlen(json), NULL);
+}
+
+void setUp()
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        memset(hugeName, 'x', sizeof(hugeName) - 1);
+        Shadow_Init(record);
+        ShadowValue v = {};
+        for (int i = 0; i < PROPERTIES; i++)
+        {
+            ShadowType type = i == RATIO ? SHADOW_FLOAT : (i == 6 ? SHADOW_BOOL : SHADOW_INT);
+            ShadowApplyFn apply = i == 0 ? acceptValue : (i == RATIO ? rejectValue : NULL);
+            TEST_ASSERT_EQUAL_INT(i, Shadow_Define(names[i], type, v, apply));
+        }
+        initialized = true;
+    }
+    publishFails = false;
+}
+
+void tearDown()
+{
+}
+
+void test_first_report_split_across_messages()
+{
+    pollAll();
+
+    // Four long names cannot share one message with the rest
+    TEST_ASSERT_GREATER_THAN(1, messageCount);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)messageCount, Shadow_GetStats()->reports);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)messageCount - 1, Shadow_GetStats()->splits);
+    for (int i = 0; i < messageCount; i++)
+    {
+        TEST_ASSERT_LESS_THAN(SHADOW_REPORT_MAX, (int)strlen(messages[i]));
+        char version[32];
+        snprintf(version, sizeof(version), "{\"version\":%d,", i + 1);
+        TEST_ASSERT_EQUAL_INT(0, strncmp(messages[i], version, strlen(version)));
+    }
+
+    // Every property is reported exactly once, except the one that cannot fit
+    for (int i = 0; i < PROPERTIES; i++)
+        TEST_ASSERT_EQUAL_INT(i == OVERSIZE ? 0 : 1, reportsOf(names[i]));
+    TEST_ASSERT_EQUAL_UINT32(1, Shadow_GetStats()->dropped);
+
+    // Nothing is left pending
+    pollAll();
+    TEST_ASSERT_EQUAL_INT(0, messageCount);
+}
+
+void test_changes_coalesced_and_rate_limited()
+{
+    ShadowValue v;
+    v.i = 4;
+    Shadow_SetReported(0, v);
+    pollAll();
+    TEST_ASSERT_EQUAL_INT(1, messageCount);
+
+    // Changes too soon after that report wait, then go out together
+    v.i = 5;
+    Shadow_SetReported(0, v);
+    v.b = true;
+    Shadow_SetReported(6, v);
+    messageCount = 0;
+    Host_Clock().ms += SHADOW_REPORT_MIN_MS - 1;
+    Shadow_Poll();
+    TEST_ASSERT_EQUAL_INT(0, messageCount);
+
+    pollAll();
+    TEST_ASSERT_EQUAL_INT(1, messageCount);
+    TEST_ASSERT_NOT_NULL(strstr(messages[0], "\"state\":{\"count\":5,\"flag\":true}}"));
+
+    // Setting the same value again is not a change
+    v.i = 5;
+    Shadow_SetReported(0, v);
+    pollAll();
+    TEST_ASSERT_EQUAL_INT(0, messageCount);
+}
+
+void test_desired_applied_or_rejected()
+{
+    deliverDesired("{\"version\":3,\"state\":{\"count\":7,\"ratio\":2.5}}");
+    TEST_ASSERT_EQUAL_INT(7, Shadow_GetReported(0).i);
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, Shadow_GetDesired(RATIO).f);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, Shadow_GetReported(RATIO).f);
+
+    // The rejected value is answered with the one in effect
+    pollAll();
+    TEST_ASSERT_EQUAL_INT(1, messageCount);
+    TEST_ASSERT_NOT_NULL(strstr(messages[0], "\"desiredVersion\":3,"));
+    TEST_ASSERT_NOT_NULL(strstr(messages[0], "\"count\":7"));
+    TEST_ASSERT_NOT_NULL(strstr(messages[0], "\"ratio\":0.00"));
+
+    deliverDesired("{\"version\":3,\"state\":{\"count\":9}}");
+    TEST_ASSERT_EQUAL_INT(7, Shadow_GetReported(0).i);
+}
+
+void test_failed_publish_keeps_changes()
+{
+    ShadowValue v;
+    v.i = 11;
+    Shadow_SetReported(0, v);
+
+    publishFails = true;
+    pollAll();
+    TEST_ASSERT_EQUAL_INT(0, messageCount);
+
+    publishFails = false;
+    pollAll();
+    TEST_ASSERT_EQUAL_INT(1, messageCount);
+    TEST_ASSERT_NOT_NULL(strstr(messages[0], "\"count\":11"));
+}
+
+void test_mark_all_dirty_reports_everything_again()
+{
+    uint32_t dropped = Shadow_GetStats()->dropped;
+    Shadow_MarkAllDirty();
+    pollAll();
+
+    for (int i = 0; i < PROPERTIES; i++)
+        TEST_ASSERT_EQUAL_INT(i == OVERSIZE ? 0 : 1, reportsOf(names[i]));
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, Shadow_GetStats()->dropped);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_report_split_across_messages);
+    RUN_TEST(test_changes_coalesced_and_rate_limited);
+    RUN_TEST(test_desired_applied_or_rejected);
+    RUN_TEST(test_failed_publish_keeps_changes);
+    RUN_TEST(test_mark_all_dirty_reports_everything_again);
+    return UNITY_END();
+}
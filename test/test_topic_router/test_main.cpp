@@ -0,0 +1,316 @@
+/**
+ * @file test_main.cpp
+ * @brief TopicRouter wildcard matching and SUBSCRIBE encoding
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "TopicRouter.h"
+
+// Handler ids in call order, as a string ("ABC")
+static char calls[32];
+
+static void record(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    size_t n = strlen(calls);
+    if (n + 1 < sizeof(calls))
+    {
+        calls[n] = *(const char*)context;
+        calls[n + 1] = '\0';
+    }
+}
+
+/**
+ * Dispatch topic and return the handler ids called, sorted
+ */
+static const char* dispatch(const char* topic)
+{
+    calls[0] = '\0';
+    int count = TopicRouter_Dispatch(topic, (const uint8_t*)"x", 1);
+    TEST_ASSERT_EQUAL_INT((int)strlen(calls), count);
+
+    // Call order follows the trie walk; tests only care about the set
+    for (size_t i = 1; calls[i]; i++)
+    {
+        for (size_t j = i; j > 0 && calls[j - 1] > calls[j]; j--)
+        {
+            char t = calls[j];
+            calls[j] = calls[j - 1];
+            calls[j - 1] = t;
+        }
+    }
+    return calls;
+}
+
+static void add(const char* pattern, const char* id)
+{
+    TEST_ASSERT_TRUE(TopicRouter_Add(pattern, record, (void*)id));
+}
+
+void setUp()
+{
+    TopicRouter_Clear();
+}
+
+void tearDown()
+{
+}
+
+void test_exact_match()
+{
+    add("home/kitchen/temp", "A");
+    add("home/kitchen", "B");
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("home/kitchen/temp"));
+    TEST_ASSERT_EQUAL_STRING("B", dispatch("home/kitchen"));
+    TEST_ASSERT_EQUAL_STRING("", dispatch("home"));
+    TEST_ASSERT_EQUAL_STRING("", dispatch("home/kitchen/temp/x"));
+    TEST_ASSERT_EQUAL_STRING("", dispatch("home/kitchen/tem"));
+}
+
+void test_plus_matches_one_level()
+{
+    add("home/+/temp", "A");
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("home/kitchen/temp"));
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("home/hall/temp"));
+    TEST_ASSERT_EQUAL_STRING("", dispatch("home/temp"));
+    TEST_ASSERT_EQUAL_STRING("", dispatch("home/a/b/temp"));
+}
+
+void test_plus_matches_empty_level()
+{
+    add("a/+", "A");
+    add("+/b", "B");
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("a/"));
+    TEST_ASSERT_EQUAL_STRING("B", dispatch("/b"));
+    TEST_ASSERT_EQUAL_STRING("", dispatch("a"));
+}
+
+void test_hash_matches_remaining_levels()
+{
+    add("home/#", "A");
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("home/kitchen"));
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("home/kitchen/temp/now"));
+    // "home/#" also matches the parent level itself
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("home"));
+    TEST_ASSERT_EQUAL_STRING("", dispatch("homes/kitchen"));
+}
+
+void test_hash_alone_matches_everything()
+{
+    add("#", "A");
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("a"));
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("a/b/c"));
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("/"));
+}
+
+void test_dollar_topics_skip_first_level_wildcards()
+{
+    add("#", "A");
+    add("+/broker", "B");
+    add("$SYS/#", "C");
+    add("$SYS/+", "D");
+    TEST_ASSERT_EQUAL_STRING("CD", dispatch("$SYS/broker"));
+    TEST_ASSERT_EQUAL_STRING("AB", dispatch("SYS/broker"));
+}
+
+void test_overlapping_patterns_all_called()
+{
+    add("a/b/c", "A");
+    add("a/+/c", "B");
+    add("a/#", "C");
+    add("+/+/+", "D");
+    add("a/b/#", "E");
+    add("#", "F");
+    TEST_ASSERT_EQUAL_STRING("ABCDEF", dispatch("a/b/c"));
+    TEST_ASSERT_EQUAL_STRING("BCDF", dispatch("a/x/c"));
+    TEST_ASSERT_EQUAL_STRING("CEF", dispatch("a/b"));
+    TEST_ASSERT_EQUAL_STRING("F", dispatch("b"));
+}
+
+void test_reregister_replaces_handler()
+{
+    add("a/b", "A");
+    add("a/b", "B");
+    TEST_ASSERT_EQUAL_INT(1, TopicRouter_Count());
+    TEST_ASSERT_EQUAL_STRING("B", dispatch("a/b"));
+}
+
+void test_malformed_patterns_rejected()
+{
+    TEST_ASSERT_FALSE(TopicRouter_Add("a/#/b", record, (void*)"A"));
+    TEST_ASSERT_FALSE(TopicRouter_Add("a+/b", record, (void*)"A"));
+    TEST_ASSERT_FALSE(TopicRouter_Add("a/b#", record, (void*)"A"));
+    TEST_ASSERT_FALSE(TopicRouter_Add("", record, (void*)"A"));
+    TEST_ASSERT_FALSE(TopicRouter_Add(NULL, record, (void*)"A"));
+    TEST_ASSERT_FALSE(TopicRouter_Add("a", NULL));
+    TEST_ASSERT_EQUAL_INT(0, TopicRouter_Count());
+}
+
+void test_node_pool_exhaustion()
+{
+    // Patterns are referenced, not copied, so they must outlive the test
+    static char patterns[TOPIC_ROUTER_MAX_NODES][8];
+    int added = 0;
+    for (int i = 0; i < TOPIC_ROUTER_MAX_NODES; i++)
+    {
+        snprintf(patterns[i], sizeof(patterns[i]), "t%d", i);
+        if (!TopicRouter_Add(patterns[i], record, (void*)"A")) break;
+        added++;
+    }
+    // The root takes one node
+    TEST_ASSERT_EQUAL_INT(TOPIC_ROUTER_MAX_NODES - 1 < TOPIC_ROUTER_MAX_HANDLERS ?
+        TOPIC_ROUTER_MAX_NODES - 1 : TOPIC_ROUTER_MAX_HANDLERS, added);
+    TEST_ASSERT_EQUAL_STRING("A", dispatch("t0"));
+}
+
+// Sibling levels under one parent, leaving room for the root, "dev", "+"
+// and the "dev/+" handler; several hundred with the native env's pool sizes
+#define FANOUT ((TOPIC_ROUTER_MAX_NODES - 3) < (TOPIC_ROUTER_MAX_HANDLERS - 1) ? \
+    (TOPIC_ROUTER_MAX_NODES - 3) : (TOPIC_ROUTER_MAX_HANDLERS - 1))
+
+static char fanoutPatterns[FANOUT][16];
+static int fanoutHits[FANOUT];
+
+static void count(const char* topic, const uint8_t* payload, unsigned int length, void* context)
+{
+    (*(int*)context)++;
+}
+
+/**
+ * Register "dev/0" .. "dev/<n-1>" plus "dev/+"
+ */
+static void addFanout(int n, int* wildcardHits)
+{
+    for (int i = 0; i < n; i++)
+    {
+        snprintf(fanoutPatterns[i], sizeof(fanoutPatterns[i]), "dev/%d", i);
+        fanoutHits[i] = 0;
+        TEST_ASSERT_TRUE(TopicRouter_Add(fanoutPatterns[i], count, &fanoutHits[i]));
+    }
+    TEST_ASSERT_TRUE(TopicRouter_Add("dev/+", count, wildcardHits));
+}
+
+/**
+ * Average time of one dispatch of topic, in nanoseconds
+ */
+static double timeDispatch(const char* topic, int rounds)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+        TopicRouter_Dispatch(topic, (const uint8_t*)"x", 1);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds;
+}
+
+void test_wide_fanout_dispatch()
+{
+    int wildcardHits = 0;
+    addFanout(FANOUT, &wildcardHits);
+    TEST_ASSERT_EQUAL_INT(FANOUT + 1, TopicRouter_Count());
+
+    for (int i = 0; i < FANOUT; i++)
+        TEST_ASSERT_EQUAL_INT(2, TopicRouter_Dispatch(fanoutPatterns[i], (const uint8_t*)"x", 1));
+    for (int i = 0; i < FANOUT; i++)
+        TEST_ASSERT_EQUAL_INT(1, fanoutHits[i]);
+    TEST_ASSERT_EQUAL_INT(FANOUT, wildcardHits);
+
+    // Unregistered siblings only reach the wildcard
+    TEST_ASSERT_EQUAL_INT(1, TopicRouter_Dispatch("dev/x", (const uint8_t*)"x", 1));
+    TEST_ASSERT_EQUAL_INT(0, TopicRouter_Dispatch("other/0", (const uint8_t*)"x", 1));
+}
+
+void test_fanout_does_not_slow_dispatch()
+{
+    // Benchmark: the first sibling registered, with FANOUT - 1 added after
+    // it, costs about the same as the only child. A linear sibling scan is roughly
+    // FANOUT times slower here, far outside the margin.
+    const int rounds = 200000;
+    int wildcardHits = 0;
+
+    addFanout(1, &wildcardHits);
+    double narrow = timeDispatch("dev/0", rounds);
+
+    TopicRouter_Clear();
+    addFanout(FANOUT, &wildcardHits);
+    double wide = timeDispatch("dev/0", rounds);
+
+    printf("dispatch: %.0f ns with 1 sibling, %.0f ns with %d\n", narrow, wide, FANOUT);
+    TEST_ASSERT_TRUE(wide < narrow * 4 + 50);
+}
+
+void test_build_subscribe_packet()
+{
+    add("a/b", "A");
+    add("c/#", "B");
+
+    uint8_t buf[64];
+    int next = 0;
+    size_t len = TopicRouter_BuildSubscribe(buf, sizeof(buf), 0x1234, 1, &next);
+
+    const uint8_t expected[] = {
+        0x82, 14,                       // SUBSCRIBE, remaining length
+        0x12, 0x34,                     // packet id
+        0, 3, 'a', '/', 'b', 1,
+        0, 3, 'c', '/', '#', 1
+    };
+    TEST_ASSERT_EQUAL_size_t(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buf, sizeof(expected));
+    TEST_ASSERT_EQUAL_INT(2, next);
+    TEST_ASSERT_EQUAL_size_t(0, TopicRouter_BuildSubscribe(buf, sizeof(buf), 1, 1, &next));
+}
+
+void test_build_subscribe_splits_when_full()
+{
+    add("a/b", "A");
+    add("c/d", "B");
+
+    // Room for the headers and one filter only
+    uint8_t buf[5 + 2 + 6];
+    int next = 0;
+    size_t len = TopicRouter_BuildSubscribe(buf, sizeof(buf), 1, 0, &next);
+    TEST_ASSERT_EQUAL_size_t(2 + 2 + 6, len);
+    TEST_ASSERT_EQUAL_INT(1, next);
+
+    len = TopicRouter_BuildSubscribe(buf, sizeof(buf), 2, 0, &next);
+    TEST_ASSERT_EQUAL_size_t(2 + 2 + 6, len);
+    TEST_ASSERT_EQUAL_UINT8('c', buf[6]);
+    TEST_ASSERT_EQUAL_INT(2, next);
+}
+
+void test_build_subscribe_long_remaining_length()
+{
+    static char pattern[200];
+    memset(pattern, 'x', sizeof(pattern) - 1);
+    add(pattern, "A");
+
+    uint8_t buf[256];
+    int next = 0;
+    size_t len = TopicRouter_BuildSubscribe(buf, sizeof(buf), 1, 0, &next);
+    // 2 + 2 + 199 + 1 = 204 needs two length bytes
+    TEST_ASSERT_EQUAL_size_t(1 + 2 + 204, len);
+    TEST_ASSERT_EQUAL_UINT8(0x80 | (204 % 128), buf[1]);
+    TEST_ASSERT_EQUAL_UINT8(204 / 128, buf[2]);
+}
+
+int main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_exact_match);
+    RUN_TEST(test_plus_matches_one_level);
+    RUN_TEST(test_plus_matches_empty_level);
+    RUN_TEST(test_hash_matches_remaining_levels);
+    RUN_TEST(test_hash_alone_matches_everything);
+    RUN_TEST(test_dollar_topics_skip_first_level_wildcards);
+    RUN_TEST(test_overlapping_patterns_all_called);
+    RUN_TEST(test_reregister_replaces_handler);
+    RUN_TEST(test_malformed_patterns_rejected);
+    RUN_TEST(test_node_pool_exhaustion);
+    RUN_TEST(test_wide_fanout_dispatch);
+    RUN_TEST(test_fanout_does_not_slow_dispatch);
+    RUN_TEST(test_build_subscribe_packet);
+    RUN_TEST(test_build_subscribe_splits_when_full);
+    RUN_TEST(test_build_subscribe_long_remaining_length);
+    return UNITY_END();
+}
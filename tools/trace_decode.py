@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""Decode a trace dump from <publish topic>/diag/trace into a timeline.
+
+The chunk and record layout is described in include/Trace.h. Capture a
+dump with, for example:
+
+    mosquitto_sub -h <broker> -t '<publish topic>/diag/trace' -N > trace.bin &
+    mosquitto_pub -h <broker> -t '<subscribe topic>/trace' -m '{"trace":"dump"}'
+
+then run:
+
+    python3 tools/trace_decode.py trace.bin
+    python3 tools/trace_decode.py --chrome trace.json trace.bin
+
+Chunks are self-delimiting, so captured payloads can simply be
+concatenated. With --hex, each input line is one payload in hex (as printed
+by mosquitto_sub -F %x). --chrome writes the Chrome trace event format,
+which chrome://tracing and ui.perfetto.dev display as a timeline.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+FORMAT_VERSION = 1
+HEADER = struct.Struct("<BBHHHII")
+RECORD = struct.Struct("<IHHI")
+FLAG_LAST = 0x01
+
+# Keep in step with enum TraceEvent in include/Trace.h
+EVENTS = {
+    1: "loop_begin",
+    2: "loop_end",
+    3: "connect_begin",
+    4: "connect_end",
+    5: "publish_begin",
+    6: "publish_end",
+    7: "message",
+    8: "dump",
+}
+
+# Begin/end pairs shown as spans
+SPANS = {
+    "loop_begin": ("loop", True),
+    "loop_end": ("loop", False),
+    "connect_begin": ("connect", True),
+    "connect_end": ("connect", False),
+    "publish_begin": ("publish", True),
+    "publish_end": ("publish", False),
+}
+
+
+def parse_chunks(data):
+    """Split a byte stream into (header, records) tuples."""
+    chunks = []
+    offset = 0
+    while offset + HEADER.size <= len(data):
+        version, flags, dump_id, seq, count, hz, total = HEADER.unpack_from(data, offset)
+        if version != FORMAT_VERSION:
+            raise ValueError("unsupported trace format %d at byte %d" % (version, offset))
+        offset += HEADER.size
+        end = offset + count * RECORD.size
+        if end > len(data):
+            raise ValueError("chunk %d of dump %d is truncated" % (seq, dump_id))
+        records = [RECORD.unpack_from(data, offset + i * RECORD.size) for i in range(count)]
+        offset = end
+        chunks.append(({"flags": flags, "dump": dump_id, "seq": seq, "hz": hz, "total": total}, records))
+    return chunks
+
+
+def read_input(paths, hex_lines):
+    data = bytearray()
+    for path in paths or ["-"]:
+        if hex_lines:
+            stream = sys.stdin if path == "-" else open(path)
+            for line in stream:
+                line = line.strip()
+                if line:
+                    data += bytes.fromhex(line)
+        else:
+            stream = sys.stdin.buffer if path == "-" else open(path, "rb")
+            data += stream.read()
+    return bytes(data)
+
+
+def select_dump(chunks, wanted):
+    dumps = {}
+    for header, records in chunks:
+        dumps.setdefault(header["dump"], []).append((header, records))
+    if not dumps:
+        raise ValueError("no trace chunks found")
+
+    dump_id = wanted if wanted is not None else max(dumps)
+    if dump_id not in dumps:
+        raise ValueError("dump %d not found (have %s)" % (dump_id, sorted(dumps)))
+
+    parts = sorted(dumps[dump_id], key=lambda c: c[0]["seq"])
+    seqs = [h["seq"] for h, _ in parts]
+    missing = sorted(set(range(max(seqs) + 1)) - set(seqs))
+    if missing:
+        print("warning: dump %d is missing chunk(s) %s" % (dump_id, missing), file=sys.stderr)
+    if not parts[-1][0]["flags"] & FLAG_LAST:
+        print("warning: dump %d has no final chunk" % dump_id, file=sys.stderr)
+
+    records = [r for _, rs in parts for r in rs]
+    return dump_id, parts[0][0], records
+
+
+def unwrap(records, hz):
+    """Turn 32-bit wrapping ticks into microseconds from the first record."""
+    events = []
+    base = None
+    last = None
+    wraps = 0
+    for ticks, event, a, b in records:
+        if last is not None and ticks < last:
+            wraps += 1
+        last = ticks
+        absolute = ticks + (wraps << 32)
+        if base is None:
+            base = absolute
+        events.append((((absolute - base) * 1000000) // hz, EVENTS.get(event, "event_%d" % event), a, b))
+    return events
+
+
+def describe(name, a, b):
+    if name == "loop_end":
+        return "slowest=%s idle=%d ms" % ("-" if a == 0xFFFF else "task %d" % a, b)
+    if name == "connect_begin":
+        return "broker=%d" % a
+    if name == "connect_end":
+        return "%s state=%d" % ("connected" if a else "failed", struct.unpack("<i", struct.pack("<I", b))[0])
+    if name == "publish_end":
+        return "%s %d bytes" % ("sent" if a else "failed", b)
+    if name == "message":
+        return "%s %d bytes" % ("queued" if a else "dropped", b)
+    if name == "dump":
+        return "dump %d requested" % a
+    if name.startswith("event_"):
+        return "a=%d b=%d" % (a, b)
+    return ""
+
+
+def print_timeline(events, header, dump_id, show_loops):
+    kept = len(events)
+    print("dump %d: %d records (%d written since boot), %d Hz clock" % (dump_id, kept, header["total"], header["hz"]))
+    print("%12s %10s  %-14s %s" % ("time ms", "+us", "event", "detail"))
+
+    open_spans = {}
+    previous = None
+    for time_us, name, a, b in events:
+        span = SPANS.get(name)
+        detail = describe(name, a, b)
+        if span:
+            label, begin = span
+            if begin:
+                open_spans[label] = time_us
+            elif label in open_spans:
+                duration = time_us - open_spans.pop(label)
+                detail = ("%s (%d us)" % (detail, duration)).strip()
+            if label == "loop" and not show_loops:
+                previous = time_us
+                continue
+        delta = "" if previous is None else "+%d" % (time_us - previous)
+        previous = time_us
+        print("%12.3f %10s  %-14s %s" % (time_us / 1000.0, delta, name, detail))
+
+
+def write_chrome(path, events):
+    out = []
+    for time_us, name, a, b in events:
+        span = SPANS.get(name)
+        if span:
+            label, begin = span
+            entry = {"name": label, "ph": "B" if begin else "E", "ts": time_us, "pid": 1, "tid": 1}
+            if not begin:
+                entry["args"] = {"detail": describe(name, a, b)}
+        else:
+            entry = {"name": name, "ph": "i", "s": "t", "ts": time_us, "pid": 1, "tid": 1,
+                     "args": {"detail": describe(name, a, b)}}
+        out.append(entry)
+    with open(path, "w") as f:
+        json.dump({"traceEvents": out, "displayTimeUnit": "ms"}, f)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Render a device trace dump as a timeline")
+    parser.add_argument("inputs", nargs="*", help="captured chunk payloads (default: stdin)")
+    parser.add_argument("--hex", action="store_true", help="inputs are hex payloads, one per line")
+    parser.add_argument("--dump", type=int, help="dump id to show (default: the latest)")
+    parser.add_argument("--loops", action="store_true", help="also list every main loop run")
+    parser.add_argument("--chrome", metavar="FILE", help="write a Chrome trace event file")
+    args = parser.parse_args()
+
+    try:
+        chunks = parse_chunks(read_input(args.inputs, args.hex))
+        dump_id, header, records = select_dump(chunks, args.dump)
+    except (ValueError, OSError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+
+    events = unwrap(records, header["hz"])
+    print_timeline(events, header, dump_id, args.loops)
+    if args.chrome:
+        write_chrome(args.chrome, events)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())